@@ -51,13 +51,18 @@ function(add_fluidx3d_example)
         ${FLUIDX3D_OPENCL_LIB_DIR}
     )
 
-    # X11 libraries only on Unix-like systems
-    if(UNIX)
+    # X11 libraries only on Unix-like systems, and not for headless builds
+    if(UNIX AND NOT FLUIDX3D_HEADLESS)
         target_link_directories(${EXAMPLE_NAME} PRIVATE
             ${FLUIDX3D_X11_DIR}/lib
         )
     endif()
 
+    # Headless build: frame export only, interactive graphics modes are disabled
+    if(FLUIDX3D_HEADLESS)
+        target_compile_definitions(${EXAMPLE_NAME} PRIVATE HEADLESS)
+    endif()
+
     # ==========================================================================
     # Set output directories (place executable next to stl/ folder)
     # ==========================================================================
@@ -88,12 +93,14 @@ function(add_fluidx3d_example)
             shell32 ole32 oleaut32 uuid odbc32 odbccp32
         )
     elseif(UNIX)
-        # Linux/Mac: X11 and threading
-        target_link_libraries(${EXAMPLE_NAME} PRIVATE
-            Threads::Threads
-            X11
-            Xrandr
-        )
+        # Linux/Mac: threading, and X11 for interactive graphics
+        target_link_libraries(${EXAMPLE_NAME} PRIVATE Threads::Threads)
+        if(NOT FLUIDX3D_HEADLESS)
+            target_link_libraries(${EXAMPLE_NAME} PRIVATE
+                X11
+                Xrandr
+            )
+        endif()
     endif()
 
 endfunction()
@@ -49,21 +49,21 @@ void main_setup() { // Bell 222 helicopter; required extensions in defines.hpp:
 	main->set_center(main->get_center_of_mass());
 	back->set_center(back->get_center_of_mass());
 	const float main_radius=0.5f*main->get_max_size(), main_omega=lbm_u/main_radius, main_domega=main_omega*(float)lbm_dt;
-	const float back_radius=0.5f*back->get_max_size(), back_omega=-lbm_u/back_radius, back_domega=back_omega*(float)lbm_dt;
+	const float back_radius=0.5f*back->get_max_size(), back_omega=-lbm_u/back_radius;
 	lbm.voxelize_mesh_on_device(body);
 	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
 		if(lbm.flags[n]!=TYPE_S) lbm.u.y[n] =  0.2f*lbm_u;
 		if(lbm.flags[n]!=TYPE_S) lbm.u.z[n] = -0.1f*lbm_u;
 		if(x==0u||x==Nx-1u||y==0u||y==Ny-1u||z==0u||z==Nz-1u) lbm.flags[n] = TYPE_E; // all non periodic
 	}); // ####################################################################### run simulation, export images and data ##########################################################################
+	const uint main_handle = lbm.upload_rigid_mesh(main, float3(0.0f, 0.0f, 1.0f)); // upload rotors to device memory once
+	const uint back_handle = lbm.upload_rigid_mesh(back, float3(1.0f, 0.0f, 0.0f));
 	lbm.graphics.visualization_modes = VIS_FLAG_SURFACE|VIS_Q_CRITERION;
 	lbm.run(0u, lbm_T); // initialize simulation
 	while(lbm.get_t()<=lbm_T) { // main simulation loop
-		lbm.voxelize_mesh_on_device(main, TYPE_S, main->get_center(), float3(0.0f), float3(0.0f, 0.0f, main_omega)); // revoxelize mesh on GPU
-		lbm.voxelize_mesh_on_device(back, TYPE_S, back->get_center(), float3(0.0f), float3(back_omega, 0.0f, 0.0f)); // revoxelize mesh on GPU
+		lbm.voxelize_rigid_mesh_on_device(main_handle, float3x3(float3(0.0f, 0.0f, 1.0f), main_omega*(float)lbm.get_t()), float3(0.0f), TYPE_S, main->get_center(), float3(0.0f), float3(0.0f, 0.0f, main_omega)); // revoxelize mesh on GPU, mesh stays in device memory, only its rotation is updated
+		lbm.voxelize_rigid_mesh_on_device(back_handle, float3x3(float3(1.0f, 0.0f, 0.0f), back_omega*(float)lbm.get_t()), float3(0.0f), TYPE_S, back->get_center(), float3(0.0f), float3(back_omega, 0.0f, 0.0f)); // revoxelize mesh on GPU, mesh stays in device memory, only its rotation is updated
 		lbm.run(lbm_dt, lbm_T); // run dt time steps
-		main->rotate(float3x3(float3(0.0f, 0.0f, 1.0f), main_domega)); // rotate mesh
-		back->rotate(float3x3(float3(1.0f, 0.0f, 0.0f), back_domega)); // rotate mesh
 #if defined(GRAPHICS) && !defined(INTERACTIVE_GRAPHICS)
 		if(lbm.graphics.next_frame(lbm_T, 10.0f)) {
 			lbm.graphics.set_camera_free(float3(0.528513f*(float)Nx, 0.102095f*(float)Ny, 1.302283f*(float)Nz), 16.0f, 47.0f, 96.0f);
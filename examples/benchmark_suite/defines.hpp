@@ -0,0 +1,102 @@
+#pragma once
+
+
+
+// benchmark_suite: velocity set, collision operator, FP16 compression and extensions are set as compile definitions by CMake for each benchmark_suite_* target (see examples/benchmark_suite/CMakeLists.txt); the lines below only provide defaults if nothing is set
+#if !defined(D2Q9)&&!defined(D3Q15)&&!defined(D3Q19)&&!defined(D3Q27)
+#define D3Q19 // choose D3Q19 velocity set for 3D; allocates 93 (FP32) or 55 (FP16) Bytes/cell; (default)
+#endif // no velocity set selected
+#if !defined(SRT)&&!defined(TRT)
+#define SRT // choose single-relaxation-time LBM collision operator; (default)
+#endif // no collision operator selected
+
+#ifndef BENCHMARK_SUITE_SIZES
+#define BENCHMARK_SUITE_SIZES 64u, 128u, 256u // lattice edge lengths per domain; 2D lattices get the same number of cells per domain
+#endif // BENCHMARK_SUITE_SIZES
+#ifndef BENCHMARK_SUITE_DOMAINS
+#define BENCHMARK_SUITE_DOMAINS 1u // numbers of domains (GPUs); devices are selected as command line arguments or automatically
+#endif // BENCHMARK_SUITE_DOMAINS
+#ifndef BENCHMARK_SUITE_CSV
+#define BENCHMARK_SUITE_CSV "" // results are appended to this CSV file; "" = bin/benchmark_suite.csv
+#endif // BENCHMARK_SUITE_CSV
+
+//#define INTERACTIVE_GRAPHICS // enable interactive graphics; start/pause the simulation by pressing P; either Windows or Linux X11 desktop must be available; on Linux: change to "compile on Linux with X11" command in make.sh
+//#define INTERACTIVE_GRAPHICS_ASCII // enable interactive graphics in ASCII mode the console; start/pause the simulation by pressing P
+//#define GRAPHICS // run FluidX3D in the console, but still enable graphics functionality for writing rendered frames to the hard drive
+
+#define GRAPHICS_FRAME_WIDTH 1920 // set frame width if only GRAPHICS is enabled
+#define GRAPHICS_FRAME_HEIGHT 1080 // set frame height if only GRAPHICS is enabled
+#define GRAPHICS_BACKGROUND_COLOR 0x000000 // set background color; black background (default) = 0x000000, white background = 0xFFFFFF
+#define GRAPHICS_U_MAX 0.18f // maximum velocity for velocity coloring in units of LBM lattice speed of sound (c=1/sqrt(3)) (default: 0.18f)
+#define GRAPHICS_RHO_DELTA 0.001f // coloring range for density rho will be [1.0f-GRAPHICS_RHO_DELTA, 1.0f+GRAPHICS_RHO_DELTA] (default: 0.001f)
+#define GRAPHICS_T_DELTA 1.0f // coloring range for temperature T will be [1.0f-GRAPHICS_T_DELTA, 1.0f+GRAPHICS_T_DELTA] (default: 1.0f)
+#define GRAPHICS_F_MAX 0.001f // maximum force in LBM units for visualization of forces on solid boundaries if VOLUME_FORCE is enabled and lbm.update_force_field(); is called (default: 0.001f)
+#define GRAPHICS_Q_CRITERION 0.0001f // Q-criterion value for Q-criterion isosurface visualization (default: 0.0001f)
+#define GRAPHICS_STREAMLINE_SPARSE 8 // set how many streamlines there are every x lattice points
+#define GRAPHICS_STREAMLINE_LENGTH 128 // set maximum length of streamlines
+#define GRAPHICS_RAYTRACING_TRANSMITTANCE 0.25f // transmitted light fraction in raytracing graphics ("0.25f" = 1/4 of light is transmitted and 3/4 is absorbed along longest box side length, "1.0f" = no absorption)
+#define GRAPHICS_RAYTRACING_COLOR 0x005F7F // absorption color of fluid in raytracing graphics
+
+//#define GRAPHICS_TRANSPARENCY 0.7f // optional: comment/uncomment this line to disable/enable semi-transparent rendering (looks better but reduces framerate), number represents transparency (equal to 1-opacity) (default: 0.7f)
+
+
+
+// #############################################################################################################
+
+#define TYPE_S 0b00000001 // (stationary or moving) solid boundary
+#define TYPE_E 0b00000010 // equilibrium boundary (inflow/outflow)
+#define TYPE_T 0b00000100 // temperature boundary
+#define TYPE_F 0b00001000 // fluid
+#define TYPE_I 0b00010000 // interface
+#define TYPE_G 0b00100000 // gas
+#define TYPE_X 0b01000000 // reserved type X
+#define TYPE_Y 0b10000000 // reserved type Y
+
+#define VIS_FLAG_LATTICE  0b00000001 // lbm.graphics.visualization_modes = VIS_...|VIS_...|VIS_...;
+#define VIS_FLAG_SURFACE  0b00000010
+#define VIS_FIELD         0b00000100
+#define VIS_STREAMLINES   0b00001000
+#define VIS_Q_CRITERION   0b00010000
+#define VIS_PHI_RASTERIZE 0b00100000
+#define VIS_PHI_RAYTRACE  0b01000000
+#define VIS_PARTICLES     0b10000000
+
+#if defined(FP16S) || defined(FP16C)
+#define fpxx ushort
+#else // FP32
+#define fpxx float
+#endif // FP32
+
+#ifdef BENCHMARK
+#undef UPDATE_FIELDS
+#undef VOLUME_FORCE
+#undef FORCE_FIELD
+#undef MOVING_BOUNDARIES
+#undef EQUILIBRIUM_BOUNDARIES
+#undef SURFACE
+#undef TEMPERATURE
+#undef SUBGRID
+#undef PARTICLES
+#undef INTERACTIVE_GRAPHICS
+#undef INTERACTIVE_GRAPHICS_ASCII
+#undef GRAPHICS
+#endif // BENCHMARK
+
+#ifdef SURFACE // (rho, u) need to be updated exactly every LBM step
+#define UPDATE_FIELDS // update (rho, u, T) in every LBM step
+#endif // SURFACE
+
+#ifdef TEMPERATURE
+#define VOLUME_FORCE
+#endif // TEMPERATURE
+
+#ifdef PARTICLES // (rho, u) need to be updated exactly every LBM step
+#define UPDATE_FIELDS // update (rho, u, T) in every LBM step
+#endif // PARTICLES
+
+#include "headless.hpp" // HEADLESS build: interactive graphics modes fall back to GRAPHICS
+
+#if defined(INTERACTIVE_GRAPHICS) || defined(INTERACTIVE_GRAPHICS_ASCII)
+#define GRAPHICS
+#define UPDATE_FIELDS // to prevent flickering artifacts in interactive graphics
+#endif // INTERACTIVE_GRAPHICS || INTERACTIVE_GRAPHICS_ASCII
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "defines.hpp"
+#include "info.hpp"
+#include "lbm.hpp"
+#include "graphics.hpp"
+#include "setup.hpp"
+#include "shapes.hpp"
+
+#ifdef D2Q9
+const uint benchmark_dimensions = 2u;
+#else // D3Q15, D3Q19 or D3Q27
+const uint benchmark_dimensions = 3u;
+#endif // D3Q15, D3Q19 or D3Q27
+
+string benchmark_configuration() { // compile-time configuration of this benchmark_suite target as CSV columns: velocity set, precision, collision operator, extensions
+	string velocity_set="", precision="FP32", collision="", extensions="";
+#if defined(D2Q9)
+	velocity_set = "D2Q9";
+#elif defined(D3Q15)
+	velocity_set = "D3Q15";
+#elif defined(D3Q19)
+	velocity_set = "D3Q19";
+#elif defined(D3Q27)
+	velocity_set = "D3Q27";
+#endif // D3Q27
+#if defined(FP16S)
+	precision = "FP16S";
+#elif defined(FP16C)
+	precision = "FP16C";
+#endif // FP16C
+#if defined(SRT)
+	collision = "SRT";
+#elif defined(TRT)
+	collision = "TRT";
+#endif // TRT
+#ifdef VOLUME_FORCE
+	extensions += "+VOLUME_FORCE";
+#endif // VOLUME_FORCE
+#ifdef FORCE_FIELD
+	extensions += "+FORCE_FIELD";
+#endif // FORCE_FIELD
+#ifdef EQUILIBRIUM_BOUNDARIES
+	extensions += "+EQUILIBRIUM_BOUNDARIES";
+#endif // EQUILIBRIUM_BOUNDARIES
+#ifdef MOVING_BOUNDARIES
+	extensions += "+MOVING_BOUNDARIES";
+#endif // MOVING_BOUNDARIES
+#ifdef SURFACE
+	extensions += "+SURFACE";
+#endif // SURFACE
+#ifdef TEMPERATURE
+	extensions += "+TEMPERATURE";
+#endif // TEMPERATURE
+#ifdef SUBGRID
+	extensions += "+SUBGRID";
+#endif // SUBGRID
+#ifdef PARTICLES
+	extensions += "+PARTICLES";
+#endif // PARTICLES
+#ifdef TEMPORAL_BLOCKING
+	extensions += "+TEMPORAL_BLOCKING";
+#endif // TEMPORAL_BLOCKING
+#ifdef ACTIVE_CELLS
+	extensions += "+ACTIVE_CELLS";
+#endif // ACTIVE_CELLS
+	return velocity_set+","+precision+","+collision+","+(extensions=="" ? "NONE" : extensions.substr(1));
+}
+
+double memcpy_bandwidth(const Device_Info& device_info) { // measure device memory bandwidth in GB/s with a simple copy kernel, this is the roofline for the LBM bandwidth
+	Device device(device_info, "kernel void copy(const global float4* a, global float4* b) { const ulong n = get_global_id(0); b[n] = a[n]; }");
+	const ulong N = min((ulong)256u*(ulong)1048576u, (ulong)device_info.memory*(ulong)1048576u/(ulong)4u)/(ulong)16u; // number of float4 per buffer, at most 256 MB per buffer
+	Memory<float> a(device, 4ull*N, 1u, false), b(device, 4ull*N, 1u, false);
+	Kernel kernel_copy(device, N, "copy", a, b);
+	kernel_copy.run(); // warmup
+	double time = max_double;
+	for(uint i=0u; i<10u; i++) {
+		Clock clock;
+		kernel_copy.run();
+		time = fmin(time, clock.stop());
+	}
+	return 2.0*16.0*(double)N/time*1E-9; // one read and one write per float4
+}
+
+uint3 benchmark_domains(const uint D) { // split D domains as evenly as possible into (Dx, Dy, Dz)
+	uint3 Dxyz = uint3(1u, 1u, 1u);
+	uint remaining = D;
+	for(uint i=0u; remaining>1u; i=(i+1u)%(benchmark_dimensions)) {
+		uint f = 2u;
+		while(remaining%f!=0u) f++; // smallest prime factor
+		if(i==0u) Dxyz.x *= f; else if(i==1u) Dxyz.y *= f; else Dxyz.z *= f;
+		remaining /= f;
+	}
+	return Dxyz;
+}
+
+double benchmark_mlups(const uint3 N, const uint3 D) { // run one benchmark case and return performance in MLUPs/s
+	float fx=0.0f, fy=0.0f, fz=0.0f, sigma=0.0f, alpha=0.0f, beta=0.0f;
+	uint particles_N = 0u;
+#ifdef VOLUME_FORCE
+	(N.z>1u ? fz : fy) = -1E-6f; // weak gravity
+#endif // VOLUME_FORCE
+#ifdef TEMPERATURE
+	alpha = 0.02f;
+	beta = 0.0005f;
+#endif // TEMPERATURE
+#ifdef PARTICLES
+	particles_N = to_uint((double)N.x*(double)N.y*(double)N.z*1E-3); // one particle per 1000 cells
+#endif // PARTICLES
+	LBM lbm(N, D.x, D.y, D.z, 1.0f/6.0f, fx, fy, fz, sigma, alpha, beta, particles_N, 1.0f);
+	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
+		const uint h=Nz>1u ? z : y, H=Nz>1u ? Nz : Ny; // vertical coordinate, z in 3D and y in 2D
+#ifdef SURFACE
+		if(h<H/2u) lbm.flags[n] = TYPE_F; // lower half is fluid, upper half is gas
+#endif // SURFACE
+#ifdef EQUILIBRIUM_BOUNDARIES
+		if(x==0u||x==Nx-1u) lbm.flags[n] = TYPE_E; // inflow/outflow
+#endif // EQUILIBRIUM_BOUNDARIES
+#ifdef MOVING_BOUNDARIES
+		if(h==H-1u) { lbm.flags[n] = TYPE_S; lbm.u.x[n] = 0.05f; } // moving lid
+#endif // MOVING_BOUNDARIES
+#ifdef TEMPERATURE
+		if(h==0u) { lbm.flags[n] = TYPE_T; lbm.T[n] = 1.1f; } // hot bottom wall
+#endif // TEMPERATURE
+	}); // ####################################################################### run simulation ########################################################################
+	lbm.run(10u); // initialization and warmup
+	const double time_min = 2.0; // measure for at least 2 seconds
+	ulong steps = 0ull;
+	Clock clock;
+	while(clock.stop()<time_min) {
+		lbm.run(100u);
+		steps += 100ull;
+	}
+	return (double)lbm.get_N()*(double)steps/clock.stop()*1E-6;
+} // make lbm object go out of scope to free its memory
+
+void main_setup() { // benchmark suite; compile-time configuration is set by CMake for each benchmark_suite_* target, lattice sizes and domain counts in BENCHMARK_SUITE_SIZES/BENCHMARK_SUITE_DOMAINS
+	const vector<uint> sizes = { BENCHMARK_SUITE_SIZES };
+	const vector<uint> domains = { BENCHMARK_SUITE_DOMAINS };
+	const string csv = string(BENCHMARK_SUITE_CSV)=="" ? get_exe_path()+"benchmark_suite.csv" : string(BENCHMARK_SUITE_CSV);
+	if(!std::filesystem::exists(csv)) {
+		create_folder(csv);
+		write_line(csv, "velocity_set,precision,collision,extensions,Nx,Ny,Nz,domains,device,MLUPs/s,GB/s,roofline_GB/s,roofline_percent");
+	}
+	for(const uint D : domains) {
+		const vector<Device_Info> device_infos = smart_device_selection(D);
+		vector<uint> device_ids; // distinct devices, several domains can share one device
+		double roofline = 0.0; // sum of memory bandwidth of all distinct devices in GB/s
+		for(const Device_Info& device_info : device_infos) {
+			if(std::find(device_ids.begin(), device_ids.end(), device_info.id)!=device_ids.end()) continue;
+			device_ids.push_back(device_info.id);
+			roofline += memcpy_bandwidth(device_info);
+		}
+		const uint3 Dxyz = benchmark_domains(D);
+		for(const uint size : sizes) {
+			const uint side_2d = to_uint(sqrt((double)size*(double)size*(double)size)); // 2D lattices get the same number of cells as 3D lattices
+			const uint3 N = benchmark_dimensions==3u ? uint3(Dxyz.x*size, Dxyz.y*size, Dxyz.z*size) : uint3(Dxyz.x*side_2d, Dxyz.y*side_2d, 1u);
+			const ulong memory_required = (ulong)N.x*(ulong)N.y*(ulong)N.z/(ulong)D*(ulong)bytes_per_cell_device()/1048576ull; // per domain in MB
+			bool fits = true;
+			for(const uint id : device_ids) {
+				ulong domains_on_device = 0ull;
+				for(const Device_Info& device_info : device_infos) domains_on_device += (ulong)(device_info.id==id);
+				for(const Device_Info& device_info : device_infos) if(device_info.id==id) fits = fits&&domains_on_device*memory_required<(ulong)device_info.memory;
+			}
+			if(!fits) {
+				print_warning("Skipping lattice ("+to_string(N.x)+", "+to_string(N.y)+", "+to_string(N.z)+") on "+to_string(D)+" domain(s), as it does not fit into device memory.");
+				continue;
+			}
+			const double mlups = benchmark_mlups(N, Dxyz);
+			const double bandwidth = mlups*(double)bandwidth_bytes_per_cell_device()*1E-3; // in GB/s
+			const string line = benchmark_configuration()+","+to_string(N.x)+","+to_string(N.y)+","+to_string(N.z)+","+to_string(D)+",\""+device_infos[0].name+"\","+to_string(mlups, 1u)+","+to_string(bandwidth, 1u)+","+to_string(roofline, 1u)+","+to_string(100.0*bandwidth/roofline, 1u);
+			write_line(csv, line);
+			print_info(line);
+		}
+	}
+	print_info("Benchmark results have been appended to \""+csv+"\".");
+} /**/
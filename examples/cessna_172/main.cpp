@@ -45,18 +45,18 @@ void main_setup() { // Cessna 172 propeller aircraft; required extensions in def
 	rotor->translate(offset);
 	plane->set_center(plane->get_center_of_mass()); // set rotation center of mesh to its center of mass
 	rotor->set_center(rotor->get_center_of_mass());
-	const float lbm_radius=0.5f*rotor->get_max_size(), omega=-lbm_u/lbm_radius, domega=omega*(float)lbm_dt;
+	const float lbm_radius=0.5f*rotor->get_max_size(), omega=-lbm_u/lbm_radius;
 	lbm.voxelize_mesh_on_device(plane);
 	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
 		if(lbm.flags[n]!=TYPE_S) lbm.u.y[n] = lbm_u;
 		if(x==0u||x==Nx-1u||y==0u||y==Ny-1u||z==0u||z==Nz-1u) lbm.flags[n] = TYPE_E; // all non periodic
 	}); // ####################################################################### run simulation, export images and data ##########################################################################
+	const uint rotor_handle = lbm.upload_rigid_mesh(rotor, float3(0.0f, 1.0f, 0.0f)); // upload rotor to device memory once
 	lbm.graphics.visualization_modes = VIS_FLAG_SURFACE|VIS_Q_CRITERION;
 	lbm.run(0u, lbm_T); // initialize simulation
 	while(lbm.get_t()<=lbm_T) { // main simulation loop
-		lbm.voxelize_mesh_on_device(rotor, TYPE_S, rotor->get_center(), float3(0.0f), float3(0.0f, omega, 0.0f)); // revoxelize mesh on GPU
+		lbm.voxelize_rigid_mesh_on_device(rotor_handle, float3x3(float3(0.0f, 1.0f, 0.0f), omega*(float)lbm.get_t()), float3(0.0f), TYPE_S, rotor->get_center(), float3(0.0f), float3(0.0f, omega, 0.0f)); // revoxelize mesh on GPU, mesh stays in device memory, only its rotation is updated
 		lbm.run(lbm_dt, lbm_T); // run dt time steps
-		rotor->rotate(float3x3(float3(0.0f, 1.0f, 0.0f), domega)); // rotate mesh
 #if defined(GRAPHICS) && !defined(INTERACTIVE_GRAPHICS)
 		if(lbm.graphics.next_frame(lbm_T, 5.0f)) {
 			lbm.graphics.set_camera_free(float3(0.192778f*(float)Nx, -0.669183f*(float)Ny, 0.657584f*(float)Nz), -77.0f, 27.0f, 100.0f);
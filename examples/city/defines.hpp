@@ -12,6 +12,8 @@
 
 #define FP16S // compress LBM DDFs to range-shifted IEEE-754 FP16; number conversion is done in hardware; all arithmetic is still done in FP32
 //#define FP16C // compress LBM DDFs to more accurate custom FP16C format; number conversion is emulated in software; all arithmetic is still done in FP32
+//#define TEMPORAL_BLOCKING 2 // optional for CPUs with large caches: perform 2 (or more) time steps per kernel launch on cache-resident tiles to reduce memory bandwidth; allocates an extra 76 (FP32) or 38 (FP16) Bytes/node (D3Q19); single-domain only, not compatible with SURFACE, TEMPERATURE or PARTICLES
+//#define ACTIVE_CELLS // optional for setups with many solid or gas cells: stream_collide only runs over a compacted list of non-solid and non-gas cells that is rebuilt when flags change; allocates an extra 4 Bytes/node
 
 //#define BENCHMARK // disable all extensions and setups and run benchmark setup instead
 
@@ -94,6 +96,8 @@
 #define VOLUME_FORCE
 #endif // TEMPERATURE
 
+#include "headless.hpp" // HEADLESS build: interactive graphics modes fall back to GRAPHICS
+
 #ifdef WINDOWS_GRAPHICS
 #define GRAPHICS
 #endif // WINDOWS_GRAPHICS
@@ -33,13 +33,11 @@ void main_setup() { // city; required extensions in defines.hpp: FP16S, EQUILIBR
 	key_4 = true;
 	Clock clock;
 	lbm.run(0u);
+	lbm.graphics.add_view_free(float3(-1.088245f*(float)Nx, -0.443919f*(float)Ny, 1.717979f*(float)Nz), 215.0f, 39.0f, 70.0f, get_exe_path()+"export/a/");
+	lbm.graphics.add_view_free(float3(0.203233f*(float)Nx, 0.036325f*(float)Ny, 0.435000f*(float)Nz), 56.0f, 45.0f, 105.0f, get_exe_path()+"export/b/");
+	lbm.graphics.add_view_free(float3(-0.283501f*(float)Nx, -0.099679f*(float)Ny, 0.175468f*(float)Nz), 234.0f, 29.0f, 117.0f, get_exe_path()+"export/c/");
 	while(lbm.get_t()<108000u) {
-		lbm.graphics.set_camera_free(float3(-1.088245f*(float)Nx, -0.443919f*(float)Ny, 1.717979f*(float)Nz), 215.0f, 39.0f, 70.0f);
-		lbm.graphics.write_frame_png(get_exe_path()+"export/a/");
-		lbm.graphics.set_camera_free(float3(0.203233f*(float)Nx, 0.036325f*(float)Ny, 0.435000f*(float)Nz), 56.0f, 45.0f, 105.0f);
-		lbm.graphics.write_frame_png(get_exe_path()+"export/b/");
-		lbm.graphics.set_camera_free(float3(-0.283501f*(float)Nx, -0.099679f*(float)Ny, 0.175468f*(float)Nz), 234.0f, 29.0f, 117.0f);
-		lbm.graphics.write_frame_png(get_exe_path()+"export/c/");
+		lbm.graphics.write_views_png(); // render all 3 views in one pass
 		lbm.run(90u); // run LBM in parallel while CPU is voxelizing the next frame
 	}
 	write_file(get_exe_path()+"time.txt", print_time(clock.stop()));
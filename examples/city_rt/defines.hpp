@@ -6,6 +6,8 @@
 
 // Floating point precision - FP16S gives a good balance of speed and memory
 #define FP16S
+//#define TEMPORAL_BLOCKING 2 // optional for CPUs: multiple time steps per kernel launch on cache-resident tiles; single-domain only
+//#define ACTIVE_CELLS // optional: stream_collide only runs over a compacted list of non-solid and non-gas cells
 
 // --- Enabled Extensions ---
 // Enables fixing velocity/density at boundaries (for inflow/outflow).
@@ -62,6 +64,8 @@
 #else
 #define fpxx float
 #endif
+// Headless build (CMake option FLUIDX3D_HEADLESS): frame export only, no window system
+#include "headless.hpp"
 #if defined(INTERACTIVE_GRAPHICS) || defined(INTERACTIVE_GRAPHICS_ASCII)
 #define GRAPHICS
 #define UPDATE_FIELDS
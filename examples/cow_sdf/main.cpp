@@ -13,6 +13,7 @@
 // SDF file format (binary, little-endian):
 //   Header (36 bytes): int32 Nx, Ny, Nz; float32 bounds_min[3], bounds_max[3]
 //   Data: float32[Nx*Ny*Nz] signed distance values (negative=inside, positive=outside)
+//   Files written by write_sdf() start with "SDFX" and store the data x-fastest, so they load without a transpose
 
 #include "defines.hpp"
 #include "info.hpp"
@@ -41,7 +42,7 @@ void main_setup() { // aerodynamics of a cow using SDF; required extensions in d
 	const float3x3 rotation = float3x3(float3(1, 0, 0), radians(180.0f))*float3x3(float3(0, 0, 1), radians(180.0f));
 
 	// Load SDF to compute bounds (matching what read_stl does)
-	const SDF* sdf = read_sdf(get_resource_path("Cow_t_sdf_128x428x258.sdf"));
+	std::shared_ptr<const SDF> sdf = read_sdf_cached(get_resource_path("Cow_t_sdf_128x428x258.sdf")); // cached, so voxelize_sdf does not read the file again while sdf is held
 	const float3 sdf_world_size = sdf->get_world_size();
 	const float sdf_max_dim = fmax(fmax(sdf_world_size.x, sdf_world_size.y), sdf_world_size.z);
 	const float world_to_lbm = lbm_length / sdf_max_dim;
@@ -69,8 +70,8 @@ void main_setup() { // aerodynamics of a cow using SDF; required extensions in d
 	const float3 translation = float3(0.0f, 1.0f - pmin_lbm.y + 0.1f*lbm_length, 1.0f - pmin_lbm.z);
 	const float3 center = lbm.center() + translation;
 
-	delete sdf; // Free SDF, voxelize_sdf will reload it
 	lbm.voxelize_sdf(get_resource_path("Cow_t_sdf_128x428x258.sdf"), center, rotation, lbm_length);
+	sdf.reset(); // free SDF
 	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
 		if(z==0u) lbm.flags[n] = TYPE_S; // solid floor
 		if(lbm.flags[n]!=TYPE_S) lbm.u.y[n] = lbm_u; // initialize y-velocity everywhere except in solid cells
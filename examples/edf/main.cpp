@@ -25,18 +25,18 @@ void main_setup() { // electric ducted fan (EDF); required extensions in defines
 	rotor->translate(lbm.center()-rotor->get_bounding_box_center()-float3(0.0f, 0.41f*stator->get_max_size(), 0.0f));
 	stator->set_center(stator->get_center_of_mass()); // set rotation center of mesh to its center of mass
 	rotor->set_center(rotor->get_center_of_mass());
-	const float lbm_radius=0.5f*rotor->get_max_size(), omega=lbm_u/lbm_radius, domega=omega*(float)lbm_dt;
+	const float lbm_radius=0.5f*rotor->get_max_size(), omega=lbm_u/lbm_radius;
 	lbm.voxelize_mesh_on_device(stator, TYPE_S, center);
 	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
 		if(lbm.flags[n]==0u) lbm.u.y[n] = 0.3f*lbm_u;
 		if(x==0u||x==Nx-1u||y==0u||y==Ny-1u||z==0u||z==Nz-1u) lbm.flags[n] = TYPE_E; // all non periodic
 	}); // ####################################################################### run simulation, export images and data ##########################################################################
+	const uint rotor_handle = lbm.upload_rigid_mesh(rotor, float3(0.0f, 1.0f, 0.0f)); // upload rotor to device memory once
 	lbm.graphics.visualization_modes = VIS_FLAG_SURFACE|VIS_Q_CRITERION;
 	lbm.run(0u, lbm_T); // initialize simulation
 	while(lbm.get_t()<lbm_T) { // main simulation loop
-		lbm.voxelize_mesh_on_device(rotor, TYPE_S, center, float3(0.0f), float3(0.0f, omega, 0.0f));
+		lbm.voxelize_rigid_mesh_on_device(rotor_handle, float3x3(float3(0.0f, 1.0f, 0.0f), omega*(float)lbm.get_t()), float3(0.0f), TYPE_S, rotor->get_center(), float3(0.0f), float3(0.0f, omega, 0.0f)); // mesh stays in device memory, only its rotation is updated
 		lbm.run(lbm_dt, lbm_T);
-		rotor->rotate(float3x3(float3(0.0f, 1.0f, 0.0f), domega)); // rotate mesh
 #if defined(GRAPHICS) && !defined(INTERACTIVE_GRAPHICS)
 		if(lbm.graphics.next_frame(lbm_T, 30.0f)) {
 			lbm.graphics.set_camera_centered(-70.0f+100.0f*(float)lbm.get_t()/(float)lbm_T, 2.0f, 60.0f, 1.284025f);
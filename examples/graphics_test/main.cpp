@@ -0,0 +1,44 @@
+#include "defines.hpp"
+#include "info.hpp"
+#include "lbm.hpp"
+#include "graphics.hpp"
+#include "setup.hpp"
+#include "shapes.hpp"
+
+uint drawn_pixels(const int* bitmap) { // number of pixels that differ from the background color
+	uint drawn = 0u;
+	for(uint i=0u; i<camera.width*camera.height; i++) drawn += (uint)((bitmap[i]&0xFFFFFF)!=(GRAPHICS_BACKGROUND_COLOR));
+	return drawn;
+}
+void check_frame(LBM& lbm, const float rx, const bool preview, const string& name) { // a new camera angle for every frame, so the preview frame is rendered from the downsampled lattice
+	lbm.graphics.set_camera_centered(rx, 20.0f);
+	const uint drawn = drawn_pixels(lbm.graphics.draw_frame(preview));
+	if(drawn==0u) print_error("Frame \""+name+"\" is empty.");
+	print_info("Frame \""+name+"\": "+to_string(drawn)+" pixels drawn");
+}
+
+void main_setup() { // multi-domain graphics test: render a small lattice split into 2 domains in every field slice mode, in full resolution, from the gathered lattice and with level of detail; required extensions in defines.hpp: GRAPHICS
+	// ################################################################## define simulation box size, viscosity and volume force ###################################################################
+	LBM lbm(64u, 32u, 32u, 2u, 1u, 1u, 0.02f);
+	// ###################################################################################### define geometry ######################################################################################
+	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
+		if(sphere(x, y, z, float3(0.5f*(float)Nx, 0.5f*(float)Ny, 0.5f*(float)Nz), 8.0f)) lbm.flags[n] = TYPE_S;
+		else lbm.u.x[n] = 0.05f;
+	}); // ####################################################################### run simulation, export images and data ##########################################################################
+	lbm.run(10u);
+	lbm.graphics.visualization_modes = VIS_FLAG_LATTICE|VIS_FIELD;
+	float rx = 0.0f;
+	for(int slice_mode=0; slice_mode<8; slice_mode++) { // slice_mode 0 raytraces the field from the lattice gathered on domain 0
+		lbm.graphics.slice_mode = slice_mode;
+		for(ulong gather_cells : { 33554432ull, 4096ull }) { // default gathers in full resolution, small value gathers downsampled bricks
+			lbm.graphics.gather_cells = gather_cells;
+			const string name = "slice_mode "+to_string(slice_mode)+", gather_cells "+to_string(gather_cells);
+			lbm.graphics.lod = 1u;
+			check_frame(lbm, rx+=10.0f, false, name+", full resolution");
+			lbm.graphics.lod = 2u;
+			check_frame(lbm, rx+=10.0f, true, name+", lod 2");
+			check_frame(lbm, rx, true, name+", refined after lod 2");
+		}
+	}
+	print_info("All frames rendered.");
+} /**/
@@ -0,0 +1,303 @@
+// host microbenchmark for host-side hot paths outside of the LBM kernels: STL loading, mesh indexing, SDF loading/transposition, .vtk export, .png/.qoi encoding and multi-domain buffer stitching, plus round-trip checks of mesh indexing and the .png and .qoi encoders
+// uses fixed synthetic inputs and only utilities.hpp, so it does not need OpenCL or any OpenCL device; usage: bin/host_benchmark [scale], with scale>1 for larger inputs
+#include "utilities.hpp"
+#include <fstream>
+
+uint repetitions = 5u; // each path is timed this many times, and the fastest run is reported
+
+void print_result(const string& name, const double time, const string& throughput) {
+	print_info(alignl(24u, name)+alignr(12u, to_string(1E3*time, 3u))+" ms  "+throughput);
+}
+string throughput(const double units, const string& unit, const double bytes, const double time) {
+	return to_string(units/time*1E-6, 2u)+" M"+unit+"/s, "+to_string(bytes/time/1048576.0, 1u)+" MB/s";
+}
+template<typename F> double best_time(F function) { // run function repetitions times and return fastest runtime in seconds
+	double time = max_double;
+	for(uint r=0u; r<repetitions; r++) {
+		Clock clock;
+		function();
+		time = fmin(time, clock.stop());
+	}
+	return time;
+}
+
+template<typename T> class Stitched_Buffer { // host buffers of a lattice split into domains, stitched with the same Domain_Stitching and write_vtk_data() as LBM::Memory_Container, which itself needs an LBM object and thus an OpenCL device
+private:
+	uint d = 1u; // buffer dimensions
+	vector<T*> buffers; // host buffers, one per domain
+	Domain_Stitching stitching;
+public:
+	inline Stitched_Buffer(const uint Nx, const uint Ny, const uint Nz, const uint Dx, const uint Dy, const uint Dz, const uint d) {
+		this->d = d;
+		stitching = Domain_Stitching(Nx, Ny, Nz, Dx, Dy, Dz);
+		for(uint domain=0u; domain<stitching.D; domain++) {
+			buffers.push_back(new T[stitching.local_N*(ulong)d]);
+			parallel_for(stitching.local_N*(ulong)d, [&](ulong i) { buffers[domain][i] = (T)(i%1000ull); });
+		}
+	}
+	inline ~Stitched_Buffer() {
+		for(uint domain=0u; domain<stitching.D; domain++) delete[] buffers[domain];
+	}
+	inline T& reference(const ulong i, const uint dimension) { // same as LBM::Memory_Container::reference(i, dimension)
+		uint domain = 0u;
+		const ulong local_i = stitching.index(i, dimension, domain);
+		return buffers[domain][local_i];
+	}
+	inline void write_vtk(const string& filename) { // same data path as LBM::Memory_Container::write_vtk(), without unit conversion
+		const string header =
+			"# vtk DataFile Version 3.0\nFluidX3D host_benchmark\nBINARY\nDATASET STRUCTURED_POINTS\n"
+			"DIMENSIONS "+to_string(stitching.Nx)+" "+to_string(stitching.Ny)+" "+to_string(stitching.Nz)+"\n"
+			"ORIGIN 0 0 0\nSPACING 1 1 1\n"
+			"POINT_DATA "+to_string(stitching.N)+"\n"
+			"SCALARS data float "+to_string(d)+"\nLOOKUP_TABLE default\n"
+		;
+		std::ofstream file(filename, std::ios::out|std::ios::binary);
+		file.write(header.c_str(), header.length());
+		write_vtk_data<T>(file, stitching.N, d, [&](const ulong n, const uint d) { return reference(n, d); });
+		file.close();
+	}
+	inline const ulong length() const { return stitching.N; }
+	inline const uint dimensions() const { return d; }
+};
+
+void write_synthetic_stl(const string& filename, const uint triangle_number) { // binary .stl file with a sphere-like random triangle soup
+	const ulong filesize = 84ull+50ull*(ulong)triangle_number;
+	uchar* data = new uchar[filesize];
+	for(uint i=0u; i<84u; i++) data[i] = 0u;
+	((uint*)data)[20] = triangle_number;
+	parallel_for(triangle_number, [&](uint i) {
+		uint seed = 42u+i;
+		float* triangle_data = (float*)(data+84ull+50ull*(ulong)i);
+		for(uint j=0u; j<12u; j++) triangle_data[j] = random_symmetric(seed, 1.0f);
+		*(ushort*)(triangle_data+12) = (ushort)0u; // attribute byte count
+	});
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write((char*)data, filesize);
+	file.close();
+	delete[] data;
+}
+void write_synthetic_sdf(const string& filename, const uint N) { // binary .sdf file of a sphere in SDFGen layout
+	const int header_int[3] = { (int)N, (int)N, (int)N };
+	const float header_float[6] = { -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	const ulong cells = (ulong)N*(ulong)N*(ulong)N;
+	float* data = new float[cells];
+	parallel_for(cells, [&](ulong n) {
+		const uint i=(uint)(n/((ulong)N*(ulong)N)), j=(uint)((n/(ulong)N)%(ulong)N), k=(uint)(n%(ulong)N); // n = i*Ny*Nz+j*Nz+k
+		const float3 p = 2.0f*float3((float)i+0.5f, (float)j+0.5f, (float)k+0.5f)/(float)N-1.0f;
+		data[n] = length(p)-0.5f;
+	});
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write((char*)header_int, sizeof(header_int));
+	file.write((char*)header_float, sizeof(header_float));
+	file.write((char*)data, cells*sizeof(float));
+	file.close();
+	delete[] data;
+}
+Image* synthetic_image(const uint width, const uint height) { // smooth gradients with some noise, to resemble a rendered frame
+	Image* image = new Image(width, height);
+	parallel_for(height, [&](uint y) {
+		uint seed = 42u+y;
+		for(uint x=0u; x<width; x++) {
+			const float fx=(float)x/(float)width, fy=(float)y/(float)height;
+			const bool background = sq(fx-0.5f)+sq(fy-0.5f)>0.1f;
+			const int noise = (int)random(seed, 8.0f);
+			image->set_color(x, y, background ? 0x000000 : color((int)(255.0f*fx)+noise, (int)(255.0f*fy), (int)(255.0f*(1.0f-fx))+noise));
+		}
+	});
+	return image;
+}
+
+void benchmark_stl(const string& path, const uint scale) {
+	const uint triangle_number = 1000000u*scale;
+	const string filename = path+"host_benchmark.stl";
+	write_synthetic_stl(filename, triangle_number);
+	const double time = best_time([&]() {
+		Mesh* mesh = read_stl(filename, float3(256.0f), float3(128.0f), float3x3(float3(0.0f, 0.0f, 1.0f), 0.5f), 0.0f);
+		delete mesh;
+	});
+	print_result("read_stl_raw()", time, throughput((double)triangle_number, "triangles", 84.0+50.0*(double)triangle_number, time));
+	std::remove(filename.c_str());
+}
+Mesh* synthetic_closed_mesh(const uint N) { // closed surface of a cube with N*N quads per face, neighboring triangles share bit-identical vertices, so it has 6*N^2+2 vertices and 12*N^2 triangles
+	Mesh* mesh = new Mesh(12u*N*N, float3(0.5f*(float)N));
+	parallel_for(6u*N, [&](uint fi) { // one row of quads per iteration
+		const uint f=fi/N, i=fi%N, a=f%3u; // face f is perpendicular to axis a
+		const float s = f<3u ? 0.0f : (float)N;
+		const auto corner = [&](const uint u, const uint v) {
+			float c[3];
+			c[a] = s;
+			c[(a+1u)%3u] = (float)u;
+			c[(a+2u)%3u] = (float)v;
+			return float3(c[0], c[1], c[2]);
+		};
+		for(uint j=0u; j<N; j++) {
+			const uint t = 2u*((f*N+i)*N+j);
+			mesh->p0[t   ] = corner(i, j   ); mesh->p1[t   ] = corner(i+1u, j); mesh->p2[t   ] = corner(i+1u, j+1u);
+			mesh->p0[t+1u] = corner(i, j   ); mesh->p1[t+1u] = corner(i+1u, j+1u); mesh->p2[t+1u] = corner(i, j+1u);
+		}
+	});
+	mesh->find_bounds();
+	return mesh;
+}
+void benchmark_index_mesh(const uint scale) { // also checks that index_mesh() finds all shared vertices and reproduces every triangle
+	const uint N = 256u*to_uint(sqrt((double)scale));
+	Mesh* mesh = synthetic_closed_mesh(N);
+	Indexed_Mesh* indexed_mesh = nullptr;
+	const double time = best_time([&]() {
+		delete indexed_mesh;
+		indexed_mesh = index_mesh(mesh);
+	});
+	print_result("index_mesh()", time, throughput((double)mesh->triangle_number, "triangles", 36.0*(double)mesh->triangle_number, time));
+	bool equal = indexed_mesh->vertex_number()==6u*N*N+2u&&indexed_mesh->triangle_number()==mesh->triangle_number;
+	const float3* p[3] = { mesh->p0, mesh->p1, mesh->p2 };
+	for(ulong n=0ull; equal&&n<3ull*(ulong)mesh->triangle_number; n++) {
+		const float3 v=indexed_mesh->vertices[indexed_mesh->triangles[n]], w=p[n%3ull][n/3ull];
+		equal = v.x==w.x&&v.y==w.y&&v.z==w.z;
+	}
+	if(equal) print_info("index_mesh() round trip: "+to_string(mesh->triangle_number)+" triangles, "+to_string(indexed_mesh->vertex_number())+" vertices");
+	else print_warning("index_mesh() does not reproduce the original mesh.");
+	delete indexed_mesh;
+	delete mesh;
+}
+void benchmark_sdf(const string& path, const uint scale) {
+	const uint N = 256u*to_uint(cbrt((double)scale));
+	const string filename = path+"host_benchmark.sdf";
+	write_synthetic_sdf(filename, N);
+	const double time = best_time([&]() {
+		SDF* sdf = read_sdf(filename);
+		delete sdf;
+	});
+	const double cells = (double)N*(double)N*(double)N;
+	print_result("read_sdf()", time, throughput(cells, "cells", 36.0+4.0*cells, time));
+	SDF* converted = read_sdf(filename);
+	write_sdf(filename, converted); // same field in x-fastest layout, loads without transpose
+	delete converted;
+	const double time_x_fastest = best_time([&]() {
+		SDF* sdf = read_sdf(filename);
+		delete sdf;
+	});
+	print_result("read_sdf() x-fastest", time_x_fastest, throughput(cells, "cells", 40.0+4.0*cells, time_x_fastest));
+	std::remove(filename.c_str());
+}
+void benchmark_reference_and_vtk(const string& path, const uint scale, const uint Dx, const uint Dy, const uint Dz) {
+	const uint N = 256u*to_uint(cbrt((double)scale));
+	Stitched_Buffer<float> u(N, N, N, Dx, Dy, Dz, 3u); // like velocity field u
+	const string domains = " ("+to_string(Dx*Dy*Dz)+" domain"+(Dx*Dy*Dz>1u ? "s" : "")+")";
+	const uint threads = (uint)thread::hardware_concurrency();
+	vector<double> sums(threads, 0.0); // one partial sum per thread, to keep reference() reads from being optimized away
+	const double time_reference = best_time([&]() {
+		parallel_for(threads, threads, [&](uint t) { // contiguous range per thread, accumulated in a register and written to sums[t] only once, to avoid false sharing
+			const ulong n0=u.length()*(ulong)t/(ulong)threads, n1=u.length()*(ulong)(t+1u)/(ulong)threads;
+			double sum = 0.0;
+			for(ulong n=n0; n<n1; n++) sum += (double)u.reference(n, 0u)+(double)u.reference(n, 1u)+(double)u.reference(n, 2u);
+			sums[t] += sum;
+		});
+	});
+	double sum = 0.0;
+	for(uint t=0u; t<threads; t++) sum += sums[t];
+	print_result("reference()"+domains, time_reference, throughput((double)u.length(), "cells", (double)u.length()*3.0*sizeof(float), time_reference));
+	if(sum==0.0) print_warning("reference() checksum is zero.");
+	const string filename = path+"host_benchmark.vtk";
+	const double time_vtk = best_time([&]() {
+		u.write_vtk(filename);
+	});
+	print_result("write_vtk()"+domains, time_vtk, throughput((double)u.length(), "cells", (double)u.length()*3.0*sizeof(float), time_vtk));
+	std::remove(filename.c_str());
+}
+void benchmark_image(const string& path, const uint scale) {
+	Image* image = synthetic_image(1920u*to_uint(sqrt((double)scale)), 1080u*to_uint(sqrt((double)scale)));
+	const double pixels=(double)image->length(), bytes=3.0*pixels;
+	const string filename = path+"host_benchmark";
+	for(uint level=0u; level<=3u; level++) { // 0 (no compression) to 3 (smallest file size)
+		const double time_png = best_time([&]() {
+			write_png(filename+".png", image, level);
+		});
+		print_result("write_png() level "+to_string(level), time_png, throughput(pixels, "pixels", bytes, time_png));
+	}
+	const double time_qoi_serial = best_time([&]() {
+		write_qoi(filename+".qoi", image, 1u);
+	});
+	print_result("write_qoi() 1 thread", time_qoi_serial, throughput(pixels, "pixels", bytes, time_qoi_serial));
+	const double time_qoi = best_time([&]() {
+		write_qoi(filename+".qoi", image);
+	});
+	print_result("write_qoi()", time_qoi, throughput(pixels, "pixels", bytes, time_qoi));
+	Image* decoded = nullptr;
+	const double time_read_qoi = best_time([&]() {
+		decoded = read_qoi(filename+".qoi", decoded);
+	});
+	print_result("read_qoi()", time_read_qoi, throughput(pixels, "pixels", bytes, time_read_qoi));
+	for(uint i=0u; i<image->length(); i++) {
+		if((decoded->color(i)&0x00FFFFFF)!=(image->color(i)&0x00FFFFFF)) {
+			print_warning("read_qoi() does not reproduce the image written by write_qoi().");
+			break;
+		}
+	}
+	delete decoded;
+	std::remove((filename+".png").c_str());
+	std::remove((filename+".qoi").c_str());
+	delete image;
+}
+
+Image* noise_image(const uint width, const uint height, const float density) { // random colors in a fraction density of the pixels, black elsewhere; density 1 is incompressible, small density gives very skewed symbol frequencies
+	Image* image = new Image(width, height);
+	parallel_for(height, [&](uint y) {
+		uint seed = 1337u+y;
+		for(uint x=0u; x<width; x++) image->set_color(x, y, random(seed)<density ? (int)(random(seed, 16777215.0f)) : 0x000000);
+	});
+	return image;
+}
+bool png_round_trip(const string& filename, const Image* image, const uint level) { // write image with write_png() and decode it with lodepng, returns true if all pixels are reproduced exactly
+	write_png(filename, image, level);
+	vector<uchar> data;
+	uint width=0u, height=0u;
+	const uint error = lodepng::decode(data, width, height, filename, LCT_RGB);
+	bool equal = error==0u&&width==image->width()&&height==image->height();
+	for(uint i=0u; equal&&i<image->length(); i++) equal = (data[3u*i]<<16|data[3u*i+1u]<<8|data[3u*i+2u])==(image->color(i)&0x00FFFFFF);
+	if(!equal) print_warning("write_png() level "+to_string(level)+" of a "+to_string(image->width())+"x"+to_string(image->height())+" image does not decode to the original image"+(error ? " (lodepng: "+string(lodepng_error_text(error))+")" : "")+".");
+	return equal;
+}
+void check_png(const string& path) { // decode write_png() output of all levels with lodepng, for odd widths, single strips, strips that end exactly at the last row, and smooth, noisy and sparse content, and check that empty images are skipped
+	const uint sizes[7][2] = { { 1u, 1u }, { 7u, 3u }, { 333u, 17u }, { 1001u, 87u }, { 1001u, 174u }, { 1001u, 300u }, { 1920u, 1080u } }; // 1001 wide images have 87 rows per strip
+	const string filename = path+"host_benchmark_check.png";
+	uint images=0u, failed=0u;
+	for(uint i=0u; i<7u; i++) {
+		Image* content[3] = { synthetic_image(sizes[i][0], sizes[i][1]), noise_image(sizes[i][0], sizes[i][1], 1.0f), noise_image(sizes[i][0], sizes[i][1], 0.001f) };
+		for(uint c=0u; c<3u; c++) {
+			for(uint level=0u; level<=3u; level++) {
+				images++;
+				failed += !png_round_trip(filename, content[c], level);
+			}
+			delete content[c];
+		}
+	}
+	std::remove(filename.c_str());
+	for(uint i=0u; i<2u; i++) { // images without pixels are skipped, PNG does not allow them
+		Image* empty = new Image(i==0u ? 10u : 0u, i==0u ? 0u : 10u);
+		for(uint level=0u; level<=3u; level++) {
+			images++;
+			write_png(filename, empty, level);
+			const bool written = std::ifstream(filename).good();
+			if(written) print_warning("write_png() level "+to_string(level)+" of a "+to_string(empty->width())+"x"+to_string(empty->height())+" image writes a file.");
+			failed += written;
+			std::remove(filename.c_str());
+		}
+		delete empty;
+	}
+	if(failed==0u) print_info("write_png() round trip: "+to_string(images)+" images decoded exactly by lodepng");
+	else print_warning("write_png() round trip: "+to_string(failed)+" of "+to_string(images)+" images are not decoded exactly by lodepng.");
+}
+
+int main(int argc, char* argv[]) {
+	const uint scale = argc>1 ? max(to_uint(string(argv[1]), 1u), 1u) : 1u;
+	const string path = get_exe_path(); // temporary files are written next to the executable and deleted afterwards
+	print_info("Host microbenchmark, scale "+to_string(scale)+", "+to_string(thread::hardware_concurrency())+" threads, fastest of "+to_string(repetitions)+" runs");
+	benchmark_stl(path, scale);
+	benchmark_index_mesh(scale);
+	benchmark_sdf(path, scale);
+	benchmark_reference_and_vtk(path, scale, 1u, 1u, 1u);
+	benchmark_reference_and_vtk(path, scale, 2u, 2u, 2u);
+	benchmark_image(path, scale);
+	check_png(path);
+	return 0;
+}
@@ -12,6 +12,8 @@
 
 //#define FP16S // optional for 2x speedup and 2x VRAM footprint reduction: compress LBM DDFs to range-shifted IEEE-754 FP16; number conversion is done in hardware; all arithmetic is still done in FP32
 #define FP16C // optional for 2x speedup and 2x VRAM footprint reduction: compress LBM DDFs to more accurate custom FP16C format; number conversion is emulated in software; all arithmetic is still done in FP32
+//#define TEMPORAL_BLOCKING 2 // optional for CPUs with large caches: perform 2 (or more) time steps per kernel launch on cache-resident tiles to reduce memory bandwidth; allocates an extra 76 (FP32) or 38 (FP16) Bytes/cell (D3Q19); single-domain only, not compatible with SURFACE, TEMPERATURE or PARTICLES
+//#define ACTIVE_CELLS // optional for setups with many solid or gas cells: stream_collide only runs over a compacted list of non-solid and non-gas cells that is rebuilt when flags change; allocates an extra 4 Bytes/cell
 
 //#define BENCHMARK // disable all extensions and setups and run benchmark setup instead
 
@@ -98,6 +100,8 @@
 #define UPDATE_FIELDS // update (rho, u, T) in every LBM step
 #endif // PARTICLES
 
+#include "headless.hpp" // HEADLESS build: interactive graphics modes fall back to GRAPHICS
+
 #if defined(INTERACTIVE_GRAPHICS) || defined(INTERACTIVE_GRAPHICS_ASCII)
 #define GRAPHICS
 #define UPDATE_FIELDS // to prevent flickering artifacts in interactive graphics
@@ -16,17 +16,17 @@ void main_setup() { // radial fan; required extensions in defines.hpp: FP16S, MO
 	// ###################################################################################### define geometry ######################################################################################
 	const float radius = 0.25f*(float)lbm_N.x;
 	const float3 center = float3(lbm.center().x, lbm.center().y, 0.36f*radius);
-	const float lbm_omega=lbm_u/radius, lbm_domega=lbm_omega*lbm_dt;
+	const float lbm_omega=lbm_u/radius;
 	Mesh* mesh = read_stl(get_resource_path("FAN_Solid_Bottom.stl"), lbm.size(), center, 2.0f*radius); // https://www.thingiverse.com/thing:6113/files
 	const uint Nx=lbm.get_Nx(), Ny=lbm.get_Ny(), Nz=lbm.get_Nz(); parallel_for(lbm.get_N(), [&](ulong n) { uint x=0u, y=0u, z=0u; lbm.coordinates(n, x, y, z);
 		if(x==0u||x==Nx-1u||y==0u||y==Ny-1u||z==0u) lbm.flags[n] = TYPE_S; // all non periodic
 	}); // ####################################################################### run simulation, export images and data ##########################################################################
+	const uint mesh_handle = lbm.upload_rigid_mesh(mesh, float3(0.0f, 0.0f, 1.0f)); // upload mesh to device memory once
 	lbm.graphics.visualization_modes = VIS_FLAG_LATTICE|VIS_FLAG_SURFACE|VIS_Q_CRITERION;
 	lbm.run(0u, lbm_T); // initialize simulation
 	while(lbm.get_t()<lbm_T) { // main simulation loop
-		lbm.voxelize_mesh_on_device(mesh, TYPE_S, center, float3(0.0f), float3(0.0f, 0.0f, lbm_omega));
+		lbm.voxelize_rigid_mesh_on_device(mesh_handle, float3x3(float3(0.0f, 0.0f, 1.0f), lbm_omega*(float)lbm.get_t()), float3(0.0f), TYPE_S, center, float3(0.0f), float3(0.0f, 0.0f, lbm_omega)); // mesh stays in device memory, only its rotation is updated
 		lbm.run(lbm_dt, lbm_T);
-		mesh->rotate(float3x3(float3(0.0f, 0.0f, 1.0f), lbm_domega)); // rotate mesh
 #if defined(GRAPHICS) && !defined(INTERACTIVE_GRAPHICS)
 		if(lbm.graphics.next_frame(lbm_T, 30.0f)) {
 			lbm.graphics.set_camera_free(float3(0.353512f*(float)Nx, -0.150326f*(float)Ny, 1.643939f*(float)Nz), -25.0f, 61.0f, 100.0f);
@@ -809,7 +809,7 @@ int main(int argc, char* argv[]) {
 	thread compute_thread(main_physics); // start main_physics() in a new thread
 	while(running) {
 		// main loop ################################################################
-		main_label(1.0);
+		main_label(1.0); // only prints progress to the console, frames are rendered and exported by main_physics()
 		sleep(0.050);
 		// ##########################################################################
 	}
@@ -343,6 +343,7 @@ extern bool key_1, key_2, key_3, key_4, key_5, key_6, key_7, key_8, key_9, key_0
 #define FONT_WIDTH 6 // default: 6
 
 void set_light(const uint i, const float3& p);
+bool convert(int& rx, int& ry, float& rz, const float3& p, const int stereo); // 3D -> 2D, returns false if point is behind camera
 
 void draw_bitmap(int* bitmap);
 void draw_label(const int x, const int y, const string& s, const int color);
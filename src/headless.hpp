@@ -0,0 +1,10 @@
+#pragma once
+
+// included by every defines.hpp after the graphics mode is chosen and before UPDATE_FIELDS is derived from it
+#ifdef HEADLESS // headless build (CMake option FLUIDX3D_HEADLESS): frame export only, without any window system code or keyboard input, so no display and no X11 are needed
+#if defined(INTERACTIVE_GRAPHICS) || defined(INTERACTIVE_GRAPHICS_ASCII)
+#define GRAPHICS
+#endif // INTERACTIVE_GRAPHICS || INTERACTIVE_GRAPHICS_ASCII
+#undef INTERACTIVE_GRAPHICS
+#undef INTERACTIVE_GRAPHICS_ASCII
+#endif // HEADLESS
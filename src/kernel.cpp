@@ -365,6 +365,8 @@ string opencl_c_container() { return R( // ########################## begin of O
 	bitmap[n] = def_background_color; // black background = 0x000000, use 0xFFFFFF for white background
 	zbuffer[n] = -2147483648;
 }
+)+"#endif"+R( // GRAPHICS
+
 )+R(constant uchar triangle_table_data[1920] = { // source: Paul Bourke, http://paulbourke.net/geometry/polygonise/, termination value 15, bit packed
 	255,255,255,255,255,255,255, 15, 56,255,255,255,255,255,255, 16,249,255,255,255,255,255, 31, 56,137,241,255,255,255,255, 33,250,255,255,255,255,255, 15, 56, 33,250,255,255,255,255, 41, 10,146,
 	255,255,255,255, 47, 56,162,168,137,255,255,255,179,242,255,255,255,255,255, 15, 43,184,240,255,255,255,255,145, 32,179,255,255,255,255, 31, 43,145,155,184,255,255,255,163,177, 58,255,255,255,
@@ -439,6 +441,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 	}
 	return i/3u; // return number of triangles
 }
+)+"#ifdef GRAPHICS"+R(
 )+R(uint marching_cubes_halfway(const bool* v, float3* triangles) { // input: 8 bool values v; output: returns number of triangles, 15 triangle vertices t
 	uint cube = 0u; // determine index of which vertices are inside of the isosurface
 	for(uint i=0u; i<8u; i++) cube |= (uint)(!v[i])<<i;
@@ -1467,104 +1470,24 @@ string opencl_c_container() { return R( // ########################## begin of O
 
 
 
-)+R(kernel void stream_collide)+"("+R(global fpxx* fi, global float* rho, global float* u, global uchar* flags, const ulong t, const float fx, const float fy, const float fz // ) { // main LBM kernel
-)+"#ifdef FORCE_FIELD"+R(
-	, const global float* F // argument order is important
-)+"#endif"+R( // FORCE_FIELD
-)+"#ifdef SURFACE"+R(
-	, const global float* mass // argument order is important
-)+"#endif"+R( // SURFACE
-)+"#ifdef TEMPERATURE"+R(
-	, global fpxx* gi, global float* T // argument order is important
-)+"#endif"+R( // TEMPERATURE
-)+") {"+R( // stream_collide()
-	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
-	if(n>=(uxx)def_N||is_halo(n)) return; // don't execute stream_collide() on halo
-	const uchar flagsn = flags[n]; // cache flags[n] for multiple readings
-	const uchar flagsn_bo=flagsn&TYPE_BO, flagsn_su=flagsn&TYPE_SU; // extract boundary and surface flags
-	if(flagsn_bo==TYPE_S||flagsn_su==TYPE_G) return; // if cell is solid boundary or gas, just return
-
-	uxx j[def_velocity_set]; // neighbor indices
-	neighbors(n, j); // calculate neighbor indices
-
-	float fhn[def_velocity_set]; // local DDFs
-	load_f(n, fhn, fi, j, t); // perform streaming (part 2)
-
-)+"#ifdef MOVING_BOUNDARIES"+R(
-	if(flagsn_bo==TYPE_MS) apply_moving_boundaries(fhn, j, u, flags); // apply Dirichlet velocity boundaries if necessary (reads velocities of only neighboring boundary cells, which do not change during simulation)
-)+"#endif"+R( // MOVING_BOUNDARIES
-
-	float rhon, uxn, uyn, uzn; // calculate local density and velocity for collision
+)+R(void calculate_rho_u_boundaries(const uxx n, const uchar flagsn_bo, const float* fhn, const global float* rho, const global float* u, float* rhon, float* uxn, float* uyn, float* uzn) { // calculate density and velocity from fhn, or apply preset velocity/density of equilibrium boundaries
 )+"#ifndef EQUILIBRIUM_BOUNDARIES"+R(
-	calculate_rho_u(fhn, &rhon, &uxn, &uyn, &uzn); // calculate density and velocity fields from fi
+	calculate_rho_u(fhn, rhon, uxn, uyn, uzn); // calculate density and velocity fields from fi
 )+"#else"+R( // EQUILIBRIUM_BOUNDARIES
 	if(flagsn_bo==TYPE_E) {
-		rhon = rho[               n]; // apply preset velocity/density
-		uxn  = u[                 n];
-		uyn  = u[    def_N+(ulong)n];
-		uzn  = u[2ul*def_N+(ulong)n];
+		*rhon = rho[               n]; // apply preset velocity/density
+		*uxn  = u[                 n];
+		*uyn  = u[    def_N+(ulong)n];
+		*uzn  = u[2ul*def_N+(ulong)n];
 	} else {
-		calculate_rho_u(fhn, &rhon, &uxn, &uyn, &uzn); // calculate density and velocity fields from fi
+		calculate_rho_u(fhn, rhon, uxn, uyn, uzn); // calculate density and velocity fields from fi
 	}
 )+"#endif"+R( // EQUILIBRIUM_BOUNDARIES
-	float fxn=fx, fyn=fy, fzn=fz; // force starts as constant volume force, can be modified before call of calculate_forcing_terms(...)
+} // calculate_rho_u_boundaries()
+)+R(void collide(const uxx n, const uchar flagsn_bo, float* fhn, const float rhon, float uxn, float uyn, float uzn, const float fxn, const float fyn, const float fzn, global float* rho, global float* u, const bool update_fields) { // apply volume force, update fields and perform collision (SRT or TRT) on fhn, shared by stream_collide() and stream_collide_tb()
 	float Fin[def_velocity_set]; // forcing terms
-
-)+"#ifdef FORCE_FIELD"+R(
-	{ // separate block to avoid variable name conflicts
-		fxn += F[                 n]; // apply force field
-		fyn += F[    def_N+(ulong)n];
-		fzn += F[2ul*def_N+(ulong)n];
-	}
-)+"#endif"+R( // FORCE_FIELD
-
-)+"#ifdef SURFACE"+R(
-	if(flagsn_su==TYPE_I) { // cell was interface, eventually initiate flag change
-		bool TYPE_NO_F=true, TYPE_NO_G=true; // temporary flags for no fluid or gas neighbors
-		for(uint i=1u; i<def_velocity_set; i++) {
-			const uchar flagsji_su = flags[j[i]]&TYPE_SU; // extract SURFACE flags
-			TYPE_NO_F = TYPE_NO_F&&flagsji_su!=TYPE_F;
-			TYPE_NO_G = TYPE_NO_G&&flagsji_su!=TYPE_G;
-		}
-		const float massn = mass[n]; // load mass
-		     if(massn>rhon || TYPE_NO_G) flags[n] = (flagsn&~TYPE_SU)|TYPE_IF; // set flag interface->fluid
-		else if(massn<0.0f || TYPE_NO_F) flags[n] = (flagsn&~TYPE_SU)|TYPE_IG; // set flag interface->gas
-	}
-)+"#endif"+R( // SURFACE
-
-)+"#ifdef TEMPERATURE"+R(
-	{ // separate block to avoid variable name conflicts
-		uxx j7[7]; // neighbors of D3Q7 subset
-		neighbors_temperature(n, j7);
-		float ghn[7]; // read from gA and stream to gh (D3Q7 subset, periodic boundary conditions)
-		load_g(n, ghn, gi, j7, t); // perform streaming (part 2)
-		float Tn;
-		if(flagsn&TYPE_T) {
-			Tn = T[n]; // apply preset temperature
-		} else {
-			Tn = 0.0f;
-			for(uint i=0u; i<7u; i++) Tn += ghn[i]; // calculate temperature from g
-			Tn += 1.0f; // add 1.0f last to avoid digit extinction effects when summing up gi (perturbation method / DDF-shifting)
-		}
-		float geq[7]; // cache f_equilibrium[n]
-		calculate_g_eq(Tn, uxn, uyn, uzn, geq); // calculate equilibrium DDFs
-		if(flagsn&TYPE_T) {
-			for(uint i=0u; i<7u; i++) ghn[i] = geq[i]; // just write geq to ghn (no collision)
-		} else {
-)+"#ifdef UPDATE_FIELDS"+R(
-			T[n] = Tn; // update temperature field
-)+"#endif"+R( // UPDATE_FIELDS
-			for(uint i=0u; i<7u; i++) ghn[i] = fma(1.0f-def_w_T, ghn[i], def_w_T*geq[i]); // perform collision
-		}
-		store_g(n, ghn, gi, j7, t); // perform streaming (part 1)
-		fxn -= fx*def_beta*(Tn-def_T_avg);
-		fyn -= fy*def_beta*(Tn-def_T_avg);
-		fzn -= fz*def_beta*(Tn-def_T_avg);
-	}
-)+"#endif"+R( // TEMPERATURE
-
 	{ // separate block to avoid variable name conflicts
-)+"#ifdef VOLUME_FORCE"+R( // apply force and collision operator, write to fi in video memory
+)+"#ifdef VOLUME_FORCE"+R( // apply force and collision operator
 		const float rho2 = 0.5f/rhon; // apply external volume force (Guo forcing, Krueger p.233f)
 		uxn = clamp(fma(fxn, rho2, uxn), -def_c, def_c); // limit velocity (for stability purposes)
 		uyn = clamp(fma(fyn, rho2, uyn), -def_c, def_c); // force term: F*dt/(2*rho)
@@ -1579,6 +1502,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 	}
 
 )+"#ifdef UPDATE_FIELDS"+R(
+	if(update_fields) // stream_collide_tb() only updates fields in its last time step
 )+"#ifdef EQUILIBRIUM_BOUNDARIES"+R(
 	if(flagsn_bo!=TYPE_E) // only update fields for non-TYPE_E cells
 )+"#endif"+R( // EQUILIBRIUM_BOUNDARIES
@@ -1649,14 +1573,240 @@ string opencl_c_container() { return R( // ########################## begin of O
 	for(uint i=0u; i<def_velocity_set; i++) fhn[i] = flagsn_bo==TYPE_E ? feq[i] : fma(0.5f*wp, feq[i]-fhn[i]+feb[i]-fhb[i], fma(0.5f*wm, feq[i]-feb[i]-fhn[i]+fhb[i], fhn[i]+Fin[i])); // perform collision (TRT)
 )+"#endif"+R( // EQUILIBRIUM_BOUNDARIES
 )+"#endif"+R( // TRT
+} // collide()
+
+)+R(kernel void stream_collide)+"("+R(global fpxx* fi, global float* rho, global float* u, global uchar* flags, const ulong t, const float fx, const float fy, const float fz // ) { // main LBM kernel
+)+"#ifdef FORCE_FIELD"+R(
+	, const global float* F // argument order is important
+)+"#endif"+R( // FORCE_FIELD
+)+"#ifdef SURFACE"+R(
+	, const global float* mass // argument order is important
+)+"#endif"+R( // SURFACE
+)+"#ifdef TEMPERATURE"+R(
+	, global fpxx* gi, global float* T // argument order is important
+)+"#endif"+R( // TEMPERATURE
+)+"#ifdef ACTIVE_CELLS"+R(
+	, const global uint* active_cells, const global uint* active_count // argument order is important
+)+"#endif"+R( // ACTIVE_CELLS
+)+") {"+R( // stream_collide()
+)+"#ifndef ACTIVE_CELLS"+R(
+	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
+	if(n>=(uxx)def_N||is_halo(n)) return; // don't execute stream_collide() on halo
+)+"#else"+R( // ACTIVE_CELLS
+	if(get_global_id(0)>=(uxx)active_count[0]) return; // range may be larger than number of active cells, remaining work-items return in whole work-groups
+	const uxx n = (uxx)active_cells[get_global_id(0)]; // only iterate over compacted list of active cells, halo is already excluded there
+)+"#endif"+R( // ACTIVE_CELLS
+	const uchar flagsn = flags[n]; // cache flags[n] for multiple readings
+	const uchar flagsn_bo=flagsn&TYPE_BO, flagsn_su=flagsn&TYPE_SU; // extract boundary and surface flags
+	if(flagsn_bo==TYPE_S||flagsn_su==TYPE_G) return; // if cell is solid boundary or gas, just return
+
+	uxx j[def_velocity_set]; // neighbor indices
+	neighbors(n, j); // calculate neighbor indices
+
+	float fhn[def_velocity_set]; // local DDFs
+	load_f(n, fhn, fi, j, t); // perform streaming (part 2)
+
+)+"#ifdef MOVING_BOUNDARIES"+R(
+	if(flagsn_bo==TYPE_MS) apply_moving_boundaries(fhn, j, u, flags); // apply Dirichlet velocity boundaries if necessary (reads velocities of only neighboring boundary cells, which do not change during simulation)
+)+"#endif"+R( // MOVING_BOUNDARIES
+
+	float rhon, uxn, uyn, uzn; // calculate local density and velocity for collision
+	calculate_rho_u_boundaries(n, flagsn_bo, fhn, rho, u, &rhon, &uxn, &uyn, &uzn);
+	float fxn=fx, fyn=fy, fzn=fz; // force starts as constant volume force, can be modified before call of collide(...)
+
+)+"#ifdef FORCE_FIELD"+R(
+	{ // separate block to avoid variable name conflicts
+		fxn += F[                 n]; // apply force field
+		fyn += F[    def_N+(ulong)n];
+		fzn += F[2ul*def_N+(ulong)n];
+	}
+)+"#endif"+R( // FORCE_FIELD
+
+)+"#ifdef SURFACE"+R(
+	if(flagsn_su==TYPE_I) { // cell was interface, eventually initiate flag change
+		bool TYPE_NO_F=true, TYPE_NO_G=true; // temporary flags for no fluid or gas neighbors
+		for(uint i=1u; i<def_velocity_set; i++) {
+			const uchar flagsji_su = flags[j[i]]&TYPE_SU; // extract SURFACE flags
+			TYPE_NO_F = TYPE_NO_F&&flagsji_su!=TYPE_F;
+			TYPE_NO_G = TYPE_NO_G&&flagsji_su!=TYPE_G;
+		}
+		const float massn = mass[n]; // load mass
+		     if(massn>rhon || TYPE_NO_G) flags[n] = (flagsn&~TYPE_SU)|TYPE_IF; // set flag interface->fluid
+		else if(massn<0.0f || TYPE_NO_F) flags[n] = (flagsn&~TYPE_SU)|TYPE_IG; // set flag interface->gas
+	}
+)+"#endif"+R( // SURFACE
+
+)+"#ifdef TEMPERATURE"+R(
+	{ // separate block to avoid variable name conflicts
+		uxx j7[7]; // neighbors of D3Q7 subset
+		neighbors_temperature(n, j7);
+		float ghn[7]; // read from gA and stream to gh (D3Q7 subset, periodic boundary conditions)
+		load_g(n, ghn, gi, j7, t); // perform streaming (part 2)
+		float Tn;
+		if(flagsn&TYPE_T) {
+			Tn = T[n]; // apply preset temperature
+		} else {
+			Tn = 0.0f;
+			for(uint i=0u; i<7u; i++) Tn += ghn[i]; // calculate temperature from g
+			Tn += 1.0f; // add 1.0f last to avoid digit extinction effects when summing up gi (perturbation method / DDF-shifting)
+		}
+		float geq[7]; // cache f_equilibrium[n]
+		calculate_g_eq(Tn, uxn, uyn, uzn, geq); // calculate equilibrium DDFs
+		if(flagsn&TYPE_T) {
+			for(uint i=0u; i<7u; i++) ghn[i] = geq[i]; // just write geq to ghn (no collision)
+		} else {
+)+"#ifdef UPDATE_FIELDS"+R(
+			T[n] = Tn; // update temperature field
+)+"#endif"+R( // UPDATE_FIELDS
+			for(uint i=0u; i<7u; i++) ghn[i] = fma(1.0f-def_w_T, ghn[i], def_w_T*geq[i]); // perform collision
+		}
+		store_g(n, ghn, gi, j7, t); // perform streaming (part 1)
+		fxn -= fx*def_beta*(Tn-def_T_avg);
+		fyn -= fy*def_beta*(Tn-def_T_avg);
+		fzn -= fz*def_beta*(Tn-def_T_avg);
+	}
+)+"#endif"+R( // TEMPERATURE
+
+	collide(n, flagsn_bo, fhn, rhon, uxn, uyn, uzn, fxn, fyn, fzn, rho, u, true); // apply volume force, update fields and perform collision
 
 	store_f(n, fhn, fi, j, t); // perform streaming (part 1)
 } // stream_collide()
 
+)+"#ifdef ACTIVE_CELLS"+R(
+)+R(kernel void update_active_cells(const global uchar* flags, global uint* active_cells, volatile global uint* active_count) { // compact indices of all non-solid and non-gas cells into active_cells, active_count has to be reset to 0 before
+	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
+	local uint local_count, local_offset; // number of active cells in this work-group and their offset in active_cells
+	if(get_local_id(0)==0u) local_count = 0u;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	bool active = false;
+	if(n<(uxx)def_N&&!is_halo(n)) { // no early return here because of barriers
+		const uchar flagsn = flags[n];
+		active = (flagsn&TYPE_BO)!=TYPE_S&&(flagsn&TYPE_SU)!=TYPE_G; // same condition as in stream_collide()
+	}
+	const uint local_index = active ? atomic_inc(&local_count) : 0u;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if(get_local_id(0)==0u) local_offset = atomic_add(active_count, local_count); // only one global atomic per work-group, cells of one work-group stay close together in active_cells
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if(active) active_cells[local_offset+local_index] = (uint)n;
+} // update_active_cells()
+)+"#endif"+R( // ACTIVE_CELLS
+
+)+"#ifdef TEMPORAL_BLOCKING"+R(
+)+R(uint3 coordinates_tb(const uint r) { // disassemble 1D index within temporal blocking region to 3D coordinates (r -> x,y,z)
+	const uint x = r%def_tb_Rx; // r = x+(y+z*Ry)*Rx
+	const uint y = (r/def_tb_Rx)%def_tb_Ry;
+	const uint z = r/(def_tb_Rx*def_tb_Ry);
+	return (uint3)(x, y, z);
+}
+)+R(uxx index_tb(const uint r, const int3 o) { // global lattice index of region cell r for region origin o (periodic boundary conditions)
+	const int3 xyz = convert_int3(coordinates_tb(r))+o;
+	return index((uint3)((uint)((xyz.x%(int)def_Nx+(int)def_Nx)%(int)def_Nx), (uint)((xyz.y%(int)def_Ny+(int)def_Ny)%(int)def_Ny), (uint)((xyz.z%(int)def_Nz+(int)def_Nz)%(int)def_Nz)));
+}
+)+R(void neighbors_tb(const uint r, uint* jr) { // neighbor indices within temporal blocking region, no wrap-around, only valid for cells not on the region boundary
+	for(uint i=0u; i<def_velocity_set; i++) jr[i] = (uint)((int)r+(int)c(i)+((int)c(def_velocity_set+i)+(int)c(2u*def_velocity_set+i)*(int)def_tb_Ry)*(int)def_tb_Rx);
+}
+)+R(void load_f_tb(const uint r, float* fhn, const global float* fr, const uint* jr, const ulong t) { // Esoteric-Pull within region buffer fr, same as load_f()
+	fhn[0] = fr[r]; // Esoteric-Pull
+	for(uint i=1u; i<def_velocity_set; i+=2u) {
+		fhn[i   ] = fr[(t%2ul ? i    : i+1u)*def_tb_R+r    ];
+		fhn[i+1u] = fr[(t%2ul ? i+1u : i   )*def_tb_R+jr[i]];
+	}
+}
+)+R(void store_f_tb(const uint r, const float* fhn, global float* fr, const uint* jr, const ulong t) { // Esoteric-Pull within region buffer fr, same as store_f()
+	fr[r] = fhn[0]; // Esoteric-Pull
+	for(uint i=1u; i<def_velocity_set; i+=2u) {
+		fr[(t%2ul ? i+1u : i   )*def_tb_R+jr[i]] = fhn[i   ];
+		fr[(t%2ul ? i    : i+1u)*def_tb_R+r    ] = fhn[i+1u];
+	}
+}
+)+R(kernel void stream_collide_tb)+"("+R(const global fpxx* fi, global fpxx* fo, global float* scratch, global float* rho, global float* u, const global uchar* flags, const ulong t, const float fx, const float fy, const float fz // ) { // temporally blocked LBM kernel, performs def_tb_steps time steps on cache-resident tiles, reads fi and writes fo
+)+"#ifdef FORCE_FIELD"+R(
+	, const global float* F // argument order is important
+)+"#endif"+R( // FORCE_FIELD
+)+") {"+R( // stream_collide_tb()
+	global float* fr = scratch+(ulong)get_group_id(0)*(ulong)(def_velocity_set*def_tb_R); // each work-group has its own region buffer (tile plus halo), small enough to stay in cache
+	const uint tiles_x=(def_Nx+def_tb_Tx-1u)/def_tb_Tx, tiles_y=(def_Ny+def_tb_Ty-1u)/def_tb_Ty, tiles_z=(def_Nz+def_tb_Tz-1u)/def_tb_Tz;
+	for(uint tile=get_group_id(0); tile<tiles_x*tiles_y*tiles_z; tile+=get_num_groups(0)) { // work-groups iterate over tiles
+		const uint3 ot = (uint3)((tile%tiles_x)*def_tb_Tx, ((tile/tiles_x)%tiles_y)*def_tb_Ty, (tile/(tiles_x*tiles_y))*def_tb_Tz); // tile origin
+		const int3 o = convert_int3(ot)-(int3)((int)def_tb_Hx, (int)def_tb_Hy, (int)def_tb_Hz); // region origin
+		for(uint r=get_local_id(0); r<def_tb_R; r+=get_local_size(0)) { // copy DDFs of tile and halo into region buffer
+			const uxx n = index_tb(r, o);
+			for(uint i=0u; i<def_velocity_set; i++) fr[i*def_tb_R+r] = load(fi, index_f(n, i));
+		}
+		barrier(CLK_GLOBAL_MEM_FENCE);
+		for(uint s=1u; s<=def_tb_steps; s++) { // with every time step, the valid part of the region shrinks by one cell on each side
+			const ulong ts = t+(ulong)(s-1u); // time step
+			for(uint r=get_local_id(0); r<def_tb_R; r+=get_local_size(0)) {
+				const uint3 xyz = coordinates_tb(r);
+				if(xyz.x<s||xyz.x>=def_tb_Rx-s||xyz.y<s||xyz.y>=def_tb_Ry-s||(def_tb_Hz>0u&&(xyz.z<s||xyz.z>=def_tb_Rz-s))) continue; // cell is outside of valid part of region
+				const uxx n = index_tb(r, o);
+				const uchar flagsn = flags[n]; // cache flags[n] for multiple readings
+				const uchar flagsn_bo = flagsn&TYPE_BO; // extract boundary flags
+				if(flagsn_bo==TYPE_S) continue; // if cell is solid boundary, skip it (same as in stream_collide())
+
+				uint jr[def_velocity_set]; // neighbor indices within region
+				neighbors_tb(r, jr);
+				float fhn[def_velocity_set]; // local DDFs
+				load_f_tb(r, fhn, fr, jr, ts); // perform streaming (part 2)
+
+)+"#ifdef MOVING_BOUNDARIES"+R(
+				if(flagsn_bo==TYPE_MS) {
+					uxx j[def_velocity_set]; // global neighbor indices
+					neighbors(n, j);
+					apply_moving_boundaries(fhn, j, u, flags); // apply Dirichlet velocity boundaries if necessary
+				}
+)+"#endif"+R( // MOVING_BOUNDARIES
+
+				float rhon, uxn, uyn, uzn; // calculate local density and velocity for collision
+				calculate_rho_u_boundaries(n, flagsn_bo, fhn, rho, u, &rhon, &uxn, &uyn, &uzn);
+				float fxn=fx, fyn=fy, fzn=fz; // force starts as constant volume force
+)+"#ifdef FORCE_FIELD"+R(
+				fxn += F[                 n]; // apply force field
+				fyn += F[    def_N+(ulong)n];
+				fzn += F[2ul*def_N+(ulong)n];
+)+"#endif"+R( // FORCE_FIELD
+				const bool update_fields = s==def_tb_steps&&ot.x+xyz.x-def_tb_Hx<def_Nx&&ot.y+xyz.y-def_tb_Hy<def_Ny&&ot.z+xyz.z-def_tb_Hz<def_Nz; // only update fields in last time step, for tile cells within the lattice
+				collide(n, flagsn_bo, fhn, rhon, uxn, uyn, uzn, fxn, fyn, fzn, rho, u, update_fields); // apply volume force, update fields and perform collision, same as in stream_collide()
+
+				store_f_tb(r, fhn, fr, jr, ts); // perform streaming (part 1)
+			}
+			barrier(CLK_GLOBAL_MEM_FENCE); // time step has to be complete on the whole region before the next one starts
+		}
+		const ulong tl = t+(ulong)(def_tb_steps-1u); // last time step
+		for(uint r=get_local_id(0); r<def_tb_R; r+=get_local_size(0)) { // write DDFs of tile cells back, each cell writes the slots it owns in the last time step (same as store_f()), also for solid cells
+			const uint3 xyz = coordinates_tb(r);
+			if(xyz.x<def_tb_Hx||xyz.x>=def_tb_Hx+def_tb_Tx||xyz.y<def_tb_Hy||xyz.y>=def_tb_Hy+def_tb_Ty||xyz.z<def_tb_Hz||xyz.z>=def_tb_Hz+def_tb_Tz) continue; // cell is in halo
+			if(ot.x+xyz.x-def_tb_Hx>=def_Nx||ot.y+xyz.y-def_tb_Hy>=def_Ny||ot.z+xyz.z-def_tb_Hz>=def_Nz) continue; // cell is beyond lattice boundary in partial tile
+			const uxx n = index_tb(r, o);
+			uxx j[def_velocity_set]; // global neighbor indices
+			neighbors(n, j);
+			uint jr[def_velocity_set]; // neighbor indices within region
+			neighbors_tb(r, jr);
+			store(fo, index_f(n, 0u), fr[r]);
+			for(uint i=1u; i<def_velocity_set; i+=2u) {
+				const uint ia=tl%2ul ? i+1u : i, ib=tl%2ul ? i : i+1u;
+				store(fo, index_f(j[i], ia), fr[ia*def_tb_R+jr[i]]);
+				store(fo, index_f(n   , ib), fr[ib*def_tb_R+r    ]);
+			}
+		}
+		barrier(CLK_GLOBAL_MEM_FENCE); // region buffer is reused for next tile
+	}
+} // stream_collide_tb()
+)+"#endif"+R( // TEMPORAL_BLOCKING
+
 )+"#ifdef SURFACE"+R(
-)+R(kernel void surface_0(global fpxx* fi, const global float* rho, const global float* u, const global uchar* flags, global float* mass, const global float* massex, const global float* phi, const ulong t, const float fx, const float fy, const float fz) { // capture outgoing DDFs before streaming
+)+R(kernel void surface_0)+"("+R(global fpxx* fi, const global float* rho, const global float* u, const global uchar* flags, global float* mass, const global float* massex, const global float* phi, const ulong t, const float fx, const float fy, const float fz // ) { // capture outgoing DDFs before streaming
+)+"#ifdef ACTIVE_CELLS"+R(
+	, const global uint* active_cells, const global uint* active_count // argument order is important
+)+"#endif"+R( // ACTIVE_CELLS
+)+") {"+R( // surface_0()
+)+"#ifndef ACTIVE_CELLS"+R(
 	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
 	if(n>=(uxx)def_N||is_halo(n)) return; // don't execute surface_0() on halo
+)+"#else"+R( // ACTIVE_CELLS
+	if(get_global_id(0)>=(uxx)active_count[0]) return; // range may be larger than number of active cells
+	const uxx n = (uxx)active_cells[get_global_id(0)]; // fluid and interface cells are a subset of active cells
+)+"#endif"+R( // ACTIVE_CELLS
 	const uchar flagsn = flags[n]; // cache flags[n] for multiple readings
 	const uchar flagsn_bo=flagsn&TYPE_BO, flagsn_su=flagsn&TYPE_SU; // extract boundary and surface flags
 	if(flagsn_bo==TYPE_S||flagsn_su==TYPE_G) return; // cell processed here is fluid or interface
@@ -2292,14 +2442,13 @@ string opencl_c_container() { return R( // ########################## begin of O
 
 
 
-)+R(kernel void voxelize_mesh)+"("+R(const uint direction, global fpxx* fi, global float* u, global uchar* flags, const ulong t, const uchar flag, const global float* p0, const global float* p1, const global float* p2, const global float* bbu // ) { // voxelize triangle mesh
+)+R(kernel void voxelize_mesh)+"("+R(const uint direction, global fpxx* fi, global float* u, global uchar* flags, const ulong t, const uchar flag, const global float* vertices, const global uint* bin_offsets, const global uint* bin_triangles, const global float* bbu // ) { // voxelize triangle mesh
 )+"#ifdef SURFACE"+R(
 	, global float* mass, global float* massex // argument order is important
 )+"#endif"+R( // SURFACE
 )+") {"+R( // voxelize_mesh()
 	const uint a=get_global_id(0), A=get_area(direction); // a = domain area index for each side, A = area of the domain boundary
 	if(a>=A) return; // area might not be a multiple of cl_workgroup_size, so return here to avoid writing in unallocated memory space
-	const uint triangle_number = as_uint(bbu[0]);
 	const float x0=bbu[ 1], y0=bbu[ 2], z0=bbu[ 3], x1=bbu[ 4], y1=bbu[ 5], z1=bbu[ 6];
 	const float cx=bbu[ 7], cy=bbu[ 8], cz=bbu[ 9], ux=bbu[10], uy=bbu[11], uz=bbu[12], rx=bbu[13], ry=bbu[14], rz=bbu[15];
 	const uint3 xyz = direction==0u ? (uint3)((uint)clamp((int)x0-def_Ox, 0, (int)def_Nx-1), a%def_Ny, a/def_Ny) : direction==1u ? (uint3)(a/def_Nz, (uint)clamp((int)y0-def_Oy, 0, (int)def_Ny-1), a%def_Nz) : (uint3)(a%def_Nx, a/def_Nx, (uint)clamp((int)z0-def_Oz, 0, (int)def_Nz-1));
@@ -2317,13 +2466,27 @@ string opencl_c_container() { return R( // ########################## begin of O
 	const bool condition = direction==0u ? r_origin.y<y0||r_origin.z<z0||r_origin.y>=y1||r_origin.z>=z1 : direction==1u ? r_origin.x<x0||r_origin.z<z0||r_origin.x>=x1||r_origin.z>=z1 : r_origin.x<x0||r_origin.y<y0||r_origin.x>=x1||r_origin.y>=y1;
 
 	if(condition) return; // don't use local memory (~25% slower, but this also runs on old OpenCL 1.0 GPUs)
-	for(uint i=0u; i<triangle_number; i++) {
+	const float3 m0=(float3)(bbu[21], bbu[22], bbu[23]), m1=(float3)(bbu[24], bbu[25], bbu[26]), m2=(float3)(bbu[27], bbu[28], bbu[29]); // inverse pose of rigid mesh, transforms ray from lattice into mesh coordinates
+	const float3 m_origin = (float3)(dot(m0, r_origin), dot(m1, r_origin), dot(m2, r_origin))+(float3)(bbu[30], bbu[31], bbu[32]);
+	const float3 m_direction = (float3)(dot(m0, r_direction), dot(m1, r_direction), dot(m2, r_direction));
+	const float bu=bbu[16], bv=bbu[17], bin_inverse_size=bbu[18]; // triangles are sorted into 2D bins in the ray plane, only test triangles in the bin of this ray
+	const uint bins_u=as_uint(bbu[19]), bins_v=as_uint(bbu[20]); // bins_u==0 means there are no bins (ray is not axis-aligned in mesh coordinates), then test all triangles
+	const float ru = direction==0u ? m_origin.y : direction==1u ? m_origin.z : m_origin.x; // ray plane axes: (y, z) for rays in x-direction, (z, x) in y-direction, (x, y) in z-direction
+	const float rv = direction==0u ? m_origin.z : direction==1u ? m_origin.x : m_origin.y;
+	const uint bin = bins_u>0u ? (uint)clamp((int)((ru-bu)*bin_inverse_size), 0, (int)bins_u-1)+(uint)clamp((int)((rv-bv)*bin_inverse_size), 0, (int)bins_v-1)*bins_u : 0u;
+	const uint triangle_number = as_uint(bbu[0]);
+	const global float* p0 = vertices; // packed vertex data p0|p1|p2 of Mesh
+	const global float* p1 = vertices+3ul*(ulong)triangle_number;
+	const global float* p2 = vertices+6ul*(ulong)triangle_number;
+	const uint bin_begin = bins_u>0u ? bin_offsets[bin] : 0u, bin_end = bins_u>0u ? bin_offsets[bin+1u] : triangle_number;
+	for(uint k=bin_begin; k<bin_end; k++) {
+		const uint i = bins_u>0u ? bin_triangles[k] : k;
 		const uint tx=3u*i, ty=tx+1u, tz=ty+1u;
 		const float3 p0i = (float3)(p0[tx], p0[ty], p0[tz]);
 		const float3 p1i = (float3)(p1[tx], p1[ty], p1[tz]);
 		const float3 p2i = (float3)(p2[tx], p2[ty], p2[tz]);
-		const float3 u=p1i-p0i, v=p2i-p0i, w=r_origin-p0i, h=cross(r_direction, v), q=cross(w, u); // bidirectional ray-triangle intersection (Moeller-Trumbore algorithm)
-		const float g=dot(u, h), f=1.0f/g, s=f*dot(w, h), t=f*dot(r_direction, q), d=f*dot(v, q); // check for division by zero in case g==0, otherwise f=NaN can cause hang
+		const float3 u=p1i-p0i, v=p2i-p0i, w=m_origin-p0i, h=cross(m_direction, v), q=cross(w, u); // bidirectional ray-triangle intersection (Moeller-Trumbore algorithm)
+		const float g=dot(u, h), f=1.0f/g, s=f*dot(w, h), t=f*dot(m_direction, q), d=f*dot(v, q); // check for division by zero in case g==0, otherwise f=NaN can cause hang
 		if(g!=0.0f&&s>=0.0f&&s<1.0f&&t>=0.0f&&s+t<1.0f) { // ray-triangle intersection ahead or behind
 			if(d>0.0f) { // ray-triangle intersection ahead
 				if(intersections<64u&&d<65536.0f) distances[intersections] = (ushort)d; // store distance to intersection in array as ushort
@@ -2356,12 +2519,13 @@ string opencl_c_container() { return R( // ########################## begin of O
 		}
 		inside = inside&&(intersection<intersections&&h<hmesh); // point must be outside if there are no more ray-mesh intersections ahead (error correction)
 		const uxx n = index((uint3)(direction==0u?h:xyz.x, direction==1u?h:xyz.y, direction==2u?h:xyz.z));
-		uchar flagsn = flags[n];
+		const uchar flagsn_old = flags[n];
+		uchar flagsn = flagsn_old;
 		const float3 p = position(coordinates(n))+offset;
 		const float3 u_set = (float3)(ux, uy, uz)+cross((float3)(cx, cy, cz)-p, (float3)(rx, ry, rz));
 		if(inside) { // cell is inside of mesh geometry
 			flagsn = (flagsn&~TYPE_BO)|flag; // set flag
-			if(set_u) { // set solid velocity
+			if(set_u&&(flagsn!=flagsn_old||u[n]!=u_set.x||u[def_N+(ulong)n]!=u_set.y||u[2ul*def_N+(ulong)n]!=u_set.z)) { // set solid velocity, only write if it changed, so for re-voxelization of moving meshes mostly cells in the band swept since the last pose are written
 				u[                 n] = u_set.x;
 				u[    def_N+(ulong)n] = u_set.y;
 				u[2ul*def_N+(ulong)n] = u_set.z;
@@ -2381,7 +2545,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 				} // else: don't change cell state
 			}
 		}
-		flags[n] = flagsn;
+		if(flagsn!=flagsn_old) flags[n] = flagsn;
 )+"#ifdef SURFACE"+R(
 		mass[n] += massex[n]; // apply distributed excess mass
 		massex[n] = 0.0f; // clear excess mass
@@ -2389,11 +2553,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 	}
 } // voxelize_mesh()
 
-)+R(kernel void voxelize_sdf)+"("+R(global uchar* flags, const uchar flag, const global float* sdf_data, const global float* sdf_params)+") {"+R( // voxelize_sdf()
-	const uxx n = get_global_id(0);
-	if(n>=(uxx)def_N) return;
-
-	// Unpack parameters
+)+R(float3 sdf_coordinates(const uint3 xyz, const global float* sdf_params) { // transform LBM cell center to SDF grid coordinates
 	const uint sdf_Nx = as_uint(sdf_params[0]);
 	const uint sdf_Ny = as_uint(sdf_params[1]);
 	const uint sdf_Nz = as_uint(sdf_params[2]);
@@ -2406,9 +2566,8 @@ string opencl_c_container() { return R( // ########################## begin of O
 	const float3 rot_row1 = (float3)(sdf_params[14], sdf_params[15], sdf_params[16]);
 	const float3 rot_row2 = (float3)(sdf_params[17], sdf_params[18], sdf_params[19]);
 
-	// Get LBM coordinates
-	const uint3 xyz = coordinates(n);
-	const float3 lbm_pos = (float3)(xyz.x + 0.5f, xyz.y + 0.5f, xyz.z + 0.5f);
+	// Get global LBM coordinates (add domain offset)
+	const float3 lbm_pos = (float3)((float)((int)xyz.x+def_Ox) + 0.5f, (float)((int)xyz.y+def_Oy) + 0.5f, (float)((int)xyz.z+def_Oz) + 0.5f);
 
 	// Transform LBM -> World -> SDF coordinates
 	// 1. Compute offset from LBM center
@@ -2420,7 +2579,55 @@ string opencl_c_container() { return R( // ########################## begin of O
 	const float3 sdf_world_center = sdf_origin + 0.5f * sdf_world_size;
 	const float3 world_pos = offset_world + sdf_world_center;
 	// 4. Convert to SDF grid coordinates
-	const float3 sdf_coord = (world_pos - sdf_origin) / sdf_cell_size;
+	return (world_pos - sdf_origin) / sdf_cell_size;
+}
+)+R(bool sdf_box_cell(const uxx i, const global float* sdf_params, uint3* xyz) { // cell i of the domain box that the SDF bounding box overlaps, launch range is only this box
+	const uint sx=as_uint(sdf_params[23]), sy=as_uint(sdf_params[24]), sz=as_uint(sdf_params[25]);
+	if(i>=(uxx)sx*(uxx)sy*(uxx)sz) return false;
+	*xyz = (uint3)(as_uint(sdf_params[20])+(uint)(i%(uxx)sx), as_uint(sdf_params[21])+(uint)((i/(uxx)sx)%(uxx)sy), as_uint(sdf_params[22])+(uint)(i/((uxx)sx*(uxx)sy)));
+	return true;
+}
+)+R(float plane_cube_volume(const float d, const float3 n) { // unit cube - plane intersection: signed distance d of cube center to plane (positive outside), normal vector n -> volume on the negative side
+	const float ln = length(n);
+	if(ln==0.0f) return d<=0.0f ? 1.0f : 0.0f;
+	const float ax=fabs(n.x)/ln, ay=fabs(n.y)/ln, az=fabs(n.z)/ln, l=ax+ay+az; // eliminate symmetry cases, normalize n using L1 norm
+	const float alpha = 0.5f-d/l; // plane offset in reduced coordinates, volume is where m.y<alpha for y in [0,1]^3
+	if(alpha<=0.0f) return 0.0f;
+	if(alpha>=1.0f) return 1.0f;
+	const float a = fmin(alpha, 1.0f-alpha); // V(alpha) = 1-V(1-alpha)
+	const float m1_raw = fmin(fmin(ax, ay), az)/l;
+	const float m1 = m1_raw<1E-3f ? 0.0f : m1_raw; // avoid cancellation for nearly axis-aligned planes
+	const float m3 = fmax(fmax(ax, ay), az)/l;
+	const float m2 = fdim(1.0f, m1_raw+m3), m12 = m1+m2;
+	float V; // Scardovelli and Zaleski, source: https://doi.org/10.1006/jcph.2000.6567
+	if(a<m1) V = cb(a)/(6.0f*m1*m2*m3);
+	else if(a<m2) V = (a*(a-m1)+sq(m1)/3.0f)/(2.0f*m2*m3);
+	else if(a<fmin(m12, m3)) V = (sq(a)*(3.0f*m12-a)+sq(m1)*(m1-3.0f*a)+sq(m2)*(m2-3.0f*a))/(6.0f*m1*m2*m3);
+	else if(m12<=m3) V = (2.0f*a-m12)/(2.0f*m3);
+	else V = (sq(a)*(3.0f-2.0f*a)+sq(m1)*(m1-3.0f*a)+sq(m2)*(m2-3.0f*a)+sq(m3)*(m3-3.0f*a))/(6.0f*m1*m2*m3);
+	return alpha<=0.5f ? V : 1.0f-V;
+}
+)+R(void voxelize_sdf_cell(const uxx n, global uchar* flags, const uchar flag, const float* c, const float3 f, const float distance_to_lbm, const global float* sdf_params, global float* solid_fraction) { // c: 8 SDF corner values with x varying fastest, f: position within SDF cell
+	const float c00=mix(c[0], c[1], f.x), c10=mix(c[2], c[3], f.x), c01=mix(c[4], c[5], f.x), c11=mix(c[6], c[7], f.x); // trilinear interpolation
+	const float c0=mix(c00, c10, f.y), c1=mix(c01, c11, f.y);
+	const float sdf_value = mix(c0, c1, f.z);
+	if(sdf_value<=0.0f) flags[n] = (flags[n]&~TYPE_BO)|flag; // mark as solid if inside (negative SDF)
+	if(as_uint(sdf_params[32])) { // solid volume fraction of a plane through the interpolated distance, with the interpolation gradient as normal
+		const float3 g = (float3)(mix(mix(c[1]-c[0], c[3]-c[2], f.y), mix(c[5]-c[4], c[7]-c[6], f.y), f.z), mix(c10-c00, c11-c01, f.z), c1-c0); // gradient in SDF grid coordinates
+		const float3 normal = g.x*(float3)(sdf_params[11], sdf_params[12], sdf_params[13])+g.y*(float3)(sdf_params[14], sdf_params[15], sdf_params[16])+g.z*(float3)(sdf_params[17], sdf_params[18], sdf_params[19]); // rotate gradient to LBM coordinates
+		solid_fraction[n] = fmax(solid_fraction[n], plane_cube_volume(sdf_value*distance_to_lbm, normal)); // fmax to combine multiple bodies
+	}
+}
+
+)+R(kernel void voxelize_sdf)+"("+R(global uchar* flags, const uchar flag, const global float* sdf_data, const global float* sdf_params, global float* solid_fraction)+") {"+R( // voxelize_sdf()
+	uint3 xyz;
+	if(!sdf_box_cell(get_global_id(0), sdf_params, &xyz)) return;
+	const uxx n = index(xyz);
+
+	const uint sdf_Nx = as_uint(sdf_params[0]);
+	const uint sdf_Ny = as_uint(sdf_params[1]);
+	const uint sdf_Nz = as_uint(sdf_params[2]);
+	const float3 sdf_coord = sdf_coordinates(xyz, sdf_params);
 
 	// Check bounds
 	if(sdf_coord.x < 0.0f || sdf_coord.x >= (float)(sdf_Nx-1u) ||
@@ -2429,65 +2636,87 @@ string opencl_c_container() { return R( // ########################## begin of O
 		return;  // Outside SDF bounds
 	}
 
-	// Trilinear interpolation
-	const uint x0 = (uint)sdf_coord.x;
-	const uint y0 = (uint)sdf_coord.y;
-	const uint z0 = (uint)sdf_coord.z;
-	const uint x1 = min(x0 + 1u, sdf_Nx - 1u);
-	const uint y1 = min(y0 + 1u, sdf_Ny - 1u);
-	const uint z1 = min(z0 + 1u, sdf_Nz - 1u);
+	// Only the SDF sub-block overlapping this domain is uploaded, starting at (bx, by, bz) with size (bNx, bNy, bNz)
+	const uint bx=as_uint(sdf_params[26]), by=as_uint(sdf_params[27]), bz=as_uint(sdf_params[28]);
+	const uint bNx=as_uint(sdf_params[29]), bNy=as_uint(sdf_params[30]), bNz=as_uint(sdf_params[31]);
+	const uint x0 = clamp((uint)sdf_coord.x, bx, bx+bNx-1u)-bx; // clamp is only a safeguard, the sub-block already covers all samples
+	const uint y0 = clamp((uint)sdf_coord.y, by, by+bNy-1u)-by;
+	const uint z0 = clamp((uint)sdf_coord.z, bz, bz+bNz-1u)-bz;
+	const uint x1 = min(x0 + 1u, bNx - 1u);
+	const uint y1 = min(y0 + 1u, bNy - 1u);
+	const uint z1 = min(z0 + 1u, bNz - 1u);
 
-	const float fx = sdf_coord.x - (float)x0;
-	const float fy = sdf_coord.y - (float)y0;
-	const float fz = sdf_coord.z - (float)z0;
+	const float3 f = sdf_coord - floor(sdf_coord);
 
 	// Sample SDF at 8 corners (SDF uses x + Nx*(y + Ny*z) indexing)
-	const ulong sdf_index_000 = (ulong)x0 + (ulong)sdf_Nx * ((ulong)y0 + (ulong)sdf_Ny * (ulong)z0);
-	const ulong sdf_index_001 = (ulong)x0 + (ulong)sdf_Nx * ((ulong)y0 + (ulong)sdf_Ny * (ulong)z1);
-	const ulong sdf_index_010 = (ulong)x0 + (ulong)sdf_Nx * ((ulong)y1 + (ulong)sdf_Ny * (ulong)z0);
-	const ulong sdf_index_011 = (ulong)x0 + (ulong)sdf_Nx * ((ulong)y1 + (ulong)sdf_Ny * (ulong)z1);
-	const ulong sdf_index_100 = (ulong)x1 + (ulong)sdf_Nx * ((ulong)y0 + (ulong)sdf_Ny * (ulong)z0);
-	const ulong sdf_index_101 = (ulong)x1 + (ulong)sdf_Nx * ((ulong)y0 + (ulong)sdf_Ny * (ulong)z1);
-	const ulong sdf_index_110 = (ulong)x1 + (ulong)sdf_Nx * ((ulong)y1 + (ulong)sdf_Ny * (ulong)z0);
-	const ulong sdf_index_111 = (ulong)x1 + (ulong)sdf_Nx * ((ulong)y1 + (ulong)sdf_Ny * (ulong)z1);
-
-	const float c000 = sdf_data[sdf_index_000];
-	const float c001 = sdf_data[sdf_index_001];
-	const float c010 = sdf_data[sdf_index_010];
-	const float c011 = sdf_data[sdf_index_011];
-	const float c100 = sdf_data[sdf_index_100];
-	const float c101 = sdf_data[sdf_index_101];
-	const float c110 = sdf_data[sdf_index_110];
-	const float c111 = sdf_data[sdf_index_111];
-
-	// Trilinear interpolation
-	const float c00 = c000 * (1.0f - fx) + c100 * fx;
-	const float c01 = c001 * (1.0f - fx) + c101 * fx;
-	const float c10 = c010 * (1.0f - fx) + c110 * fx;
-	const float c11 = c011 * (1.0f - fx) + c111 * fx;
-
-	const float c0 = c00 * (1.0f - fy) + c10 * fy;
-	const float c1 = c01 * (1.0f - fy) + c11 * fy;
-
-	const float sdf_value = c0 * (1.0f - fz) + c1 * fz;
-
-	// Mark as solid if inside (negative SDF)
-	if(sdf_value <= 0.0f) {
-		flags[n] = (flags[n] & ~TYPE_BO) | flag;
-	}
+	const ulong sy0=(ulong)bNx*(ulong)y0, sy1=(ulong)bNx*(ulong)y1, sz0=(ulong)bNx*(ulong)bNy*(ulong)z0, sz1=(ulong)bNx*(ulong)bNy*(ulong)z1;
+	const float c[8] = {
+		sdf_data[x0+sy0+sz0], sdf_data[x1+sy0+sz0], sdf_data[x0+sy1+sz0], sdf_data[x1+sy1+sz0],
+		sdf_data[x0+sy0+sz1], sdf_data[x1+sy0+sz1], sdf_data[x0+sy1+sz1], sdf_data[x1+sy1+sz1]
+	};
+	voxelize_sdf_cell(n, flags, flag, c, f, sdf_params[10], sdf_params, solid_fraction); // dense SDF values are in world units
 } // voxelize_sdf()
 
+)+R(float sparse_sdf_sample(const uint x, const uint y, const uint z, const global uint* brick_index, const global float* brick_data, const global float* sdf_params) { // sample narrow-band SDF in units of cell size
+	const uint B = as_uint(sdf_params[33]); // samples per brick and axis
+	const uint bx = clamp(x/B, as_uint(sdf_params[26]), as_uint(sdf_params[26])+as_uint(sdf_params[29])-1u)-as_uint(sdf_params[26]); // only the bricks overlapping this domain are uploaded
+	const uint by = clamp(y/B, as_uint(sdf_params[27]), as_uint(sdf_params[27])+as_uint(sdf_params[30])-1u)-as_uint(sdf_params[27]);
+	const uint bz = clamp(z/B, as_uint(sdf_params[28]), as_uint(sdf_params[28])+as_uint(sdf_params[31])-1u)-as_uint(sdf_params[28]);
+	const uint b = brick_index[bx+as_uint(sdf_params[29])*(by+as_uint(sdf_params[30])*bz)];
+	if(b>=0xFFFFFFFEu) return b==0xFFFFFFFFu ? sdf_params[34] : -sdf_params[34]; // far from surface, only the sign is stored
+	const ulong i = (ulong)b*(ulong)(B*B*B)+(ulong)(x%B+B*(y%B+B*(z%B)));
+	return as_uint(sdf_params[35]) ? vload_half(i, (const global half*)brick_data) : brick_data[i];
+}
+)+R(kernel void voxelize_sparse_sdf)+"("+R(global uchar* flags, const uchar flag, const global uint* brick_index, const global float* brick_data, const global float* sdf_params, global float* solid_fraction)+") {"+R( // voxelize_sparse_sdf()
+	uint3 xyz;
+	if(!sdf_box_cell(get_global_id(0), sdf_params, &xyz)) return;
+	const uxx n = index(xyz);
+	const uint sdf_Nx=as_uint(sdf_params[0]), sdf_Ny=as_uint(sdf_params[1]), sdf_Nz=as_uint(sdf_params[2]);
+	const float3 sdf_coord = sdf_coordinates(xyz, sdf_params);
+	if(sdf_coord.x<0.0f||sdf_coord.x>=(float)(sdf_Nx-1u)||sdf_coord.y<0.0f||sdf_coord.y>=(float)(sdf_Ny-1u)||sdf_coord.z<0.0f||sdf_coord.z>=(float)(sdf_Nz-1u)) return; // outside SDF bounds
+	const uint x0=(uint)sdf_coord.x, y0=(uint)sdf_coord.y, z0=(uint)sdf_coord.z;
+	const uint x1=min(x0+1u, sdf_Nx-1u), y1=min(y0+1u, sdf_Ny-1u), z1=min(z0+1u, sdf_Nz-1u);
+	const float c[8] = {
+		sparse_sdf_sample(x0, y0, z0, brick_index, brick_data, sdf_params), sparse_sdf_sample(x1, y0, z0, brick_index, brick_data, sdf_params),
+		sparse_sdf_sample(x0, y1, z0, brick_index, brick_data, sdf_params), sparse_sdf_sample(x1, y1, z0, brick_index, brick_data, sdf_params),
+		sparse_sdf_sample(x0, y0, z1, brick_index, brick_data, sdf_params), sparse_sdf_sample(x1, y0, z1, brick_index, brick_data, sdf_params),
+		sparse_sdf_sample(x0, y1, z1, brick_index, brick_data, sdf_params), sparse_sdf_sample(x1, y1, z1, brick_index, brick_data, sdf_params)
+	};
+	voxelize_sdf_cell(n, flags, flag, c, sdf_coord-floor(sdf_coord), sdf_params[3]*sdf_params[10], sdf_params, solid_fraction); // sparse SDF values are in units of cell size
+} // voxelize_sparse_sdf()
+
 )+R(kernel void unvoxelize_mesh(global uchar* flags, const uchar flag, float x0, float y0, float z0, float x1, float y1, float z1) { // remove voxelized triangle mesh
 	const uxx n = get_global_id(0);
 	const float3 p = position(coordinates(n))+(float3)(0.5f*(float)((int)def_Nx+2*def_Ox)-0.5f, 0.5f*(float)((int)def_Ny+2*def_Oy)-0.5f, 0.5f*(float)((int)def_Nz+2*def_Oz)-0.5f);
 	if(p.x>=x0-1.0f&&p.y>=y0-1.0f&&p.z>=z0-1.0f&&p.x<=x1+1.0f&&p.y<=y1+1.0f&&p.z<=z1+1.0f) flags[n] &= ~flag;
 } // unvoxelize_mesh()
+)+R(kernel void count_flags(const global uchar* flags, const global float* u, const uchar flag_mask, const uchar flag_value, volatile global uint* flag_count) { // count cells with (flags&flag_mask)==flag_value in flag_count[0], bitwise-or all flags in flag_count[1] and count moving boundary cells in flag_count[2], flag_count has to be reset to 0 before
+	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
+	local uint local_count, local_flags, local_moving; // number of matching cells, used flags and number of moving boundary cells in this work-group
+	if(get_local_id(0)==0u) {
+		local_count = 0u;
+		local_flags = 0u;
+		local_moving = 0u;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if(n<(uxx)def_N&&!is_halo(n)) { // no early return here because of barriers, halo cells are counted in their own domain
+		const uchar flagsn = flags[n];
+		const uchar flagsn_bo = flagsn&(TYPE_S|TYPE_E);
+		if((flagsn&flag_mask)==flag_value) atomic_inc(&local_count);
+		atomic_or(&local_flags, (uint)flagsn);
+		if(flagsn_bo==(TYPE_S|TYPE_E)||(flagsn_bo==TYPE_S&&(u[n]!=0.0f||u[def_N+(ulong)n]!=0.0f||u[2ul*def_N+(ulong)n]!=0.0f))) atomic_inc(&local_moving); // TYPE_S with non-zero velocity, or TYPE_MS
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if(get_local_id(0)==0u) { // only one global atomic per work-group
+		if(local_count>0u) atomic_add(&flag_count[0], local_count);
+		if(local_flags!=0u) atomic_or(&flag_count[1], local_flags);
+		if(local_moving>0u) atomic_add(&flag_count[2], local_moving);
+	}
+} // count_flags()
 
 
 
-// ################################################## graphics code ##################################################
-
-)+"#ifdef GRAPHICS"+R(
+// ################################################## isosurface code ##################################################
 
 )+R(void calculate_j8(const uint3 xyz, uxx* j) {
 	const uxx x0 = (uxx)  xyz.x; // cube stencil
@@ -2551,25 +2780,85 @@ string opencl_c_container() { return R( // ########################## begin of O
 	j[30] = x0+yq+zp; // 0#+
 	j[31] = x0+yp+zq; // 0+#
 } // calculate_j32()
+)+R(kernel void extract_isosurface)+"("+R(const uint field, const float iso, const global float* u, global float* triangles, volatile global uint* triangle_count, const uint triangle_capacity // ) {
+)+"#ifdef SURFACE"+R(
+	, const global float* phi, const global uchar* flags // argument order is important
+)+"#endif"+R( // SURFACE
+)+") {"+R( // extract_isosurface(), marching cubes on field (0: velocity magnitude, 1: Q-criterion, 2: fill level), compact triangles into triangles, triangle_count has to be reset to 0 before
+	const uxx n = get_global_id(0); // n = x+(y+z*Ny)*Nx
+	local uint local_count, local_offset; // number of triangles in this work-group and their offset in triangles
+	if(get_local_id(0)==0u) local_count = 0u;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	float3 p, t[15]; // cube position and maximum of 5 triangles with 3 vertices each
+	uint tn = 0u; // number of triangles in this cube
+	if(n<(uxx)def_N) { // no early return here because of barriers
+		const uint3 xyz = coordinates(n);
+		const bool lower_halo = ((def_Dx>1u)&(xyz.x==0u))||((def_Dy>1u)&(xyz.y==0u))||((def_Dz>1u)&(xyz.z==0u)); // cubes reaching into the lower halo are extracted in the neighboring domain
+		if(xyz.x<def_Nx-1u&&xyz.y<def_Ny-1u&&xyz.z<def_Nz-1u&&(field==1u ? !is_halo_q(xyz) : !lower_halo)) { // Q-criterion stencil reaches one cell further, so it is not extracted in the last cube before the upper halo
+			uxx j[32];
+			if(field==1u) calculate_j32(xyz, j); else calculate_j8(xyz, j); // first 8 indices of calculate_j32() are the cube stencil
+			float v[8];
+			bool extract = true;
+			switch(field) {
+				case 0u: // velocity magnitude
+					for(uint i=0u; i<8u; i++) v[i] = length(load3(j[i], u));
+					break;
+				case 1u: { // Q-criterion
+					float3 uj[32];
+					for(uint i=0u; i<32u; i++) uj[i] = load3(j[i], u);
+					v[0] = calculate_Q_cached(uj[ 1], uj[ 8], uj[ 4], uj[ 9], uj[ 3], uj[10]);
+					v[1] = calculate_Q_cached(uj[11], uj[ 0], uj[ 5], uj[12], uj[ 2], uj[13]);
+					v[2] = calculate_Q_cached(uj[14], uj[ 3], uj[ 6], uj[15], uj[16], uj[ 1]);
+					v[3] = calculate_Q_cached(uj[ 2], uj[17], uj[ 7], uj[18], uj[19], uj[ 0]);
+					v[4] = calculate_Q_cached(uj[ 5], uj[20], uj[21], uj[ 0], uj[ 7], uj[22]);
+					v[5] = calculate_Q_cached(uj[23], uj[ 4], uj[24], uj[ 1], uj[ 6], uj[25]);
+					v[6] = calculate_Q_cached(uj[26], uj[ 7], uj[27], uj[ 2], uj[28], uj[ 5]);
+					v[7] = calculate_Q_cached(uj[ 6], uj[29], uj[30], uj[ 3], uj[31], uj[ 4]);
+				} break;
+)+"#ifdef SURFACE"+R(
+				case 2u: // fill level
+					for(uint i=0u; i<8u; i++) v[i] = phi[j[i]];
+					break;
+)+"#endif"+R( // SURFACE
+				default: extract = false;
+			}
+)+"#ifdef SURFACE"+R(
+			if(field!=2u) { // velocity in gas and interface cells does not belong to the fluid
+				uchar flags_cell = 0u;
+				for(uint i=0u; i<8u; i++) flags_cell |= flags[j[i]];
+				if(flags_cell&(TYPE_I|TYPE_G)) extract = false;
+			}
+)+"#endif"+R( // SURFACE
+			if(extract) {
+				p = position(xyz)+(float3)(def_domain_offset_x, def_domain_offset_y, def_domain_offset_z); // position in the global simulation box
+				tn = marching_cubes(v, iso, t); // run marching cubes algorithm
+			}
+		}
+	}
+	const uint local_index = tn>0u ? atomic_add(&local_count, tn) : 0u;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if(get_local_id(0)==0u) local_offset = atomic_add(triangle_count, local_count); // only one global atomic per work-group
+	barrier(CLK_LOCAL_MEM_FENCE);
+	for(uint i=0u; i<tn; i++) {
+		const uint k = local_offset+local_index+i;
+		if(k>=triangle_capacity) break; // triangles do not fit, triangle_count still counts all of them, so the host can reallocate and extract again
+		for(uint l=0u; l<3u; l++) { // triangle k is stored as 9 consecutive floats p0.xyz, p1.xyz, p2.xyz
+			const float3 pl = p+t[3u*i+l];
+			triangles[9ul*(ulong)k+3ul*(ulong)l   ] = pl.x;
+			triangles[9ul*(ulong)k+3ul*(ulong)l+1ul] = pl.y;
+			triangles[9ul*(ulong)k+3ul*(ulong)l+2ul] = pl.z;
+		}
+	}
+} // extract_isosurface()
 
-)+"#ifndef FORCE_FIELD"+R( // render flags as grid
-)+R(kernel void graphics_flags(const global float* camera, global int* bitmap, global int* zbuffer, const global uchar* flags) {
-)+"#else"+R( // FORCE_FIELD
-)+R(kernel void graphics_flags(const global float* camera, global int* bitmap, global int* zbuffer, const global uchar* flags, const global float* F) {
-)+"#endif"+R( // FORCE_FIELD
-	const uxx n = get_global_id(0);
-	if(n>=(uxx)def_N||is_halo(n)) return; // don't execute graphics_flags() on halo
-	const uchar flagsn = flags[n]; // cache flags
+
+// ################################################## graphics code ##################################################
+
+)+"#ifdef GRAPHICS"+R(
+
+)+R(int flag_color(const uchar flagsn) { // coloring scheme for flags
 	const uchar flagsn_bo = flagsn&TYPE_BO; // extract boundary flags
-	if(flagsn==0u||flagsn==TYPE_G) return; // don't draw regular fluid cells
-	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
-	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
-	const uint3 xyz = coordinates(n);
-	const float3 p = position(xyz);
-	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
-	uxx x0, xp, xm, y0, yp, ym, z0, zp, zm;
-	calculate_indices(n, &x0, &xp, &xm, &y0, &yp, &ym, &z0, &zp, &zm);
-	const int c =  // coloring scheme
+	return
 		flagsn_bo==TYPE_S ? COLOR_S : // solid boundary
 		((flagsn&TYPE_T)&&flagsn_bo==TYPE_E) ? color_average(COLOR_T, COLOR_E) : // both temperature boundary and equilibrium boundary
 		((flagsn&TYPE_T)&&flagsn_bo==TYPE_MS) ? color_average(COLOR_T, COLOR_M) : // both temperature boundary and moving boundary
@@ -2581,22 +2870,16 @@ string opencl_c_container() { return R( // ########################## begin of O
 		flagsn&TYPE_X ? COLOR_X : // reserved type X
 		flagsn&TYPE_Y ? COLOR_Y : // reserved type Y
 		COLOR_0; // regular or gas cell
-	//draw_point(p, c, camera_cache, bitmap, zbuffer); // draw one pixel for every boundary cell
-	uxx t;
-	t = xp+y0+z0; const bool not_xp = xyz.x<def_Nx-1u && flagsn==flags[t] && !is_halo(t); // +00
-	t = xm+y0+z0; const bool not_xm = xyz.x>       0u && flagsn==flags[t] && !is_halo(t); // -00
-	t = x0+yp+z0; const bool not_yp = xyz.y<def_Ny-1u && flagsn==flags[t] && !is_halo(t); // 0+0
-	t = x0+ym+z0; const bool not_ym = xyz.y>       0u && flagsn==flags[t] && !is_halo(t); // 0-0
-	t = x0+y0+zp; const bool not_zp = xyz.z<def_Nz-1u && flagsn==flags[t] && !is_halo(t); // 00+
-	t = x0+y0+zm; const bool not_zm = xyz.z>       0u && flagsn==flags[t] && !is_halo(t); // 00-
-	const float3 p0 = (float3)(p.x-0.5f, p.y-0.5f, p.z-0.5f); // ---
-	const float3 p1 = (float3)(p.x+0.5f, p.y+0.5f, p.z+0.5f); // +++
-	const float3 p2 = (float3)(p.x-0.5f, p.y-0.5f, p.z+0.5f); // --+
-	const float3 p3 = (float3)(p.x+0.5f, p.y+0.5f, p.z-0.5f); // ++-
-	const float3 p4 = (float3)(p.x-0.5f, p.y+0.5f, p.z-0.5f); // -+-
-	const float3 p5 = (float3)(p.x+0.5f, p.y-0.5f, p.z+0.5f); // +-+
-	const float3 p6 = (float3)(p.x+0.5f, p.y-0.5f, p.z-0.5f); // +--
-	const float3 p7 = (float3)(p.x-0.5f, p.y+0.5f, p.z+0.5f); // -++
+}
+)+R(void draw_flag_edges(const float3 p, const float r, const bool not_xp, const bool not_xm, const bool not_yp, const bool not_ym, const bool not_zp, const bool not_zm, const int c, const float* camera_cache, global int* bitmap, global int* zbuffer) { // draw edges of box with center p and half size r, skip edges shared with neighbors of the same type
+	const float3 p0 = (float3)(p.x-r, p.y-r, p.z-r); // ---
+	const float3 p1 = (float3)(p.x+r, p.y+r, p.z+r); // +++
+	const float3 p2 = (float3)(p.x-r, p.y-r, p.z+r); // --+
+	const float3 p3 = (float3)(p.x+r, p.y+r, p.z-r); // ++-
+	const float3 p4 = (float3)(p.x-r, p.y+r, p.z-r); // -+-
+	const float3 p5 = (float3)(p.x+r, p.y-r, p.z+r); // +-+
+	const float3 p6 = (float3)(p.x+r, p.y-r, p.z-r); // +--
+	const float3 p7 = (float3)(p.x-r, p.y+r, p.z+r); // -++
 	if(!(not_xm||not_ym)) draw_line(p0, p2, c, camera_cache, bitmap, zbuffer); // to draw the entire surface, replace || by &&
 	if(!(not_xm||not_zm)) draw_line(p0, p4, c, camera_cache, bitmap, zbuffer);
 	if(!(not_ym||not_zm)) draw_line(p0, p6, c, camera_cache, bitmap, zbuffer);
@@ -2609,6 +2892,34 @@ string opencl_c_container() { return R( // ########################## begin of O
 	if(!(not_xp||not_zm)) draw_line(p3, p6, c, camera_cache, bitmap, zbuffer);
 	if(!(not_xm||not_yp)) draw_line(p4, p7, c, camera_cache, bitmap, zbuffer);
 	if(!(not_xp||not_ym)) draw_line(p5, p6, c, camera_cache, bitmap, zbuffer);
+}
+)+"#ifndef FORCE_FIELD"+R( // render flags as grid
+)+R(kernel void graphics_flags(const global float* camera, global int* bitmap, global int* zbuffer, const global uchar* flags) {
+)+"#else"+R( // FORCE_FIELD
+)+R(kernel void graphics_flags(const global float* camera, global int* bitmap, global int* zbuffer, const global uchar* flags, const global float* F) {
+)+"#endif"+R( // FORCE_FIELD
+	const uxx n = get_global_id(0);
+	if(n>=(uxx)def_N||is_halo(n)) return; // don't execute graphics_flags() on halo
+	const uchar flagsn = flags[n]; // cache flags
+	const uchar flagsn_bo = flagsn&TYPE_BO; // extract boundary flags
+	if(flagsn==0u||flagsn==TYPE_G) return; // don't draw regular fluid cells
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	const uint3 xyz = coordinates(n);
+	const float3 p = position(xyz);
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	uxx x0, xp, xm, y0, yp, ym, z0, zp, zm;
+	calculate_indices(n, &x0, &xp, &xm, &y0, &yp, &ym, &z0, &zp, &zm);
+	const int c = flag_color(flagsn); // coloring scheme
+	//draw_point(p, c, camera_cache, bitmap, zbuffer); // draw one pixel for every boundary cell
+	uxx t;
+	t = xp+y0+z0; const bool not_xp = xyz.x<def_Nx-1u && flagsn==flags[t] && !is_halo(t); // +00
+	t = xm+y0+z0; const bool not_xm = xyz.x>       0u && flagsn==flags[t] && !is_halo(t); // -00
+	t = x0+yp+z0; const bool not_yp = xyz.y<def_Ny-1u && flagsn==flags[t] && !is_halo(t); // 0+0
+	t = x0+ym+z0; const bool not_ym = xyz.y>       0u && flagsn==flags[t] && !is_halo(t); // 0-0
+	t = x0+y0+zp; const bool not_zp = xyz.z<def_Nz-1u && flagsn==flags[t] && !is_halo(t); // 00+
+	t = x0+y0+zm; const bool not_zm = xyz.z>       0u && flagsn==flags[t] && !is_halo(t); // 00-
+	draw_flag_edges(p, 0.5f, not_xp, not_xm, not_yp, not_ym, not_zp, not_zm, c, camera_cache, bitmap, zbuffer);
 )+"#ifdef FORCE_FIELD"+R(
 	if(flagsn_bo==TYPE_S) {
 		const float3 Fn = def_scale_F*(float3)(F[n], F[def_N+(ulong)n], F[2ul*def_N+(ulong)n]);
@@ -2704,6 +3015,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 	float sum = 0.0f;
 	float traversed_cells_weighted = 0.0f;
 	uint traversed_cells = 0u;
+	const uxx NxNyNz = (uxx)Nx*(uxx)Ny*(uxx)Nz; // u is SoA with this stride
 	const float3 p = (float3)(r.origin.x+0.5f*(float)Nx, r.origin.y+0.5f*(float)Ny, r.origin.z+0.5f*(float)Nz); // start point
 	const int dx=(int)sign(r.direction.x), dy=(int)sign(r.direction.y), dz=(int)sign(r.direction.z); // fast ray-grid-traversal
 	int3 xyz = (int3)((int)floor(p.x), (int)floor(p.y), (int)floor(p.z));
@@ -2721,9 +3033,9 @@ string opencl_c_container() { return R( // ########################## begin of O
 				if(tmx<tmy) { if(tmx<tmz) { xyz.x += dx; tmx += tdx; } else { xyz.z += dz; tmz += tdz; } }
 				else /****/ { if(tmy<tmz) { xyz.y += dy; tmy += tdy; } else { xyz.z += dz; tmz += tdz; } }
 				if(xyz.x<0 || xyz.y<0 || xyz.z<0 || xyz.x>=(int)Nx || xyz.y>=(int)Ny || xyz.z>=(int)Nz) break; // out of simulation box
-				const uxx n = index((uint3)((uint)clamp(xyz.x, 0, (int)Nx-1), (uint)clamp(xyz.y, 0, (int)Ny-1), (uint)clamp(xyz.z, 0, (int)Nz-1)));
+				const uxx n = (uxx)xyz.x+(uxx)((uint)xyz.y+(uint)xyz.z*Ny)*(uxx)Nx; // lattice of size Nx*Ny*Nz, not necessarily def_N
 				if(!(flags[n]&(TYPE_S|TYPE_E|TYPE_G))) {
-					const float un = length(load3(n, u));
+					const float un = length((float3)(u[n], u[NxNyNz+n], u[2u*NxNyNz+n]));
 					const float weight = fmin(un, fabs(un-0.5f/def_scale_u));
 					sum = fma(weight, un, sum);
 					traversed_cells_weighted += weight;
@@ -2738,7 +3050,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 				if(tmx<tmy) { if(tmx<tmz) { xyz.x += dx; tmx += tdx; } else { xyz.z += dz; tmz += tdz; } }
 				else /****/ { if(tmy<tmz) { xyz.y += dy; tmy += tdy; } else { xyz.z += dz; tmz += tdz; } }
 				if(xyz.x<0 || xyz.y<0 || xyz.z<0 || xyz.x>=(int)Nx || xyz.y>=(int)Ny || xyz.z>=(int)Nz) break; // out of simulation box
-				const uxx n = index((uint3)((uint)clamp(xyz.x, 0, (int)Nx-1), (uint)clamp(xyz.y, 0, (int)Ny-1), (uint)clamp(xyz.z, 0, (int)Nz-1)));
+				const uxx n = (uxx)xyz.x+(uxx)((uint)xyz.y+(uint)xyz.z*Ny)*(uxx)Nx; // lattice of size Nx*Ny*Nz, not necessarily def_N
 				if(!(flags[n]&(TYPE_S|TYPE_E|TYPE_G))) {
 					const float rhon = rho[n];
 					const float weight = fabs(rhon-1.0f);
@@ -2756,7 +3068,7 @@ string opencl_c_container() { return R( // ########################## begin of O
 				if(tmx<tmy) { if(tmx<tmz) { xyz.x += dx; tmx += tdx; } else { xyz.z += dz; tmz += tdz; } }
 				else /****/ { if(tmy<tmz) { xyz.y += dy; tmy += tdy; } else { xyz.z += dz; tmz += tdz; } }
 				if(xyz.x<0 || xyz.y<0 || xyz.z<0 || xyz.x>=(int)Nx || xyz.y>=(int)Ny || xyz.z>=(int)Nz) break; // out of simulation box
-				const uxx n = index((uint3)((uint)clamp(xyz.x, 0, (int)Nx-1), (uint)clamp(xyz.y, 0, (int)Ny-1), (uint)clamp(xyz.z, 0, (int)Nz-1)));
+				const uxx n = (uxx)xyz.x+(uxx)((uint)xyz.y+(uint)xyz.z*Ny)*(uxx)Nx; // lattice of size Nx*Ny*Nz, not necessarily def_N
 				if(!(flags[n]&(TYPE_S|TYPE_E|TYPE_G))) {
 					const float Tn = T[n];
 					const float weight = sq(Tn-def_T_avg);
@@ -2800,6 +3112,38 @@ string opencl_c_container() { return R( // ########################## begin of O
 )+"#endif"+R( // TEMPERATURE
 }
 
+)+R(ray gathered_camray(const int x, const int y, const float* camera_cache, const float3 f) { // camera ray in the lattice gathered from all domains, f is the size of one gathered cell in lattice cells
+	ray camray = get_camray(x, y, camera_cache);
+	camray.origin = (camray.origin+(float3)(def_domain_offset_x, def_domain_offset_y, def_domain_offset_z))/f; // get_camray() is relative to this domain, the gathered lattice is centered in the simulation box
+	camray.direction = normalize(camray.direction/f); // refract() needs normalized direction
+	return camray;
+}
+)+"#ifndef TEMPERATURE"+R(
+)+R(kernel void graphics_field_rt_gather(const global float* camera, global int* bitmap, const int field_mode, const uint Mx, const uint My, const uint Mz, const float fx, const float fy, const float fz, const global float* rho, const global float* u, const global uchar* flags) { // multi-domain: raytrace the gathered lattice over the composited frame
+)+"#else"+R( // TEMPERATURE
+)+R(kernel void graphics_field_rt_gather(const global float* camera, global int* bitmap, const int field_mode, const uint Mx, const uint My, const uint Mz, const float fx, const float fy, const float fz, const global float* rho, const global float* u, const global uchar* flags, const global float* T) { // multi-domain: raytrace the gathered lattice over the composited frame
+)+"#endif"+R( // TEMPERATURE
+	const uint gid = get_global_id(0); // workgroup size alignment is critical
+	const uint lid = get_local_id(0); // make workgropus not horizontal stripes of pixels, but 8x8 rectangular (close to square) tiles
+	const uint lsi = get_local_size(0); // (50% performance boost due to more coalesced memory access)
+	const uint tile_width=8u, tile_height=lsi/tile_width, tiles_x=def_screen_width/tile_width;
+	const int lx=lid%tile_width, ly=lid/tile_width;
+	const int tx=(gid/lsi)%tiles_x, ty=(gid/lsi)/tiles_x;
+	const int x=tx*tile_width+lx, y=ty*tile_height+ly;
+	const uint n = x+y*def_screen_width;
+	float camera_cache[15]; // cache parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	ray camray = gathered_camray(x, y, camera_cache, (float3)(fx, fy, fz));
+	const float distance = intersect_cuboid(camray, (float3)(0.0f, 0.0f, 0.0f), (float)Mx, (float)My, (float)Mz);
+	if(distance==-1.0f) return;
+	camray.origin = camray.origin+fmax(distance+0.005f, 0.005f)*camray.direction;
+)+"#ifndef TEMPERATURE"+R(
+	bitmap[n] = ray_grid_traverse_sum(bitmap[n], camray, Mx, My, Mz, field_mode, rho, u, flags);
+)+"#else"+R( // TEMPERATURE
+	bitmap[n] = ray_grid_traverse_sum(bitmap[n], camray, Mx, My, Mz, field_mode, rho, u, flags, T);
+)+"#endif"+R( // TEMPERATURE
+}
+
 )+"#ifndef TEMPERATURE"+R(
 )+R(kernel void graphics_field_slice(const global float* camera, global int* bitmap, global int* zbuffer, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const global float* rho, const global float* u, const global uchar* flags) {
 )+"#else"+R( // TEMPERATURE
@@ -3071,36 +3415,57 @@ string opencl_c_container() { return R( // ########################## begin of O
 	return color_reflect;
 }
 
-)+R(kernel void graphics_raytrace_phi(const global float* camera, global int* bitmap, const global int* skybox, const global float* phi, const global uchar* flags) { // marching cubes
-	const uint gid = get_global_id(0); // workgroup size alignment is critical
-	const uint lid = get_local_id(0); // make workgropus not horizontal stripes of pixels, but 8x8 rectangular (close to square) tiles
-	const uint lsi = get_local_size(0); // (50% performance boost due to more coalesced memory access)
-	const uint tile_width=8u, tile_height=lsi/tile_width, tiles_x=def_screen_width/tile_width;
-	const int lx=lid%tile_width, ly=lid/tile_width;
-	const int tx=(gid/lsi)%tiles_x, ty=(gid/lsi)/tiles_x;
-	const int x=tx*tile_width+lx, y=ty*tile_height+ly;
-	const uint n = x+y*def_screen_width;
-	float camera_cache[15]; // cache parameters in case the kernel draws more than one shape
-	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
-	ray camray = get_camray(x, y, camera_cache);
-	const float distance = intersect_cuboid(camray, (float3)(0.0f, 0.0f, 0.0f), (float)def_Nx, (float)def_Ny, (float)def_Nz);
+)+R(int raytrace_phi_color(ray camray, const global float* phi, const global uchar* flags, const global int* skybox, const uint Nx, const uint Ny, const uint Nz) { // color of one camera ray through the free surface in a lattice of size Nx*Ny*Nz
+	const float distance = intersect_cuboid(camray, (float3)(0.0f, 0.0f, 0.0f), (float)Nx, (float)Ny, (float)Nz);
 	camray.origin = camray.origin+fmax(distance+0.005f, 0.005f)*camray.direction;
 	ray reflection, transmission; // reflection and transmission
 	float reflectivity, transmissivity;
 	int pixelcolor = 0;
-	if(raytrace_phi(camray, &reflection, &transmission, &reflectivity, &transmissivity, phi, flags, skybox, def_Nx, def_Ny, def_Nz)) {
+	if(raytrace_phi(camray, &reflection, &transmission, &reflectivity, &transmissivity, phi, flags, skybox, Nx, Ny, Nz)) {
 		pixelcolor = last_ray(reflection, transmission, reflectivity, transmissivity, skybox); // 1 ray pass
 		//pixelcolor = raytrace_phi_next_ray(reflection, transmission, reflectivity, transmissivity, phi, flags, skybox); // 2 ray passes
 	} else {
 		pixelcolor = skybox_color(camray, skybox);
 	}
-	//if(raytrace_phi_mirror(camray, &reflection, phi, flags, skybox, def_Nx, def_Ny, def_Nz)) { // reflection only
+	//if(raytrace_phi_mirror(camray, &reflection, phi, flags, skybox, Nx, Ny, Nz)) { // reflection only
 	//	//pixelcolor = skybox_color(reflection, skybox); // 1 ray pass
 	//	pixelcolor = raytrace_phi_next_ray_mirror(reflection, phi, flags, skybox); // 2 ray passes
 	//} else {
 	//	pixelcolor = skybox_color(camray, skybox);
 	//}
-	bitmap[n] = pixelcolor; // no zbuffer required
+	return pixelcolor;
+}
+)+R(kernel void graphics_raytrace_phi(const global float* camera, global int* bitmap, const global int* skybox, const global float* phi, const global uchar* flags) { // marching cubes
+	const uint gid = get_global_id(0); // workgroup size alignment is critical
+	const uint lid = get_local_id(0); // make workgropus not horizontal stripes of pixels, but 8x8 rectangular (close to square) tiles
+	const uint lsi = get_local_size(0); // (50% performance boost due to more coalesced memory access)
+	const uint tile_width=8u, tile_height=lsi/tile_width, tiles_x=def_screen_width/tile_width;
+	const int lx=lid%tile_width, ly=lid/tile_width;
+	const int tx=(gid/lsi)%tiles_x, ty=(gid/lsi)/tiles_x;
+	const int x=tx*tile_width+lx, y=ty*tile_height+ly;
+	const uint n = x+y*def_screen_width;
+	float camera_cache[15]; // cache parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	const ray camray = get_camray(x, y, camera_cache);
+	bitmap[n] = raytrace_phi_color(camray, phi, flags, skybox, def_Nx, def_Ny, def_Nz); // no zbuffer required
+}
+)+R(kernel void graphics_raytrace_phi_gather(const global float* camera, global int* bitmap, const global int* zbuffer, const global int* skybox, const uint Mx, const uint My, const uint Mz, const float fx, const float fy, const float fz, const global float* phi, const global uchar* flags) { // multi-domain: raytrace the gathered lattice into the background of the composited frame
+	const uint gid = get_global_id(0); // workgroup size alignment is critical
+	const uint lid = get_local_id(0); // make workgropus not horizontal stripes of pixels, but 8x8 rectangular (close to square) tiles
+	const uint lsi = get_local_size(0); // (50% performance boost due to more coalesced memory access)
+	const uint tile_width=8u, tile_height=lsi/tile_width, tiles_x=def_screen_width/tile_width;
+	const int lx=lid%tile_width, ly=lid/tile_width;
+	const int tx=(gid/lsi)%tiles_x, ty=(gid/lsi)/tiles_x;
+	const int x=tx*tile_width+lx, y=ty*tile_height+ly;
+	const uint n = x+y*def_screen_width;
+	float camera_cache[15]; // cache parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+)+"#ifndef GRAPHICS_TRANSPARENCY"+R(
+	if(zbuffer[n]!=-2147483648) return; // keep rasterized geometry in front, as graphics_raytrace_phi() is overdrawn by it
+)+"#else"+R( // GRAPHICS_TRANSPARENCY
+	if(bitmap[n]!=def_background_color) return;
+)+"#endif"+R( // GRAPHICS_TRANSPARENCY
+	bitmap[n] = raytrace_phi_color(gathered_camray(x, y, camera_cache, (float3)(fx, fy, fz)), phi, flags, skybox, Mx, My, Mz);
 }
 )+"#endif"+R( // SURFACE
 
@@ -3117,6 +3482,391 @@ string opencl_c_container() { return R( // ########################## begin of O
 	//draw_circle(p, 0.5f, c, camera_cache, bitmap, zbuffer);
 }
 )+"#endif"+R( // PARTICLES
+
+)+R(uint3 lod_halo() { // the downsampled lattice only covers the domain interior, without halo layers
+	return (uint3)((uint)(def_Dx>1u), (uint)(def_Dy>1u), (uint)(def_Dz>1u));
+}
+)+R(uint3 lod_size(const uint lod) { // dimensions of the downsampled lattice, every cell is a brick of up to lod^3 lattice cells
+	const uint3 h = lod_halo();
+	return (uint3)((def_Nx-2u*h.x+lod-1u)/lod, (def_Ny-2u*h.y+lod-1u)/lod, (def_Nz-2u*h.z+lod-1u)/lod);
+}
+)+R(uint3 lod_coordinates(const uint n, const uint3 M) { // disassemble 1D index to 3D coordinates on the downsampled lattice
+	const uint t = n%(M.x*M.y);
+	return (uint3)(t%M.x, t/M.x, n/(M.x*M.y)); // n = x+(y+z*My)*Mx
+}
+)+R(float3 lod_position(const uint3 xyz, const uint lod) { // center of brick in the same coordinates as position()
+	const uint3 h = lod_halo();
+	const uint3 s = h+xyz*lod; // first lattice cell of brick
+	const float3 e = (float3)((float)min(lod, def_Nx-h.x-s.x), (float)min(lod, def_Ny-h.y-s.y), (float)min(lod, def_Nz-h.z-s.z)); // brick extent, smaller at the upper domain boundaries
+	return (float3)((float)s.x-0.5f*(float)def_Nx, (float)s.y-0.5f*(float)def_Ny, (float)s.z-0.5f*(float)def_Nz)+0.5f*e;
+}
+)+R(void lod_j8(const uint3 xyz, const uint3 M, uint* j) {
+	const uint x0 =   xyz.x; // cube stencil
+	const uint xp =   xyz.x+1u;
+	const uint y0 =   xyz.y    *M.x;
+	const uint yp =  (xyz.y+1u)*M.x;
+	const uint z0 =   xyz.z    *M.y*M.x;
+	const uint zp =  (xyz.z+1u)*M.y*M.x;
+	j[0] = x0+y0+z0; // 000
+	j[1] = xp+y0+z0; // +00
+	j[2] = xp+y0+zp; // +0+
+	j[3] = x0+y0+zp; // 00+
+	j[4] = x0+yp+z0; // 0+0
+	j[5] = xp+yp+z0; // ++0
+	j[6] = xp+yp+zp; // +++
+	j[7] = x0+yp+zp; // 0++
+} // lod_j8()
+)+R(void lod_j32(const uint3 xyz, const uint3 M, uint* j) { // same stencil as calculate_j32(), on the downsampled lattice
+	lod_j8(xyz, M, j);
+	const uint x0 =   xyz.x; // cube stencil
+	const uint xp =   xyz.x+1u;
+	const uint y0 =   xyz.y    *M.x;
+	const uint yp =  (xyz.y+1u)*M.x;
+	const uint z0 =   xyz.z    *M.y*M.x;
+	const uint zp =  (xyz.z+1u)*M.y*M.x;
+	const uint xq =  (xyz.x    +2u)%M.x; // central difference stencil on each cube corner point
+	const uint xm =  (xyz.x+M.x-1u)%M.x;
+	const uint yq = ((xyz.y    +2u)%M.y)*M.x;
+	const uint ym = ((xyz.y+M.y-1u)%M.y)*M.x;
+	const uint zq = ((xyz.z    +2u)%M.z)*M.y*M.x;
+	const uint zm = ((xyz.z+M.z-1u)%M.z)*M.y*M.x;
+	j[ 8] = xm+y0+z0; // -00
+	j[ 9] = x0+ym+z0; // 0-0
+	j[10] = x0+y0+zm; // 00-
+	j[11] = xq+y0+z0; // #00
+	j[12] = xp+ym+z0; // +-0
+	j[13] = xp+y0+zm; // +0-
+	j[14] = xq+y0+zp; // #0+
+	j[15] = xp+ym+zp; // +-+
+	j[16] = xp+y0+zq; // +0#
+	j[17] = xm+y0+zp; // -0+
+	j[18] = x0+ym+zp; // 0-+
+	j[19] = x0+y0+zq; // 00#
+	j[20] = xm+yp+z0; // -+0
+	j[21] = x0+yq+z0; // 0#0
+	j[22] = x0+yp+zm; // 0+-
+	j[23] = xq+yp+z0; // #+0
+	j[24] = xp+yq+z0; // +#0
+	j[25] = xp+yp+zm; // ++-
+	j[26] = xq+yp+zp; // #++
+	j[27] = xp+yq+zp; // +#+
+	j[28] = xp+yp+zq; // ++#
+	j[29] = xm+yp+zp; // -++
+	j[30] = x0+yq+zp; // 0#+
+	j[31] = x0+yp+zq; // 0+#
+} // lod_j32()
+)+R(float3 lod_load3(const uint n, const uint M, const global float* v) { // load float3 from SoA buffer of the downsampled lattice
+	return (float3)(v[n], v[M+n], v[2u*M+n]);
+}
+
+)+R(kernel void graphics_lod)+"("+R(const uint lod, const global float* rho, const global float* u, const global uchar* flags, global float* lod_rho, global float* lod_u, global uchar* lod_flags // ) {
+)+"#ifdef SURFACE"+R(
+	, const global float* phi, global float* lod_phi // argument order is important
+)+"#endif"+R( // SURFACE
+)+"#ifdef TEMPERATURE"+R(
+	, const global float* T, global float* lod_T // argument order is important
+)+"#endif"+R( // TEMPERATURE
+)+") {"+R( // graphics_lod(), average bricks of lod^3 lattice cells into one cell of the downsampled lattice
+	const uint3 M = lod_size(lod);
+	const uint n = get_global_id(0);
+	const uint N = M.x*M.y*M.z;
+	if(n>=N) return;
+	const uint3 h = lod_halo();
+	const uint3 s = h+lod_coordinates(n, M)*lod; // first lattice cell of brick
+	const uint3 e = (uint3)(min(s.x+lod, def_Nx-h.x), min(s.y+lod, def_Ny-h.y), min(s.z+lod, def_Nz-h.z)); // end of brick
+	uint count=0u, solid=0u, averaged=0u, fluid=0u, gas=0u;
+	uchar boundaries = 0u; // equilibrium and temperature boundaries are kept if any cell in the brick has them
+	float rhos=0.0f, phis=0.0f, Ts=0.0f;
+	float3 us = (float3)(0.0f, 0.0f, 0.0f);
+	for(uint z=s.z; z<e.z; z++) {
+		for(uint y=s.y; y<e.y; y++) {
+			for(uint x=s.x; x<e.x; x++) {
+				const uxx m = index((uint3)(x, y, z));
+				const uchar flagsm = flags[m];
+				count++;
+)+"#ifdef SURFACE"+R(
+				phis += phi[m];
+				fluid += (uint)((flagsm&TYPE_F)!=0u);
+				gas += (uint)((flagsm&TYPE_G)!=0u);
+)+"#endif"+R( // SURFACE
+				if((flagsm&TYPE_BO)==TYPE_S) {
+					solid++;
+					continue;
+				}
+				if((flagsm&TYPE_BO)==TYPE_E) boundaries |= TYPE_E;
+				boundaries |= flagsm&TYPE_T;
+				if(flagsm&TYPE_G) continue; // gas cells carry no meaningful fluid data
+				rhos += rho[m];
+				us += load3(m, u);
+)+"#ifdef TEMPERATURE"+R(
+				Ts += T[m];
+)+"#endif"+R( // TEMPERATURE
+				averaged++;
+			}
+		}
+	}
+	const float w = averaged>0u ? 1.0f/(float)averaged : 0.0f;
+	lod_rho[n] = averaged>0u ? w*rhos : 1.0f;
+	lod_u[      n] = w*us.x;
+	lod_u[   N+n] = w*us.y;
+	lod_u[2u*N+n] = w*us.z;
+	uchar flagsn = 2u*solid>=count ? TYPE_S : boundaries; // brick is solid if at least half of its cells are solid
+)+"#ifdef SURFACE"+R(
+	lod_phi[n] = phis/(float)count;
+	if(flagsn!=TYPE_S) flagsn |= 2u*gas>count ? TYPE_G : 2u*fluid>count ? TYPE_F : TYPE_I;
+)+"#endif"+R( // SURFACE
+)+"#ifdef TEMPERATURE"+R(
+	lod_T[n] = averaged>0u ? w*Ts : def_T_avg;
+)+"#endif"+R( // TEMPERATURE
+	lod_flags[n] = flagsn;
+}
+
+)+R(kernel void graphics_flags_lod(const global float* camera, global int* bitmap, global int* zbuffer, const uint lod, const global uchar* lod_flags) { // render flags of downsampled lattice as grid
+	const uint3 M = lod_size(lod);
+	const uint n = get_global_id(0);
+	if(n>=M.x*M.y*M.z) return;
+	const uchar flagsn = lod_flags[n]; // cache flags
+	if(flagsn==0u||flagsn==TYPE_G) return; // don't draw regular fluid cells
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	const uint3 xyz = lod_coordinates(n, M);
+	const float3 p = lod_position(xyz, lod);
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	const bool not_xp = xyz.x<M.x-1u && flagsn==lod_flags[n+1u        ]; // +00
+	const bool not_xm = xyz.x>    0u && flagsn==lod_flags[n-1u        ]; // -00
+	const bool not_yp = xyz.y<M.y-1u && flagsn==lod_flags[n+M.x       ]; // 0+0
+	const bool not_ym = xyz.y>    0u && flagsn==lod_flags[n-M.x       ]; // 0-0
+	const bool not_zp = xyz.z<M.z-1u && flagsn==lod_flags[n+M.x*M.y   ]; // 00+
+	const bool not_zm = xyz.z>    0u && flagsn==lod_flags[n-M.x*M.y   ]; // 00-
+	draw_flag_edges(p, 0.5f*(float)lod, not_xp, not_xm, not_yp, not_ym, not_zp, not_zm, flag_color(flagsn), camera_cache, bitmap, zbuffer);
+}
+
+)+R(kernel void graphics_flags_mc_lod(const global float* camera, global int* bitmap, global int* zbuffer, const uint lod, const global uchar* lod_flags) { // render solid boundaries of downsampled lattice with marching-cubes
+	const uint3 M = lod_size(lod);
+	const uint n = get_global_id(0);
+	if(n>=M.x*M.y*M.z) return;
+	const uint3 xyz = lod_coordinates(n, M);
+	if(xyz.x>=M.x-1u||xyz.y>=M.y-1u||xyz.z>=M.z-1u) return;
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	const float3 p = lod_position(xyz, lod);
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	uint j[8];
+	lod_j8(xyz, M, j);
+	bool v[8];
+	for(uint i=0u; i<8u; i++) v[i] = (lod_flags[j[i]]&TYPE_BO)==TYPE_S;
+	float3 triangles[15]; // maximum of 5 triangles with 3 vertices each
+	const uint tn = marching_cubes_halfway(v, triangles); // run marching cubes algorithm
+	if(tn==0u) return;
+	const float l = (float)lod; // scale triangles from unit cube to brick size
+	for(uint i=0u; i<tn; i++) {
+		const float3 p0 = p+l*triangles[3u*i   ];
+		const float3 p1 = p+l*triangles[3u*i+1u];
+		const float3 p2 = p+l*triangles[3u*i+2u];
+		const float3 normal = cross(p1-p0, p2-p0); // no normalize needed for shading()
+		const int c0 = shading(0xDFDFDF, p0, normal, camera_cache);
+		const int c1 = shading(0xDFDFDF, p1, normal, camera_cache);
+		const int c2 = shading(0xDFDFDF, p2, normal, camera_cache);
+		draw_triangle_interpolated(p0, p1, p2, c0, c1, c2, camera_cache, bitmap, zbuffer); // draw triangle with interpolated colors
+	}
+}
+
+)+R(kernel void graphics_field_slice_lod)+"("+R(const global float* camera, global int* bitmap, global int* zbuffer, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const uint lod, const global float* lod_rho, const global float* lod_u, const global uchar* lod_flags // ) {
+)+"#ifdef TEMPERATURE"+R(
+	, const global float* lod_T // argument order is important
+)+"#endif"+R( // TEMPERATURE
+)+") {"+R( // graphics_field_slice_lod(), slice through the downsampled lattice
+	const uint3 M = lod_size(lod), h = lod_halo();
+	const uint N = M.x*M.y*M.z;
+	const uint a = get_global_id(0);
+	const uint direction = (uint)clamp(slice_mode-1, 0, 2);
+	const uint area = direction==0u ? M.y*M.z : direction==1u ? M.x*M.z : M.x*M.y;
+	if(a>=area||slice_mode<1||slice_mode>3||(slice_mode==1&&(slice_x<(int)h.x||slice_x>=(int)(def_Nx-h.x)))||(slice_mode==2&&(slice_y<(int)h.y||slice_y>=(int)(def_Ny-h.y)))||(slice_mode==3&&(slice_z<(int)h.z||slice_z>=(int)(def_Nz-h.z)))) return;
+	uint3 xyz00, xyz01, xyz10, xyz11;
+	float3 normal;
+	switch(direction) {
+		case 0u: xyz00 = (uint3)(((uint)slice_x-h.x)/lod, a%M.y, a/M.y); if(xyz00.y>=M.y-1u||xyz00.z>=M.z-1u) return; xyz01 = xyz00+(uint3)(0u, 0u, 1u); xyz10 = xyz00+(uint3)(0u, 1u, 0u); xyz11 = xyz00+(uint3)(0u, 1u, 1u); normal = (float3)(1.0f, 0.0f, 0.0f); break;
+		case 1u: xyz00 = (uint3)(a/M.z, ((uint)slice_y-h.y)/lod, a%M.z); if(xyz00.x>=M.x-1u||xyz00.z>=M.z-1u) return; xyz01 = xyz00+(uint3)(0u, 0u, 1u); xyz10 = xyz00+(uint3)(1u, 0u, 0u); xyz11 = xyz00+(uint3)(1u, 0u, 1u); normal = (float3)(0.0f, 1.0f, 0.0f); break;
+		case 2u: xyz00 = (uint3)(a%M.x, a/M.x, ((uint)slice_z-h.z)/lod); if(xyz00.x>=M.x-1u||xyz00.y>=M.y-1u) return; xyz01 = xyz00+(uint3)(0u, 1u, 0u); xyz10 = xyz00+(uint3)(1u, 0u, 0u); xyz11 = xyz00+(uint3)(1u, 1u, 0u); normal = (float3)(0.0f, 0.0f, 1.0f); break;
+	}
+	float3 p00=lod_position(xyz00, lod), p01=lod_position(xyz01, lod), p10=lod_position(xyz10, lod), p11=lod_position(xyz11, lod);
+	const float3 ps = position((uint3)((uint)max(slice_x, 0), (uint)max(slice_y, 0), (uint)max(slice_z, 0))); // keep the slice exactly at its lattice position
+	switch(direction) {
+		case 0u: p00.x = p01.x = p10.x = p11.x = ps.x; break;
+		case 1u: p00.y = p01.y = p10.y = p11.y = ps.y; break;
+		case 2u: p00.z = p01.z = p10.z = p11.z = ps.z; break;
+	}
+	const float3 p = 0.25f*(p00+p01+p10+p11);
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	const uint n00=xyz00.x+(xyz00.y+xyz00.z*M.y)*M.x, n01=xyz01.x+(xyz01.y+xyz01.z*M.y)*M.x, n10=xyz10.x+(xyz10.y+xyz10.z*M.y)*M.x, n11=xyz11.x+(xyz11.y+xyz11.z*M.y)*M.x;
+	bool d00=true, d01=true, d10=true, d11=true;
+)+"#ifdef SURFACE"+R(
+	d00 = lod_flags[n00]&(TYPE_F|TYPE_I); // only draw fluid or interface cells
+	d01 = lod_flags[n01]&(TYPE_F|TYPE_I);
+	d10 = lod_flags[n10]&(TYPE_F|TYPE_I);
+	d11 = lod_flags[n11]&(TYPE_F|TYPE_I);
+	if((int)d00+(int)d01+(int)d10+(int)d11<3) return;
+)+"#endif"+R( // SURFACE
+	int c00=0, c01=0, c10=0, c11=0;
+	switch(field_mode) {
+		case 0: // coloring by velocity
+			c00 = colorscale_rainbow(def_scale_u*length(lod_load3(n00, N, lod_u)));
+			c01 = colorscale_rainbow(def_scale_u*length(lod_load3(n01, N, lod_u)));
+			c10 = colorscale_rainbow(def_scale_u*length(lod_load3(n10, N, lod_u)));
+			c11 = colorscale_rainbow(def_scale_u*length(lod_load3(n11, N, lod_u)));
+			break;
+		case 1: // coloring by density
+			c00 = colorscale_twocolor(0.5f+def_scale_rho*(lod_rho[n00]-1.0f));
+			c01 = colorscale_twocolor(0.5f+def_scale_rho*(lod_rho[n01]-1.0f));
+			c10 = colorscale_twocolor(0.5f+def_scale_rho*(lod_rho[n10]-1.0f));
+			c11 = colorscale_twocolor(0.5f+def_scale_rho*(lod_rho[n11]-1.0f));
+			break;
+)+"#ifdef TEMPERATURE"+R(
+		case 2: // coloring by temperature
+			c00 = colorscale_iron(0.5f+def_scale_T*(lod_T[n00]-def_T_avg));
+			c01 = colorscale_iron(0.5f+def_scale_T*(lod_T[n01]-def_T_avg));
+			c10 = colorscale_iron(0.5f+def_scale_T*(lod_T[n10]-def_T_avg));
+			c11 = colorscale_iron(0.5f+def_scale_T*(lod_T[n11]-def_T_avg));
+			break;
+)+"#endif"+R( // TEMPERATURE
+	}
+	c00 = shading(c00, p00, normal, camera_cache);
+	c01 = shading(c01, p01, normal, camera_cache);
+	c10 = shading(c10, p10, normal, camera_cache);
+	c11 = shading(c11, p11, normal, camera_cache);
+	const int c = color_average(color_average(c00, c11), color_average(c01, c10));
+	if(d00&&d01) draw_triangle_interpolated(p00, p01, p, c00, c01, c, camera_cache, bitmap, zbuffer);
+	if(d01&&d11) draw_triangle_interpolated(p01, p11, p, c01, c11, c, camera_cache, bitmap, zbuffer);
+	if(d11&&d10) draw_triangle_interpolated(p11, p10, p, c11, c10, c, camera_cache, bitmap, zbuffer);
+	if(d10&&d00) draw_triangle_interpolated(p10, p00, p, c10, c00, c, camera_cache, bitmap, zbuffer);
+}
+
+)+R(kernel void graphics_q_lod)+"("+R(const global float* camera, global int* bitmap, global int* zbuffer, const int field_mode, const uint lod, const global float* lod_rho, const global float* lod_u // ) {
+)+"#ifdef SURFACE"+R(
+	, const global uchar* lod_flags // argument order is important
+)+"#endif"+R( // SURFACE
+)+"#ifdef TEMPERATURE"+R(
+	, const global float* lod_T // argument order is important
+)+"#endif"+R( // TEMPERATURE
+)+") {"+R( // graphics_q_lod(), Q-criterion isosurface of the downsampled lattice
+	const uint3 M = lod_size(lod);
+	const uint n = get_global_id(0);
+	const uint N = M.x*M.y*M.z;
+	if(n>=N) return;
+	const uint3 xyz = lod_coordinates(n, M);
+	if(xyz.x>=M.x-1u||xyz.y>=M.y-1u||xyz.z>=M.z-1u) return;
+	if(((def_Dx>1u)&(xyz.x==0u||xyz.x>=M.x-2u))||((def_Dy>1u)&(xyz.y==0u||xyz.y>=M.y-2u))||((def_Dz>1u)&(xyz.z==0u||xyz.z>=M.z-2u))) return; // central differences would wrap around at domain boundaries
+	const float3 p = lod_position(xyz, lod);
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	uint j[32];
+	lod_j32(xyz, M, j);
+)+"#ifdef SURFACE"+R(
+	uchar flags_cell = 0u;
+	for(uint i=0u; i<8u; i++) flags_cell |= lod_flags[j[i]];
+	if(flags_cell&(TYPE_I|TYPE_G)) return;
+)+"#endif"+R( // SURFACE
+	float3 uj[32];
+	for(uint i=0u; i<32u; i++) uj[i] = lod_load3(j[i], N, lod_u);
+	float v[8]; // don't load any velocity twice from global memory
+	v[0] = calculate_Q_cached(uj[ 1], uj[ 8], uj[ 4], uj[ 9], uj[ 3], uj[10]);
+	v[1] = calculate_Q_cached(uj[11], uj[ 0], uj[ 5], uj[12], uj[ 2], uj[13]);
+	v[2] = calculate_Q_cached(uj[14], uj[ 3], uj[ 6], uj[15], uj[16], uj[ 1]);
+	v[3] = calculate_Q_cached(uj[ 2], uj[17], uj[ 7], uj[18], uj[19], uj[ 0]);
+	v[4] = calculate_Q_cached(uj[ 5], uj[20], uj[21], uj[ 0], uj[ 7], uj[22]);
+	v[5] = calculate_Q_cached(uj[23], uj[ 4], uj[24], uj[ 1], uj[ 6], uj[25]);
+	v[6] = calculate_Q_cached(uj[26], uj[ 7], uj[27], uj[ 2], uj[28], uj[ 5]);
+	v[7] = calculate_Q_cached(uj[ 6], uj[29], uj[30], uj[ 3], uj[31], uj[ 4]);
+	const float l = (float)lod; // velocity differences span lod times more lattice cells, so Q scales with lod^2
+	float3 triangles[15]; // maximum of 5 triangles with 3 vertices each
+	const uint tn = marching_cubes(v, def_scale_Q_min*sq(l), triangles); // run marching cubes algorithm
+	if(tn==0u) return;
+	for(uint i=0u; i<tn; i++) {
+		const float3 p0 = triangles[3u*i   ]; // triangle coordinates in [0,1] (local cell)
+		const float3 p1 = triangles[3u*i+1u];
+		const float3 p2 = triangles[3u*i+2u];
+		const float3 normal = cross(p1-p0, p2-p0); // no normalize needed for shading()
+		int c0=0, c1=0, c2=0;
+		switch(field_mode) {
+			case 0: // coloring by velocity
+				c0 = shading(colorscale_rainbow(def_scale_u*length(trilinear3(p0, uj))), p+l*p0, normal, camera_cache);
+				c1 = shading(colorscale_rainbow(def_scale_u*length(trilinear3(p1, uj))), p+l*p1, normal, camera_cache);
+				c2 = shading(colorscale_rainbow(def_scale_u*length(trilinear3(p2, uj))), p+l*p2, normal, camera_cache);
+				break;
+			case 1: // coloring by density
+				for(uint i=0u; i<8u; i++) v[i] = lod_rho[j[i]];
+				c0 = shading(colorscale_twocolor(0.5f+def_scale_rho*(trilinear(p0, v)-1.0f)), p+l*p0, normal, camera_cache);
+				c1 = shading(colorscale_twocolor(0.5f+def_scale_rho*(trilinear(p1, v)-1.0f)), p+l*p1, normal, camera_cache);
+				c2 = shading(colorscale_twocolor(0.5f+def_scale_rho*(trilinear(p2, v)-1.0f)), p+l*p2, normal, camera_cache);
+				break;
+)+"#ifdef TEMPERATURE"+R(
+			case 2: // coloring by temperature
+				for(uint i=0u; i<8u; i++) v[i] = lod_T[j[i]];
+				c0 = shading(colorscale_iron(0.5f+def_scale_T*(trilinear(p0, v)-def_T_avg)), p+l*p0, normal, camera_cache);
+				c1 = shading(colorscale_iron(0.5f+def_scale_T*(trilinear(p1, v)-def_T_avg)), p+l*p1, normal, camera_cache);
+				c2 = shading(colorscale_iron(0.5f+def_scale_T*(trilinear(p2, v)-def_T_avg)), p+l*p2, normal, camera_cache);
+				break;
+)+"#endif"+R( // TEMPERATURE
+		}
+		draw_triangle_interpolated(p+l*p0, p+l*p1, p+l*p2, c0, c1, c2, camera_cache, bitmap, zbuffer); // draw triangle with interpolated colors
+	}
+}
+
+)+"#ifdef SURFACE"+R(
+)+R(kernel void graphics_rasterize_phi_lod(const global float* camera, global int* bitmap, global int* zbuffer, const uint lod, const global float* lod_phi) { // marching cubes on the downsampled lattice
+	const uint3 M = lod_size(lod);
+	const uint n = get_global_id(0);
+	if(n>=M.x*M.y*M.z) return;
+	const uint3 xyz = lod_coordinates(n, M);
+	if(xyz.x>=M.x-1u||xyz.y>=M.y-1u||xyz.z>=M.z-1u) return;
+	const float3 p = lod_position(xyz, lod);
+	float camera_cache[15]; // cache camera parameters in case the kernel draws more than one shape
+	for(uint i=0u; i<15u; i++) camera_cache[i] = camera[i];
+	if(!is_in_camera_frustrum(p, camera_cache)) return; // skip loading LBM data if grid cell is not visible
+	uint j[8];
+	lod_j8(xyz, M, j);
+	float v[8];
+	for(uint i=0u; i<8u; i++) v[i] = lod_phi[j[i]];
+	float3 triangles[15]; // maximum of 5 triangles with 3 vertices each
+	const uint tn = marching_cubes(v, 0.502f, triangles); // run marching cubes algorithm, isovalue slightly larger than 0.5f to fix z-fighting with graphics_flags_mc_lod()
+	if(tn==0u) return;
+	const float l = (float)lod; // scale triangles from unit cube to brick size
+	for(uint i=0u; i<tn; i++) {
+		const float3 p0 = p+l*triangles[3u*i   ];
+		const float3 p1 = p+l*triangles[3u*i+1u];
+		const float3 p2 = p+l*triangles[3u*i+2u];
+		const float3 normal = cross(p1-p0, p2-p0); // no normalize needed for shading()
+		const int c0 = shading(0x379BFF, p0, normal, camera_cache);
+		const int c1 = shading(0x379BFF, p1, normal, camera_cache);
+		const int c2 = shading(0x379BFF, p2, normal, camera_cache);
+		draw_triangle_interpolated(p0, p1, p2, c0, c1, c2, camera_cache, bitmap, zbuffer);
+	}
+}
+)+"#endif"+R( // SURFACE
+
+)+R(kernel void graphics_yuv420(const global int* bitmap, global uchar* yuv) { // convert frame to planar YUV 4:2:0 (BT.709, limited range) for video streaming, one thread per 2x2 pixel block
+	const uint n = get_global_id(0);
+	const uint cw=(def_screen_width+1u)/2u, ch=(def_screen_height+1u)/2u; // chroma plane dimensions
+	if(n>=cw*ch) return;
+	const uint cx=n%cw, cy=n/cw;
+	float3 sum = (float3)(0.0f, 0.0f, 0.0f);
+	for(uint j=0u; j<2u; j++) {
+		for(uint i=0u; i<2u; i++) {
+			const uint x=min(2u*cx+i, def_screen_width-1u), y=min(2u*cy+j, def_screen_height-1u); // replicate edge pixels for odd frame dimensions
+			const int c = bitmap[x+y*def_screen_width];
+			const float3 rgb = (float3)((float)((c>>16)&255), (float)((c>>8)&255), (float)(c&255));
+			yuv[x+y*def_screen_width] = (uchar)clamp(16.0f+0.858824f*dot((float3)(0.2126f, 0.7152f, 0.0722f), rgb)+0.5f, 0.0f, 255.0f);
+			sum += rgb;
+		}
+	}
+	sum *= 0.25f;
+	const uint chroma = def_screen_width*def_screen_height;
+	yuv[chroma      +n] = (uchar)clamp(128.0f+0.878431f*dot((float3)(-0.1146f, -0.3854f,  0.5000f), sum)+0.5f, 0.0f, 255.0f); // U
+	yuv[chroma+cw*ch+n] = (uchar)clamp(128.0f+0.878431f*dot((float3)( 0.5000f, -0.4542f, -0.0458f), sum)+0.5f, 0.0f, 255.0f); // V
+}
 )+"#endif"+R( // GRAPHICS
 
 
@@ -46,6 +46,12 @@ uint bytes_per_cell_device() { // returns the number of Bytes per cell allocated
 #ifdef TEMPERATURE
 	bytes_per_cell += 7u*sizeof(fpxx)+4u; // gi, T
 #endif // TEMPERATURE
+#ifdef TEMPORAL_BLOCKING
+	bytes_per_cell += velocity_set*sizeof(fpxx); // fi_tb
+#endif // TEMPORAL_BLOCKING
+#ifdef ACTIVE_CELLS
+	bytes_per_cell += 4u; // active_cells
+#endif // ACTIVE_CELLS
 	return bytes_per_cell;
 }
 uint bandwidth_bytes_per_cell_device() { // returns the bandwidth in Bytes per cell per time step from/to device memory
@@ -103,6 +109,16 @@ LBM_Domain::LBM_Domain(const Device_Info& device_info, const uint Nx, const uint
 	this->alpha = alpha; this->beta = beta;
 	this->particles_N = particles_N;
 	this->particles_rho = particles_rho;
+#ifdef TEMPORAL_BLOCKING
+	{ // choose tile size such that the region buffer of one work-group (tile plus halo of TEMPORAL_BLOCKING cells on each side) fits into half of the device cache
+		const float region_cells = 0.5f*1024.0f*(float)device_info.global_cache/(float)(velocity_set*4u);
+		const uint T = (uint)clamp((int)(dimensions==3u ? cbrt(region_cells) : sqrt(region_cells))-2*(int)TEMPORAL_BLOCKING, 4, 64);
+		tb_Tx = min(T, Nx);
+		tb_Ty = min(T, Ny);
+		tb_Tz = dimensions==3u ? min(T, Nz) : 1u;
+		tb_groups = max(device_info.compute_units, 1u);
+	}
+#endif // TEMPORAL_BLOCKING
 	string opencl_c_code;
 #ifdef GRAPHICS
 	graphics = Graphics(this);
@@ -117,6 +133,9 @@ LBM_Domain::LBM_Domain(const Device_Info& device_info, const uint Nx, const uint
 	graphics.allocate(device); // graphics after lbm
 #endif // GRAPHICS
 }
+LBM_Domain::~LBM_Domain() {
+	for(Rigid_Mesh* rigid_mesh : rigid_meshes) delete rigid_mesh; // released meshes are nullptr
+}
 
 void LBM_Domain::allocate(Device& device) {
 	const ulong N = get_N();
@@ -127,6 +146,9 @@ void LBM_Domain::allocate(Device& device) {
 	kernel_initialize = Kernel(device, N, "initialize", fi, rho, u, flags);
 	kernel_stream_collide = Kernel(device, N, "stream_collide", fi, rho, u, flags, t, fx, fy, fz);
 	kernel_update_fields = Kernel(device, N, "update_fields", fi, rho, u, flags, t, fx, fy, fz);
+	flag_count = Memory<uint>(device, 3u); // matching cells, bitwise-or of all flags, moving boundary cells
+	kernel_count_flags = Kernel(device, N, "count_flags", flags, u, (uchar)0xFFu, (uchar)0u, flag_count);
+	isosurface_count = Memory<uint>(device, 1u); // isosurface_triangles and kernel_extract_isosurface are only allocated with the first extraction
 
 #ifdef FORCE_FIELD
 	F = Memory<float>(device, N, 3u);
@@ -172,6 +194,26 @@ void LBM_Domain::allocate(Device& device) {
 #endif // FORCE_FIELD
 #endif // PARTICLES
 
+#ifdef TEMPORAL_BLOCKING
+	const uint tb_R = (tb_Tx+2u*TEMPORAL_BLOCKING)*(tb_Ty+2u*TEMPORAL_BLOCKING)*(tb_Tz+2u*TEMPORAL_BLOCKING*(dimensions==3u));
+	fi_tb = Memory<fpxx>(device, N, velocity_set, false);
+	tb_region = Memory<float>(device, (ulong)tb_groups*(ulong)(velocity_set*tb_R), 1u, false);
+	kernel_stream_collide_tb = Kernel(device, (ulong)tb_groups*(ulong)WORKGROUP_SIZE, "stream_collide_tb", fi, fi_tb, tb_region, rho, u, flags, t, fx, fy, fz);
+#ifdef FORCE_FIELD
+	kernel_stream_collide_tb.add_parameters(F);
+#endif // FORCE_FIELD
+#endif // TEMPORAL_BLOCKING
+
+#ifdef ACTIVE_CELLS
+	active_cells = Memory<uint>(device, N, 1u, false);
+	active_count = Memory<uint>(device, 1u, 1u, true, true, 0u);
+	kernel_update_active_cells = Kernel(device, N, "update_active_cells", flags, active_cells, active_count);
+	kernel_stream_collide.add_parameters(active_cells, active_count);
+#ifdef SURFACE
+	kernel_surface_0.add_parameters(active_cells, active_count);
+#endif // SURFACE
+#endif // ACTIVE_CELLS
+
 	if(get_D()>1u) allocate_transfer(device);
 }
 
@@ -181,6 +223,18 @@ void LBM_Domain::enqueue_initialize() { // call kernel_initialize
 void LBM_Domain::enqueue_stream_collide() { // call kernel_stream_collide to perform one LBM time step
 	kernel_stream_collide.set_parameters(4u, t, fx, fy, fz).enqueue_run();
 }
+#ifdef TEMPORAL_BLOCKING
+void LBM_Domain::enqueue_stream_collide_tb() { // call kernel_stream_collide_tb to perform TEMPORAL_BLOCKING LBM time steps at once
+	kernel_stream_collide_tb.set_parameters(0u, fi, fi_tb).set_parameters(6u, t, fx, fy, fz).enqueue_run();
+	fi.swap_device_buffer(fi_tb); // updated DDFs are now in fi, fi keeps its host buffer for checkpoints and export, re-link all kernels that access fi
+	kernel_initialize.set_parameters(0u, fi);
+	kernel_stream_collide.set_parameters(0u, fi);
+	kernel_update_fields.set_parameters(0u, fi);
+#ifdef FORCE_FIELD
+	kernel_update_force_field.set_parameters(0u, fi);
+#endif // FORCE_FIELD
+}
+#endif // TEMPORAL_BLOCKING
 void LBM_Domain::enqueue_update_fields() { // update fields (rho, u, T) manually
 #ifndef UPDATE_FIELDS
 	if(t!=t_last_update_fields) { // only run kernel_update_fields if the time step has changed since last update
@@ -189,6 +243,29 @@ void LBM_Domain::enqueue_update_fields() { // update fields (rho, u, T) manually
 	}
 #endif // UPDATE_FIELDS
 }
+void LBM_Domain::enqueue_count_flags(const uchar flag_value, const uchar flag_mask) { // count cells with (flags&flag_mask)==flag_value into flag_count
+	flag_count[0] = 0u; // reset flag_count
+	flag_count[1] = 0u;
+	flag_count[2] = 0u;
+	flag_count.enqueue_write_to_device();
+	kernel_count_flags.set_parameters(2u, flag_mask, flag_value).enqueue_run();
+	flag_count.enqueue_read_from_device();
+}
+void LBM_Domain::enqueue_extract_isosurface(const uint field, const float iso) { // compact triangles of the isosurface of field at isovalue iso into isosurface_triangles and their number into isosurface_count
+	const ulong required = (ulong)isosurface_count[0]; // number of triangles of the previous extraction
+	if(isosurface_triangles.length()==0ull||isosurface_triangles.length()<9ull*required) { // (re-)allocate with some headroom, the kernel has to be recreated for the new buffer
+		const ulong capacity = min(max(required+required/4ull, (ulong)65536u), (ulong)max_uint);
+		isosurface_triangles = Memory<float>(device, 9ull*capacity);
+		kernel_extract_isosurface = Kernel(device, get_N(), "extract_isosurface", field, iso, u, isosurface_triangles, isosurface_count, (uint)capacity);
+#ifdef SURFACE
+		kernel_extract_isosurface.add_parameters(phi, flags);
+#endif // SURFACE
+	}
+	isosurface_count[0] = 0u; // reset isosurface_count
+	isosurface_count.enqueue_write_to_device();
+	kernel_extract_isosurface.set_parameters(0u, field, iso).enqueue_run();
+	isosurface_count.enqueue_read_from_device();
+}
 #ifdef SURFACE
 void LBM_Domain::enqueue_surface_0() {
 	kernel_surface_0.set_parameters(7u, t, fx, fy, fz).enqueue_run();
@@ -264,39 +341,82 @@ void LBM_Domain::reset_time_step() {
 	t_last_update_fields = t;
 #endif // UPDATE_FIELDS
 }
+#ifdef ACTIVE_CELLS
+void LBM_Domain::enqueue_update_active_cells() { // rebuild compacted list of active cells after flags have changed
+	active_count[0] = 0u;
+	active_count.enqueue_write_to_device();
+	kernel_update_active_cells.enqueue_run();
+}
+void LBM_Domain::update_active_cells_range() { // read number of active cells from device and shrink kernel ranges accordingly (blocking)
+	active_count.read_from_device();
+	kernel_stream_collide.set_ranges(max((ulong)active_count[0], 1ull)); // remaining work-items return immediately
+}
+#endif // ACTIVE_CELLS
+
 void LBM_Domain::finish_queue() {
 	device.finish_queue();
 }
+void LBM_Domain::enqueue_marker(Event* event_returned) {
+	device.enqueue_marker(event_returned);
+}
 
 uint LBM_Domain::get_velocity_set() const {
 	return velocity_set;
 }
 
-void LBM_Domain::voxelize_mesh_on_device(const Mesh* mesh, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity) { // voxelize triangle mesh
-	Memory<float3> p0(device, mesh->triangle_number, 1u, mesh->p0);
-	Memory<float3> p1(device, mesh->triangle_number, 1u, mesh->p1);
-	Memory<float3> p2(device, mesh->triangle_number, 1u, mesh->p2);
-	Memory<float> bounding_box_and_velocity(device, 16u);
-	const float x0=mesh->pmin.x-2.0f, y0=mesh->pmin.y-2.0f, z0=mesh->pmin.z-2.0f, x1=mesh->pmax.x+2.0f, y1=mesh->pmax.y+2.0f, z1=mesh->pmax.z+2.0f; // use bounding box of mesh to speed up voxelization; add tolerance of 2 cells for re-voxelization of moving objects
-	bounding_box_and_velocity[ 0] = as_float(mesh->triangle_number);
-	bounding_box_and_velocity[ 1] = x0;
-	bounding_box_and_velocity[ 2] = y0;
-	bounding_box_and_velocity[ 3] = z0;
-	bounding_box_and_velocity[ 4] = x1;
-	bounding_box_and_velocity[ 5] = y1;
-	bounding_box_and_velocity[ 6] = z1;
-	bounding_box_and_velocity[ 7] = rotation_center.x;
-	bounding_box_and_velocity[ 8] = rotation_center.y;
-	bounding_box_and_velocity[ 9] = rotation_center.z;
-	bounding_box_and_velocity[10] = linear_velocity.x;
-	bounding_box_and_velocity[11] = linear_velocity.y;
-	bounding_box_and_velocity[12] = linear_velocity.z;
-	bounding_box_and_velocity[13] = rotational_velocity.x;
-	bounding_box_and_velocity[14] = rotational_velocity.y;
-	bounding_box_and_velocity[15] = rotational_velocity.z;
+void bin_mesh_triangles(const Mesh* mesh, const uint direction, const float u0, const float v0, const float u1, const float v1, uint& bins_u, uint& bins_v, float& bin_size, vector<uint>& bin_offsets, vector<uint>& bin_triangles) { // sort triangles into 2D bins in the ray plane of voxelize_mesh, so each ray only tests triangles that overlap its column
+	const uint du=(direction+1u)%3u, dv=(direction+2u)%3u; // ray plane axes: (y, z) for rays in x-direction, (z, x) in y-direction, (x, y) in z-direction
+	const auto axis = [](const float3& p, const uint i) { return i==0u ? p.x : i==1u ? p.y : p.z; };
+	const float su=fmax(u1-u0, 0.0f), sv=fmax(v1-v0, 0.0f); // size of ray plane region, empty if mesh does not overlap this domain
+	bin_size = fmax(fmax(sqrt(su*sv/(float)max(mesh->triangle_number, 1u)), 1.0f), fmax(su, sv)/4096.0f); // about one triangle per bin, bins are not smaller than one cell, at most 4096 bins per axis
+	bins_u = clamp((uint)ceil(su/bin_size), 1u, 4096u);
+	bins_v = clamp((uint)ceil(sv/bin_size), 1u, 4096u);
+	const uint bins = bins_u*bins_v;
+	const float bin_inverse_size = 1.0f/bin_size;
+	const auto bin_range = [&](const uint i, uint& iu0, uint& iv0, uint& iu1, uint& iv1) { // range of bins that bounding box of triangle i overlaps, returns false if there is none
+		const float3 p0i=mesh->p0[i], p1i=mesh->p1[i], p2i=mesh->p2[i];
+		const float tu0 = fmin(fmin(axis(p0i, du), axis(p1i, du)), axis(p2i, du))-0.001f, tu1 = fmax(fmax(axis(p0i, du), axis(p1i, du)), axis(p2i, du))+0.001f; // small tolerance against rounding differences to the kernel
+		const float tv0 = fmin(fmin(axis(p0i, dv), axis(p1i, dv)), axis(p2i, dv))-0.001f, tv1 = fmax(fmax(axis(p0i, dv), axis(p1i, dv)), axis(p2i, dv))+0.001f;
+		if(su==0.0f||sv==0.0f||tu1<u0||tv1<v0||tu0>u1||tv0>v1) return false;
+		iu0 = (uint)clamp((int)((tu0-u0)*bin_inverse_size), 0, (int)bins_u-1); iu1 = (uint)clamp((int)((tu1-u0)*bin_inverse_size), 0, (int)bins_u-1);
+		iv0 = (uint)clamp((int)((tv0-v0)*bin_inverse_size), 0, (int)bins_v-1); iv1 = (uint)clamp((int)((tv1-v0)*bin_inverse_size), 0, (int)bins_v-1);
+		return true;
+	};
+	vector<std::atomic_uint> bin_counts(bins); // count triangles per bin
+	parallel_for(mesh->triangle_number, [&](uint i) {
+		uint iu0=0u, iv0=0u, iu1=0u, iv1=0u;
+		if(bin_range(i, iu0, iv0, iu1, iv1)) for(uint iv=iv0; iv<=iv1; iv++) for(uint iu=iu0; iu<=iu1; iu++) bin_counts[iu+iv*bins_u]++;
+	});
+	bin_offsets.resize(bins+1u);
+	ulong count = 0ull;
+	for(uint b=0u; b<bins; b++) { // exclusive prefix sum
+		bin_offsets[b] = (uint)count;
+		count += (ulong)bin_counts[b];
+		bin_counts[b] = (uint)count-bin_counts[b]; // reuse as insertion cursor
+	}
+	if(count>=(ulong)max_uint) { // too many bin entries for 32-bit offsets, fall back to a single bin with all triangles
+		bins_u = bins_v = 1u;
+		bin_size = fmax(fmax(su, sv), 1.0f);
+		bin_offsets = { 0u, mesh->triangle_number };
+		bin_triangles.resize(max(mesh->triangle_number, 1u));
+		for(uint i=0u; i<mesh->triangle_number; i++) bin_triangles[i] = i;
+		return;
+	}
+	bin_offsets[bins] = (uint)count;
+	bin_triangles.resize(max((uint)count, 1u)); // Memory size must be larger than 0
+	parallel_for(mesh->triangle_number, [&](uint i) {
+		uint iu0=0u, iv0=0u, iu1=0u, iv1=0u;
+		if(bin_range(i, iu0, iv0, iu1, iv1)) for(uint iv=iv0; iv<=iv1; iv++) for(uint iu=iu0; iu<=iu1; iu++) bin_triangles[bin_counts[iu+iv*bins_u]++] = i;
+	});
+	parallel_for(bins, [&](uint b) { // sort triangles in each bin, so that intersection order is deterministic
+		std::sort(bin_triangles.begin()+bin_offsets[b], bin_triangles.begin()+bin_offsets[b+1u]);
+	});
+}
+
+uint voxelization_direction(const float3& bounding_box_size, const float3& rotational_velocity) { // choose ray direction for voxelize_mesh
 	uint direction = 0u;
 	if(length(rotational_velocity)==0.0f) { // choose direction of minimum bounding-box cross-section area
-		float v[3] = { (y1-y0)*(z1-z0), (z1-z0)*(x1-x0), (x1-x0)*(y1-y0) };
+		float v[3] = { bounding_box_size.y*bounding_box_size.z, bounding_box_size.z*bounding_box_size.x, bounding_box_size.x*bounding_box_size.y };
 		float vmin = v[0];
 		for(uint i=1u; i<3u; i++) {
 			if(v[i]<vmin) {
@@ -314,28 +434,135 @@ void LBM_Domain::voxelize_mesh_on_device(const Mesh* mesh, const uchar flag, con
 			}
 		}
 	}
+	return direction;
+}
+void set_voxelization_parameters(Memory<float>& bbu, const uint triangle_number, const float3& pmin, const float3& pmax, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity, const float3x3& inverse_rotation, const float3& inverse_translation) { // fill parameter array of voxelize_mesh kernel, bins in bbu[16..20] are set separately
+	bbu[ 0] = as_float(triangle_number);
+	bbu[ 1] = pmin.x-2.0f; // use bounding box of mesh to speed up voxelization; add tolerance of 2 cells for re-voxelization of moving objects
+	bbu[ 2] = pmin.y-2.0f;
+	bbu[ 3] = pmin.z-2.0f;
+	bbu[ 4] = pmax.x+2.0f;
+	bbu[ 5] = pmax.y+2.0f;
+	bbu[ 6] = pmax.z+2.0f;
+	bbu[ 7] = rotation_center.x;
+	bbu[ 8] = rotation_center.y;
+	bbu[ 9] = rotation_center.z;
+	bbu[10] = linear_velocity.x;
+	bbu[11] = linear_velocity.y;
+	bbu[12] = linear_velocity.z;
+	bbu[13] = rotational_velocity.x;
+	bbu[14] = rotational_velocity.y;
+	bbu[15] = rotational_velocity.z;
+	bbu[21] = inverse_rotation.xx; bbu[22] = inverse_rotation.xy; bbu[23] = inverse_rotation.xz; // transforms ray from lattice into mesh coordinates: p_mesh = inverse_rotation*p_lattice+inverse_translation
+	bbu[24] = inverse_rotation.yx; bbu[25] = inverse_rotation.yy; bbu[26] = inverse_rotation.yz;
+	bbu[27] = inverse_rotation.zx; bbu[28] = inverse_rotation.zy; bbu[29] = inverse_rotation.zz;
+	bbu[30] = inverse_translation.x;
+	bbu[31] = inverse_translation.y;
+	bbu[32] = inverse_translation.z;
+}
+
+void LBM_Domain::voxelize_mesh_on_device(const Mesh* mesh, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity) { // voxelize triangle mesh
+	Memory<float> vertices(device, mesh->packed_length(), 1u, mesh->packed_data()); // one buffer for all vertices, zero-copy on CPUs/iGPUs as packed mesh data is aligned
+	Memory<float> bounding_box_and_velocity(device, 33u);
+	set_voxelization_parameters(bounding_box_and_velocity, mesh->triangle_number, mesh->pmin, mesh->pmax, rotation_center, linear_velocity, rotational_velocity, float3x3(1.0f), float3(0.0f));
+	const uint direction = voxelization_direction(mesh->pmax-mesh->pmin+4.0f, rotational_velocity);
+	const float domain_min[3] = { (float)Ox, (float)Oy, (float)Oz }, domain_max[3] = { (float)Ox+(float)Nx, (float)Oy+(float)Ny, (float)Oz+(float)Nz }; // extent of this domain in global lattice coordinates
+	const float mesh_min[3] = { bounding_box_and_velocity[1], bounding_box_and_velocity[2], bounding_box_and_velocity[3] }, mesh_max[3] = { bounding_box_and_velocity[4], bounding_box_and_velocity[5], bounding_box_and_velocity[6] };
+	const uint du=(direction+1u)%3u, dv=(direction+2u)%3u; // ray plane axes
+	const float u0=fmax(mesh_min[du], domain_min[du]), v0=fmax(mesh_min[dv], domain_min[dv]), u1=fmin(mesh_max[du], domain_max[du]), v1=fmin(mesh_max[dv], domain_max[dv]); // bin only the part of the ray plane where this domain casts rays
+	uint bins_u=1u, bins_v=1u;
+	float bin_size = 1.0f;
+	vector<uint> bin_offsets_host, bin_triangles_host;
+	bin_mesh_triangles(mesh, direction, u0, v0, u1, v1, bins_u, bins_v, bin_size, bin_offsets_host, bin_triangles_host);
+	Memory<uint> bin_offsets(device, bin_offsets_host.size(), 1u, bin_offsets_host.data());
+	Memory<uint> bin_triangles(device, bin_triangles_host.size(), 1u, bin_triangles_host.data());
+	bounding_box_and_velocity[16] = u0;
+	bounding_box_and_velocity[17] = v0;
+	bounding_box_and_velocity[18] = 1.0f/bin_size;
+	bounding_box_and_velocity[19] = as_float(bins_u);
+	bounding_box_and_velocity[20] = as_float(bins_v);
 	const ulong A[3] = { (ulong)Ny*(ulong)Nz, (ulong)Nz*(ulong)Nx, (ulong)Nx*(ulong)Ny };
-	Kernel kernel_voxelize_mesh(device, A[direction], "voxelize_mesh", direction, fi, u, flags, t+1ull, flag, p0, p1, p2, bounding_box_and_velocity);
+	Kernel kernel_voxelize_mesh(device, A[direction], "voxelize_mesh", direction, fi, u, flags, t+1ull, flag, vertices, bin_offsets, bin_triangles, bounding_box_and_velocity);
 #ifdef SURFACE
 	kernel_voxelize_mesh.add_parameters(mass, massex);
 #endif // SURFACE
-	p0.write_to_device();
-	p1.write_to_device();
-	p2.write_to_device();
 	bounding_box_and_velocity.write_to_device();
 	kernel_voxelize_mesh.run();
-}
-void LBM_Domain::voxelize_sdf_on_device(const SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag) { // voxelize SDF on GPU
-	// Upload SDF data to GPU
-	const ulong sdf_size = (ulong)sdf->Nx * (ulong)sdf->Ny * (ulong)sdf->Nz;
-	Memory<float> sdf_data(device, sdf_size, 1u, sdf->data);
-
+	finish_queue(); // vertices and bins are zero-copy on CPUs/iGPUs, so the kernel must be done before the caller can delete the mesh
+}
+uint LBM_Domain::upload_rigid_mesh(const Mesh* mesh, const float3& rotation_axis) { // upload triangles and triangle bins once, they stay resident in device memory
+	Rigid_Mesh* rigid_mesh = new Rigid_Mesh();
+	rigid_mesh->triangle_number = mesh->triangle_number;
+	rigid_mesh->mesh_pmin = mesh->pmin;
+	rigid_mesh->mesh_pmax = mesh->pmax;
+	rigid_mesh->direction = voxelization_direction(mesh->pmax-mesh->pmin+4.0f, rotation_axis);
+	const uint du=(rigid_mesh->direction+1u)%3u, dv=(rigid_mesh->direction+2u)%3u; // ray plane axes
+	const float mesh_min[3] = { mesh->pmin.x, mesh->pmin.y, mesh->pmin.z }, mesh_max[3] = { mesh->pmax.x, mesh->pmax.y, mesh->pmax.z };
+	rigid_mesh->u0 = mesh_min[du];
+	rigid_mesh->v0 = mesh_min[dv];
+	bin_mesh_triangles(mesh, rigid_mesh->direction, mesh_min[du], mesh_min[dv], mesh_max[du], mesh_max[dv], rigid_mesh->bins_u, rigid_mesh->bins_v, rigid_mesh->bin_size, rigid_mesh->bin_offsets_host, rigid_mesh->bin_triangles_host); // bins in mesh coordinates
+	rigid_mesh->vertices = Memory<float>(device, mesh->packed_length()); // owned copy, so the host mesh can be modified or deleted after upload
+	std::copy(mesh->packed_data(), mesh->packed_data()+mesh->packed_length(), rigid_mesh->vertices.data());
+	rigid_mesh->vertices.write_to_device();
+	rigid_mesh->bin_offsets = Memory<uint>(device, rigid_mesh->bin_offsets_host.size(), 1u, rigid_mesh->bin_offsets_host.data());
+	rigid_mesh->bin_triangles = Memory<uint>(device, rigid_mesh->bin_triangles_host.size(), 1u, rigid_mesh->bin_triangles_host.data());
+	rigid_mesh->parameters = Memory<float>(device, 33u);
+	const ulong A[3] = { (ulong)Ny*(ulong)Nz, (ulong)Nz*(ulong)Nx, (ulong)Nx*(ulong)Ny };
+	rigid_mesh->kernel_voxelize_mesh = Kernel(device, A[rigid_mesh->direction], "voxelize_mesh", rigid_mesh->direction, fi, u, flags, t+1ull, (uchar)TYPE_S, rigid_mesh->vertices, rigid_mesh->bin_offsets, rigid_mesh->bin_triangles, rigid_mesh->parameters);
+#ifdef SURFACE
+	rigid_mesh->kernel_voxelize_mesh.add_parameters(mass, massex);
+#endif // SURFACE
+	rigid_meshes.push_back(rigid_mesh);
+	return (uint)rigid_meshes.size()-1u;
+}
+void LBM_Domain::release_rigid_mesh(const uint handle) {
+	if(handle>=(uint)rigid_meshes.size()||rigid_meshes[handle]==nullptr) print_error("Invalid rigid mesh handle "+to_string(handle)+".");
+	delete rigid_meshes[handle];
+	rigid_meshes[handle] = nullptr;
+}
+void LBM_Domain::voxelize_rigid_mesh_on_device(const uint handle, const float3x3& rotation, const float3& translation, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity) { // voxelize triangle mesh in pose rotation*(p-rotation_center)+rotation_center+translation, mesh stays resident in device memory
+	if(handle>=(uint)rigid_meshes.size()||rigid_meshes[handle]==nullptr) print_error("Invalid rigid mesh handle "+to_string(handle)+". Upload the mesh with upload_rigid_mesh() first.");
+	Rigid_Mesh* rigid_mesh = rigid_meshes[handle];
+	const float3x3 inverse_rotation = transpose(rotation);
+	const float3 inverse_translation = rotation_center-inverse_rotation*(rotation_center+translation); // p_mesh = inverse_rotation*p_lattice+inverse_translation
+	float3 pmin=float3(max_float), pmax=float3(-max_float); // bounding box of mesh in new pose
+	for(uint i=0u; i<8u; i++) {
+		const float3 corner = float3(i&1u ? rigid_mesh->mesh_pmax.x : rigid_mesh->mesh_pmin.x, i&2u ? rigid_mesh->mesh_pmax.y : rigid_mesh->mesh_pmin.y, i&4u ? rigid_mesh->mesh_pmax.z : rigid_mesh->mesh_pmin.z);
+		const float3 p = rotation*(corner-rotation_center)+rotation_center+translation;
+		pmin = float3(fmin(pmin.x, p.x), fmin(pmin.y, p.y), fmin(pmin.z, p.z));
+		pmax = float3(fmax(pmax.x, p.x), fmax(pmax.y, p.y), fmax(pmax.z, p.z));
+	}
+	const float3 pose_pmin=pmin, pose_pmax=pmax;
+	if(rigid_mesh->voxelized) { // cells can only change in the band swept between previous and new pose, so rays are cast over the union of both bounding boxes; the kernel then only writes cells that change state
+		pmin = float3(fmin(pmin.x, rigid_mesh->pmin.x), fmin(pmin.y, rigid_mesh->pmin.y), fmin(pmin.z, rigid_mesh->pmin.z));
+		pmax = float3(fmax(pmax.x, rigid_mesh->pmax.x), fmax(pmax.y, rigid_mesh->pmax.y), fmax(pmax.z, rigid_mesh->pmax.z));
+	}
+	rigid_mesh->pmin = pose_pmin;
+	rigid_mesh->pmax = pose_pmax;
+	rigid_mesh->voxelized = true;
+	Memory<float>& parameters = rigid_mesh->parameters;
+	set_voxelization_parameters(parameters, rigid_mesh->triangle_number, pmin, pmax, rotation_center, linear_velocity, rotational_velocity, inverse_rotation, inverse_translation);
+	const uint direction = rigid_mesh->direction;
+	const float3 ray = float3((float)(direction==0u), (float)(direction==1u), (float)(direction==2u));
+	const bool use_bins = length(inverse_rotation*ray-ray)<1E-5f; // bins are only valid if rays stay aligned with the binning axis in mesh coordinates, i.e. rotation around the ray axis
+	parameters[16] = rigid_mesh->u0;
+	parameters[17] = rigid_mesh->v0;
+	parameters[18] = 1.0f/rigid_mesh->bin_size;
+	parameters[19] = as_float(use_bins ? rigid_mesh->bins_u : 0u);
+	parameters[20] = as_float(rigid_mesh->bins_v);
+	parameters.write_to_device();
+	rigid_mesh->kernel_voxelize_mesh.set_parameters(1u, fi, u, flags, t+1ull, flag); // fi may have been swapped, t has changed
+	rigid_mesh->kernel_voxelize_mesh.run();
+}
+void LBM_Domain::allocate_solid_fraction() { // allocate solid_fraction on first use, initialized to 0
+	if(solid_fraction.length()==0ull) solid_fraction = Memory<float>(device, get_N());
+}
+template<typename T> static bool pack_sdf_parameters(Memory<float>& sdf_params, const T* sdf, const float3& center, const float3x3& rotation, const float scale, const uint3& N, const int3& O, const bool compute_solid_fraction, uint3& sample_min, uint3& sample_max) { // shared by dense and narrow-band SDF, returns false if the SDF does not overlap the domain
 	// Compute inverse rotation matrix (to transform LBM coords back to SDF space)
 	// For orthogonal matrices, inverse = transpose
 	const float3x3 rotation_inv = transpose(rotation);
 
 	// Pack parameters into array (similar to voxelize_mesh approach)
-	Memory<float> sdf_params(device, 20u);
 	const float3 sdf_world_size = sdf->get_world_size();
 	const float sdf_max_world_dim = fmax(fmax(sdf_world_size.x, sdf_world_size.y), sdf_world_size.z);
 	const float world_to_lbm = scale / sdf_max_world_dim;
@@ -356,12 +583,93 @@ void LBM_Domain::voxelize_sdf_on_device(const SDF* sdf, const float3& center, co
 	sdf_params[14] = rotation_inv.yx; sdf_params[15] = rotation_inv.yy; sdf_params[16] = rotation_inv.yz;
 	sdf_params[17] = rotation_inv.zx; sdf_params[18] = rotation_inv.zy; sdf_params[19] = rotation_inv.zz;
 
-	// Create kernel and run
-	Kernel kernel_voxelize_sdf(device, get_N(), "voxelize_sdf", flags, flag, sdf_data, sdf_params);
+	// Restrict the launch to the domain cells inside the rotated SDF bounding box, same transform as sdf_coordinates() in the kernel
+	const float3 sdf_world_center = sdf->origin + 0.5f * sdf_world_size;
+	const float3 sdf_N = float3((float)sdf->Nx, (float)sdf->Ny, (float)sdf->Nz);
+	float3 pmin(max_float), pmax(-max_float);
+	for(uint i=0u; i<8u; i++) { // SDF sample range corners in global LBM coordinates
+		const float3 s = float3(i&1u ? sdf_N.x-1.0f : 0.0f, i&2u ? sdf_N.y-1.0f : 0.0f, i&4u ? sdf_N.z-1.0f : 0.0f);
+		const float3 p = center + rotation * ((s * sdf->cell_size + sdf->origin - sdf_world_center) * world_to_lbm);
+		pmin = float3(fmin(pmin.x, p.x), fmin(pmin.y, p.y), fmin(pmin.z, p.z));
+		pmax = float3(fmax(pmax.x, p.x), fmax(pmax.y, p.y), fmax(pmax.z, p.z));
+	}
+	const int box_x0=max((int)floor(pmin.x-0.5f)-1-O.x, 0), box_x1=min((int)ceil(pmax.x-0.5f)+1-O.x, (int)N.x-1); // local cell range with one cell safety margin
+	const int box_y0=max((int)floor(pmin.y-0.5f)-1-O.y, 0), box_y1=min((int)ceil(pmax.y-0.5f)+1-O.y, (int)N.y-1);
+	const int box_z0=max((int)floor(pmin.z-0.5f)-1-O.z, 0), box_z1=min((int)ceil(pmax.z-0.5f)+1-O.z, (int)N.z-1);
+	if(box_x0>box_x1||box_y0>box_y1||box_z0>box_z1) return false;
+	sdf_params[20] = as_float((uint)box_x0); sdf_params[21] = as_float((uint)box_y0); sdf_params[22] = as_float((uint)box_z0);
+	sdf_params[23] = as_float((uint)(box_x1-box_x0+1)); sdf_params[24] = as_float((uint)(box_y1-box_y0+1)); sdf_params[25] = as_float((uint)(box_z1-box_z0+1));
+	sdf_params[32] = as_float(compute_solid_fraction ? 1u : 0u);
+
+	// SDF samples needed by this domain box, only these are uploaded
+	float3 smin(max_float), smax(-max_float);
+	for(uint i=0u; i<8u; i++) {
+		const float3 p = float3((float)((i&1u ? box_x1 : box_x0)+O.x)+0.5f, (float)((i&2u ? box_y1 : box_y0)+O.y)+0.5f, (float)((i&4u ? box_z1 : box_z0)+O.z)+0.5f);
+		const float3 s = (rotation_inv * ((p - center) / world_to_lbm) + sdf_world_center - sdf->origin) / sdf->cell_size;
+		smin = float3(fmin(smin.x, s.x), fmin(smin.y, s.y), fmin(smin.z, s.z));
+		smax = float3(fmax(smax.x, s.x), fmax(smax.y, s.y), fmax(smax.z, s.z));
+	}
+	sample_min = uint3((uint)clamp((int)floor(smin.x)-1, 0, (int)sdf->Nx-1), (uint)clamp((int)floor(smin.y)-1, 0, (int)sdf->Ny-1), (uint)clamp((int)floor(smin.z)-1, 0, (int)sdf->Nz-1));
+	sample_max = uint3((uint)clamp((int)floor(smax.x)+2, 0, (int)sdf->Nx-1), (uint)clamp((int)floor(smax.y)+2, 0, (int)sdf->Ny-1), (uint)clamp((int)floor(smax.z)+2, 0, (int)sdf->Nz-1));
+	return true;
+}
+void LBM_Domain::voxelize_sdf_on_device(const SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag, const bool compute_solid_fraction) { // voxelize SDF on GPU, only in the rotated SDF bounding box and with only the overlapping SDF sub-block uploaded
+	Memory<float> sdf_params(device, 36u);
+	uint3 sample_min, sample_max;
+	if(!pack_sdf_parameters(sdf_params, sdf, center, rotation, scale, uint3(Nx, Ny, Nz), int3(Ox, Oy, Oz), compute_solid_fraction, sample_min, sample_max)) return; // SDF does not overlap this domain
+	const uint bNx=sample_max.x-sample_min.x+1u, bNy=sample_max.y-sample_min.y+1u, bNz=sample_max.z-sample_min.z+1u;
+	sdf_params[26] = as_float(sample_min.x); sdf_params[27] = as_float(sample_min.y); sdf_params[28] = as_float(sample_min.z);
+	sdf_params[29] = as_float(bNx); sdf_params[30] = as_float(bNy); sdf_params[31] = as_float(bNz);
+
+	// Upload SDF sub-block to GPU
+	Memory<float> sdf_data(device, (ulong)bNx*(ulong)bNy*(ulong)bNz, 1u, true, true, 0.0f, false); // no zero-copy, it is filled on the host below
+	parallel_for((ulong)bNy*(ulong)bNz, [&](ulong yz) {
+		const uint y=(uint)(yz%(ulong)bNy), z=(uint)(yz/(ulong)bNy);
+		memcpy(sdf_data.data()+yz*(ulong)bNx, sdf->data+sdf->index(sample_min.x, sample_min.y+y, sample_min.z+z), bNx*sizeof(float));
+	});
+	Memory<float> no_solid_fraction(device, 1u);
+	const ulong box_cells = (ulong)as_uint(sdf_params[23])*(ulong)as_uint(sdf_params[24])*(ulong)as_uint(sdf_params[25]);
+	Kernel kernel_voxelize_sdf(device, box_cells, "voxelize_sdf", flags, flag, sdf_data, sdf_params, compute_solid_fraction ? solid_fraction : no_solid_fraction);
 	sdf_data.write_to_device();
 	sdf_params.write_to_device();
 	kernel_voxelize_sdf.run();
 }
+void LBM_Domain::voxelize_sparse_sdf_on_device(const Sparse_SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag, const bool compute_solid_fraction) { // voxelize narrow-band SDF on GPU, only the bricks overlapping this domain are uploaded
+	Memory<float> sdf_params(device, 36u);
+	uint3 sample_min, sample_max;
+	if(!pack_sdf_parameters(sdf_params, sdf, center, rotation, scale, uint3(Nx, Ny, Nz), int3(Ox, Oy, Oz), compute_solid_fraction, sample_min, sample_max)) return; // SDF does not overlap this domain
+	const uint B = sdf->brick_size;
+	const uint bx0=sample_min.x/B, by0=sample_min.y/B, bz0=sample_min.z/B;
+	const uint bNx=sample_max.x/B-bx0+1u, bNy=sample_max.y/B-by0+1u, bNz=sample_max.z/B-bz0+1u;
+	sdf_params[26] = as_float(bx0); sdf_params[27] = as_float(by0); sdf_params[28] = as_float(bz0);
+	sdf_params[29] = as_float(bNx); sdf_params[30] = as_float(bNy); sdf_params[31] = as_float(bNz);
+	sdf_params[33] = as_float(B);
+	sdf_params[34] = sdf->band;
+	sdf_params[35] = as_float(sdf->fp16 ? 1u : 0u);
+
+	// Crop brick index to the overlapping bricks and renumber their dense bricks
+	const ulong sub_bricks = (ulong)bNx*(ulong)bNy*(ulong)bNz;
+	Memory<uint> brick_index(device, sub_bricks, 1u, true, true, 0u, false);
+	vector<uint> dense_slots; // original slots of the uploaded dense bricks
+	for(ulong b=0ull; b<sub_bricks; b++) {
+		const uint x=bx0+(uint)(b%(ulong)bNx), y=by0+(uint)((b/(ulong)bNx)%(ulong)bNy), z=bz0+(uint)(b/((ulong)bNx*(ulong)bNy));
+		const uint slot = sdf->brick_index[(ulong)x+(ulong)sdf->Bx*((ulong)y+(ulong)sdf->By*(ulong)z)];
+		brick_index[b] = slot>=Sparse_SDF::inside ? slot : (uint)dense_slots.size();
+		if(slot<Sparse_SDF::inside) dense_slots.push_back(slot);
+	}
+	const ulong brick_bytes = sdf->brick_samples()*(sdf->fp16 ? 2ull : 4ull); // not a multiple of 4 Bytes for fp16 with odd brick_size
+	Memory<float> brick_data(device, max(((ulong)dense_slots.size()*brick_bytes+3ull)/4ull, (ulong)1ull), 1u, true, true, 0.0f, false); // round up to whole floats, same as Sparse_SDF::allocate(); buffers must not be empty, even if no brick is near the surface
+	parallel_for((ulong)dense_slots.size(), [&](ulong i) {
+		memcpy((uchar*)brick_data.data()+i*brick_bytes, (const uchar*)sdf->brick_data.data()+(ulong)dense_slots[i]*brick_bytes, brick_bytes);
+	});
+	Memory<float> no_solid_fraction(device, 1u);
+	const ulong box_cells = (ulong)as_uint(sdf_params[23])*(ulong)as_uint(sdf_params[24])*(ulong)as_uint(sdf_params[25]);
+	Kernel kernel_voxelize_sparse_sdf(device, box_cells, "voxelize_sparse_sdf", flags, flag, brick_index, brick_data, sdf_params, compute_solid_fraction ? solid_fraction : no_solid_fraction);
+	brick_index.write_to_device();
+	brick_data.write_to_device();
+	sdf_params.write_to_device();
+	kernel_voxelize_sparse_sdf.run();
+}
 void LBM_Domain::enqueue_unvoxelize_mesh_on_device(const Mesh* mesh, const uchar flag) { // remove voxelized triangle mesh from LBM grid
 	const float x0=mesh->pmin.x, y0=mesh->pmin.y, z0=mesh->pmin.z, x1=mesh->pmax.x, y1=mesh->pmax.y, z1=mesh->pmax.z; // remove all flags in bounding box of mesh
 	Kernel kernel_unvoxelize_mesh(device, get_N(), "unvoxelize_mesh", flags, flag, x0, y0, z0, x1, y1, z1);
@@ -501,6 +809,21 @@ string LBM_Domain::device_defines() const { return
 	"\n	#define def_particles_N "+to_string(particles_N)+"ul"
 	"\n	#define def_particles_rho "+to_string(particles_rho)+"f"
 #endif // PARTICLES
+
+#ifdef TEMPORAL_BLOCKING
+	"\n	#define TEMPORAL_BLOCKING"
+	"\n	#define def_tb_steps "+to_string(TEMPORAL_BLOCKING)+"u" // number of time steps per kernel_stream_collide_tb launch
+	"\n	#define def_tb_Tx "+to_string(tb_Tx)+"u" // tile dimensions
+	"\n	#define def_tb_Ty "+to_string(tb_Ty)+"u"
+	"\n	#define def_tb_Tz "+to_string(tb_Tz)+"u"
+	"\n	#define def_tb_Hx "+to_string(TEMPORAL_BLOCKING)+"u" // halo thickness, one cell per time step
+	"\n	#define def_tb_Hy "+to_string(TEMPORAL_BLOCKING)+"u"
+	"\n	#define def_tb_Hz "+to_string(TEMPORAL_BLOCKING*(dimensions==3u))+"u"
+	"\n	#define def_tb_Rx "+to_string(tb_Tx+2u*TEMPORAL_BLOCKING)+"u" // region dimensions (tile plus halo)
+	"\n	#define def_tb_Ry "+to_string(tb_Ty+2u*TEMPORAL_BLOCKING)+"u"
+	"\n	#define def_tb_Rz "+to_string(tb_Tz+2u*TEMPORAL_BLOCKING*(dimensions==3u))+"u"
+	"\n	#define def_tb_R "+to_string((tb_Tx+2u*TEMPORAL_BLOCKING)*(tb_Ty+2u*TEMPORAL_BLOCKING)*(tb_Tz+2u*TEMPORAL_BLOCKING*(dimensions==3u)))+"u"
+#endif // TEMPORAL_BLOCKING
 ;}
 
 #ifdef GRAPHICS
@@ -555,30 +878,84 @@ bool LBM_Domain::Graphics::update_camera() {
 	}
 	return change; // return false if camera parameters remain unchanged
 }
-bool LBM_Domain::Graphics::enqueue_draw_frame(const int visualization_modes, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const bool visualization_change) {
-	const bool camera_update = update_camera();
-#if defined(INTERACTIVE_GRAPHICS)||defined(INTERACTIVE_GRAPHICS_ASCII)
-	if(!visualization_change&&!camera_update&&lbm->get_t()==t_last_rendered_frame) return false; // don't render a new frame if the scene hasn't changed since last frame
-#endif // INTERACTIVE_GRAPHICS||INTERACTIVE_GRAPHICS_ASCII
-	t_last_rendered_frame = lbm->get_t();
-	if(camera_update) camera_parameters.enqueue_write_to_device(); // camera_parameters PCIe transfer and kernel_clear execution can happen simulataneously
+void LBM_Domain::Graphics::update_screen_rect(uint* rect, const int visualization_modes) const {
+	rect[0] = 0u; rect[1] = 0u; rect[2] = camera.width; rect[3] = camera.height; // fallback: entire screen
+	if(lbm->get_D()==1u) return;
+#ifdef FORCE_FIELD
+	if(visualization_modes&VIS_FLAG_LATTICE) return; // force vectors on solid boundaries have unbounded length and can end anywhere on screen
+#endif // FORCE_FIELD
+	const float3 o = 0.5f*float3( // domain center in simulation box coordinates, same as def_domain_offset_x/y/z
+		(float)((int)lbm->Nx+2*lbm->Ox+(int)lbm->Dx*(2*(int)(lbm->Dx>1u)-(int)lbm->Nx)),
+		(float)((int)lbm->Ny+2*lbm->Oy+(int)lbm->Dy*(2*(int)(lbm->Dy>1u)-(int)lbm->Ny)),
+		(float)((int)lbm->Nz+2*lbm->Oz+(int)lbm->Dz*(2*(int)(lbm->Dz>1u)-(int)lbm->Nz))
+	);
+	const float margin = visualization_modes&VIS_STREAMLINES ? 1.0f+0.5f*(float)(GRAPHICS_STREAMLINE_SPARSE) : 1.0f; // 1 cell margin for velocity vectors, streamlines can start up to half their spacing outside the domain when snapped to the slice position
+	const float3 h = 0.5f*float3((float)(lbm->Nx-2u*(lbm->Dx>1u)), (float)(lbm->Ny-2u*(lbm->Dy>1u)), (float)(lbm->Nz-2u*(lbm->Dz>1u)))+margin; // half domain size without halo, plus margin
+	int x0=max_int, y0=max_int, x1=min_int, y1=min_int;
+	for(int stereo=camera.vr?-1:0; stereo<=(camera.vr?1:0); stereo+=2) {
+		for(uint i=0u; i<8u; i++) { // the projection of the box lies within the bounding rectangle of its projected corners if all corners are in front of the camera
+			int rx, ry; float rz;
+			if(!convert(rx, ry, rz, o+float3(i&1u ? h.x : -h.x, i&2u ? h.y : -h.y, i&4u ? h.z : -h.z), stereo)) return;
+			x0 = min(x0, rx); y0 = min(y0, ry);
+			x1 = max(x1, rx); y1 = max(y1, ry);
+		}
+	}
+	rect[0] = (uint)clamp(x0-2, 0, (int)camera.width); // 2 pixels margin for rounding and line rasterization
+	rect[1] = (uint)clamp(y0-2, 0, (int)camera.height);
+	rect[2] = (uint)clamp(x1+3, (int)rect[0], (int)camera.width);
+	rect[3] = (uint)clamp(y1+3, (int)rect[1], (int)camera.height);
+}
+void LBM_Domain::Graphics::link_frame(const Memory<float>& camera_parameters, const Memory<int>& bitmap, const Memory<int>& zbuffer) { // kernel arguments are captured at enqueue time, so they can be switched between enqueued frames
+	kernel_clear.set_parameters(0u, bitmap, zbuffer);
+	kernel_graphics_flags.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_flags_mc.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_field.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_field_slice.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_streamline.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_q.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+#ifdef SURFACE
+	kernel_graphics_rasterize_phi.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+	kernel_graphics_raytrace_phi.set_parameters(0u, camera_parameters, bitmap);
+#endif // SURFACE
+#ifdef PARTICLES
+	kernel_graphics_particles.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+#endif // PARTICLES
+	if(lod>0u) { // level of detail kernels are only allocated once used
+		kernel_graphics_flags_lod.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+		kernel_graphics_flags_mc_lod.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+		kernel_graphics_field_slice_lod.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+		kernel_graphics_q_lod.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+#ifdef SURFACE
+		kernel_graphics_rasterize_phi_lod.set_parameters(0u, camera_parameters, bitmap, zbuffer);
+#endif // SURFACE
+	}
+}
+void LBM_Domain::Graphics::enqueue_render(const int visualization_modes, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const bool use_lod) {
 	kernel_clear.enqueue_run();
 	const int sx=slice_x-lbm->Ox, sy=slice_y-lbm->Oy, sz=slice_z-lbm->Oz; // subtract domain offsets
 #ifdef SURFACE
 	if((visualization_modes&VIS_PHI_RAYTRACE)&&lbm->get_D()==1u) kernel_graphics_raytrace_phi.enqueue_run(); // disable raytracing for multi-GPU (domain decomposition rendering doesn't work for raytracing)
-	if(visualization_modes&VIS_PHI_RASTERIZE) kernel_graphics_rasterize_phi.enqueue_run();
+	if(visualization_modes&VIS_PHI_RASTERIZE) (use_lod ? kernel_graphics_rasterize_phi_lod : kernel_graphics_rasterize_phi).enqueue_run();
 #endif // SURFACE
-	if(visualization_modes&VIS_FLAG_LATTICE) kernel_graphics_flags.enqueue_run();
-	if(visualization_modes&VIS_FLAG_SURFACE) kernel_graphics_flags_mc.enqueue_run();
+	if(visualization_modes&VIS_FLAG_LATTICE) (use_lod ? kernel_graphics_flags_lod : kernel_graphics_flags).enqueue_run();
+	if(visualization_modes&VIS_FLAG_SURFACE) (use_lod ? kernel_graphics_flags_mc_lod : kernel_graphics_flags_mc).enqueue_run();
 	if(visualization_modes&VIS_STREAMLINES) kernel_graphics_streamline.set_parameters(3u, field_mode, slice_mode, sx, sy, sz).enqueue_run();
-	if(visualization_modes&VIS_Q_CRITERION) kernel_graphics_q.set_parameters(3u, field_mode).enqueue_run();
+	if(visualization_modes&VIS_Q_CRITERION) (use_lod ? kernel_graphics_q_lod : kernel_graphics_q).set_parameters(3u, field_mode).enqueue_run();
 #ifdef PARTICLES
 	if(visualization_modes&VIS_PARTICLES) kernel_graphics_particles.enqueue_run();
 #endif // PARTICLES
-	if(visualization_modes&VIS_FIELD) {
+	if((visualization_modes&VIS_FIELD)&&use_lod&&slice_mode>0) { // slices through the downsampled lattice, field without slice stays in full resolution
+		uint M[3];
+		lod_dimensions(lod, M);
+		const uint area[3] = { M[1]*M[2], M[2]*M[0], M[0]*M[1] };
+		for(uint direction=0u; direction<3u; direction++) {
+			const bool draw = slice_mode==(int)direction+1 || (slice_mode==4&&direction!=1u) || slice_mode==5 || (slice_mode==6&&direction!=0u) || (slice_mode==7&&direction!=2u); // 4 (xz), 5 (xyz), 6 (yz), 7 (xy)
+			if(draw) kernel_graphics_field_slice_lod.set_ranges(area[direction]).set_parameters(3u, field_mode, (int)direction+1, sx, sy, sz).enqueue_run();
+		}
+	} else if(visualization_modes&VIS_FIELD) {
 		switch(slice_mode) { // 0 (no slice), 1 (x), 2 (y), 3 (z), 4 (xz), 5 (xyz), 6 (yz), 7 (xy)
 			case 0: // no slice
-				kernel_graphics_field.set_parameters(3u, field_mode).enqueue_run();
+				if(!gathered_raytracing) kernel_graphics_field.set_parameters(3u, field_mode).enqueue_run(); // otherwise raytraced on domain 0 after compositing
 				break;
 			case 1: case 2: case 3: // x/y/z
 				kernel_graphics_field_slice.set_ranges(lbm->get_area((uint)clamp(slice_mode-1, 0, 2))).set_parameters(3u, field_mode, slice_mode, sx, sy, sz).enqueue_run();
@@ -602,15 +979,239 @@ bool LBM_Domain::Graphics::enqueue_draw_frame(const int visualization_modes, con
 				break;
 		}
 	}
-	bitmap.enqueue_read_from_device();
-	if(lbm->get_D()>1u) zbuffer.enqueue_read_from_device();
+}
+void LBM_Domain::Graphics::enqueue_read_frame(Memory<int>& bitmap, Memory<int>& zbuffer, uint* rect, const int visualization_modes) { // the rest of the frame is filled in by LBM::Graphics::composite()
+	update_screen_rect(rect, visualization_modes);
+	if(rect[3]>rect[1]) {
+		const ulong offset=(ulong)rect[1]*(ulong)camera.width, length=(ulong)(rect[3]-rect[1])*(ulong)camera.width;
+		bitmap.enqueue_read_from_device(offset, length);
+#ifndef GRAPHICS_TRANSPARENCY
+		zbuffer.enqueue_read_from_device(offset, length);
+#endif // GRAPHICS_TRANSPARENCY
+	}
+}
+bool LBM_Domain::Graphics::enqueue_draw_frame(const int visualization_modes, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const bool visualization_change, const uint lod) {
+	const bool camera_update = update_camera();
+#if defined(INTERACTIVE_GRAPHICS)||defined(INTERACTIVE_GRAPHICS_ASCII)
+	if(!visualization_change&&!camera_update&&!last_frame_lod&&lbm->get_t()==t_last_rendered_frame) return false; // don't render a new frame if the scene hasn't changed since last frame, unless it has to be refined to full resolution
+#endif // INTERACTIVE_GRAPHICS||INTERACTIVE_GRAPHICS_ASCII
+	t_last_rendered_frame = lbm->get_t();
+	if(camera_update) camera_parameters.enqueue_write_to_device(); // camera_parameters PCIe transfer and kernel_clear execution can happen simulataneously
+	last_frame_lod = camera_update&&lod>1u; // only render from the downsampled lattice while the camera moves
+	if(last_frame_lod) {
+		allocate_lod(lod);
+		if(lbm->get_t()!=t_last_lod) { // rebuild downsampled lattice once per time step
+			kernel_graphics_lod.enqueue_run();
+			t_last_lod = lbm->get_t();
+		}
+	}
+	enqueue_render(visualization_modes, field_mode, slice_mode, slice_x, slice_y, slice_z, last_frame_lod);
+	if(lbm->get_D()==1u) {
+		if(yuv_output) {
+			kernel_yuv420.enqueue_run();
+			yuv.enqueue_read_from_device(); // 1.5 instead of 4 Bytes per pixel
+			t_last_rendered_frame = max_ulong; // host bitmap is not updated, so the next draw_frame() has to render again even if the scene is unchanged
+		} else {
+			bitmap.enqueue_read_from_device();
+		}
+	} else { // only read back the rows this domain can have drawn to
+		enqueue_read_frame(bitmap, zbuffer, screen_rect, visualization_modes);
+	}
 	return true; // new frame has been rendered
 }
-int* LBM_Domain::Graphics::get_bitmap() { // returns pointer to zbuffer
-	return bitmap.data();
+void LBM_Domain::Graphics::lod_dimensions(const uint lod, uint* M) const {
+	M[0] = (lbm->Nx-2u*(uint)(lbm->Dx>1u)+lod-1u)/lod;
+	M[1] = (lbm->Ny-2u*(uint)(lbm->Dy>1u)+lod-1u)/lod;
+	M[2] = (lbm->Nz-2u*(uint)(lbm->Dz>1u)+lod-1u)/lod;
+}
+uint LBM_Domain::Graphics::lod_factor(const uint lod, const ulong lod_cells) const {
+	uint s = lod==0u ? 1u : lod, M[3];
+	lod_dimensions(s, M);
+	while(s<256u&&((ulong)M[0]*(ulong)M[1]*(ulong)M[2]>(lod==0u ? lod_cells : (ulong)max_uint))) { // automatic: coarsen until below lod_cells, fixed: only coarsen further if indices would overflow
+		s *= 2u;
+		lod_dimensions(s, M);
+	}
+	return s;
+}
+void LBM_Domain::Graphics::allocate_lod(const uint lod) {
+	if(this->lod==lod) return;
+	this->lod = lod;
+	t_last_lod = max_ulong; // force rebuild
+	uint M[3];
+	lod_dimensions(lod, M);
+	const ulong N = (ulong)M[0]*(ulong)M[1]*(ulong)M[2];
+	const bool host = lbm->get_D()>1u; // host copies are only needed for gathering on domain 0
+	lod_rho = Memory<float>(lbm->device, N, 1u, host);
+	lod_u = Memory<float>(lbm->device, N, 3u, host);
+	lod_flags = Memory<uchar>(lbm->device, N, 1u, host);
+	kernel_graphics_lod = Kernel(lbm->device, N, "graphics_lod", lod, lbm->rho, lbm->u, lbm->flags, lod_rho, lod_u, lod_flags);
+	kernel_graphics_flags_lod = Kernel(lbm->device, N, "graphics_flags_lod", camera_parameters, bitmap, zbuffer, lod, lod_flags);
+	kernel_graphics_flags_mc_lod = Kernel(lbm->device, N, "graphics_flags_mc_lod", camera_parameters, bitmap, zbuffer, lod, lod_flags);
+	kernel_graphics_field_slice_lod = Kernel(lbm->device, N, "graphics_field_slice_lod", camera_parameters, bitmap, zbuffer, 0, 0, 0, 0, 0, lod, lod_rho, lod_u, lod_flags);
+	kernel_graphics_q_lod = Kernel(lbm->device, N, "graphics_q_lod", camera_parameters, bitmap, zbuffer, 0, lod, lod_rho, lod_u);
+#ifdef SURFACE
+	lod_phi = Memory<float>(lbm->device, N, 1u, host);
+	kernel_graphics_lod.add_parameters(lbm->phi, lod_phi);
+	kernel_graphics_rasterize_phi_lod = Kernel(lbm->device, N, "graphics_rasterize_phi_lod", camera_parameters, bitmap, zbuffer, lod, lod_phi);
+	kernel_graphics_q_lod.add_parameters(lod_flags);
+#endif // SURFACE
+#ifdef TEMPERATURE
+	lod_T = Memory<float>(lbm->device, N, 1u, host);
+	kernel_graphics_lod.add_parameters(lbm->T, lod_T);
+	kernel_graphics_field_slice_lod.add_parameters(lod_T);
+	kernel_graphics_q_lod.add_parameters(lod_T);
+#endif // TEMPERATURE
+}
+void LBM_Domain::Graphics::free_lod() {
+	if(lod==0u) return;
+	lod = 0u;
+	t_last_lod = max_ulong;
+	kernel_graphics_lod = Kernel(); // kernels keep references to the buffers, so release them first
+	kernel_graphics_flags_lod = Kernel();
+	kernel_graphics_flags_mc_lod = Kernel();
+	kernel_graphics_field_slice_lod = Kernel();
+	kernel_graphics_q_lod = Kernel();
+	lod_rho.delete_buffers();
+	lod_u.delete_buffers();
+	lod_flags.delete_buffers();
+#ifdef SURFACE
+	kernel_graphics_rasterize_phi_lod = Kernel();
+	lod_phi.delete_buffers();
+#endif // SURFACE
+#ifdef TEMPERATURE
+	lod_T.delete_buffers();
+#endif // TEMPERATURE
 }
-int* LBM_Domain::Graphics::get_zbuffer() { // returns pointer to zbuffer
-	return zbuffer.data();
+void LBM_Domain::Graphics::enqueue_read_lod(const uint lod, const bool phi, const bool fields) {
+	allocate_lod(lod);
+	if(lbm->get_t()!=t_last_lod) {
+		kernel_graphics_lod.enqueue_run();
+		t_last_lod = lbm->get_t();
+	}
+	lod_flags.enqueue_read_from_device();
+#ifdef SURFACE
+	if(phi) lod_phi.enqueue_read_from_device();
+#endif // SURFACE
+	if(fields) {
+		lod_rho.enqueue_read_from_device();
+		lod_u.enqueue_read_from_device();
+#ifdef TEMPERATURE
+		lod_T.enqueue_read_from_device();
+#endif // TEMPERATURE
+	}
+}
+void LBM_Domain::Graphics::gather(const vector<const Graphics*>& domains, const uint lod, const bool phi, const bool fields) {
+	uint M[3];
+	lod_dimensions(lod, M);
+	const uint G[3] = { M[0]*lbm->Dx, M[1]*lbm->Dy, M[2]*lbm->Dz };
+	const ulong N = (ulong)G[0]*(ulong)G[1]*(ulong)G[2];
+	if(N!=gather_flags.length()) { // level of detail has changed, the other buffers are reallocated once they are used again
+		gather_flags = Memory<uchar>(lbm->device, N);
+	}
+	const float fx=(float)(lbm->Nx-2u*(uint)(lbm->Dx>1u))/(float)M[0], fy=(float)(lbm->Ny-2u*(uint)(lbm->Dy>1u))/(float)M[1], fz=(float)(lbm->Nz-2u*(uint)(lbm->Dz>1u))/(float)M[2]; // size of one gathered cell, slightly off lod if domains are not divisible by lod
+#ifdef SURFACE
+	if(phi&&gather_phi.length()!=N) {
+		gather_phi = Memory<float>(lbm->device, N);
+		kernel_graphics_raytrace_phi_gather = Kernel(lbm->device, bitmap.length(), "graphics_raytrace_phi_gather", camera_parameters, bitmap, zbuffer, skybox, G[0], G[1], G[2], fx, fy, fz, gather_phi, gather_flags);
+	}
+#endif // SURFACE
+	if(fields&&gather_rho.length()!=N) {
+		gather_rho = Memory<float>(lbm->device, N);
+		gather_u = Memory<float>(lbm->device, N, 3u);
+		kernel_graphics_field_rt_gather = Kernel(lbm->device, bitmap.length(), "graphics_field_rt_gather", camera_parameters, bitmap, 0, G[0], G[1], G[2], fx, fy, fz, gather_rho, gather_u, gather_flags);
+#ifdef TEMPERATURE
+		gather_T = Memory<float>(lbm->device, N);
+		kernel_graphics_field_rt_gather.add_parameters(gather_T);
+#endif // TEMPERATURE
+	}
+	const ulong NM = (ulong)M[0]*(ulong)M[1]*(ulong)M[2];
+	for(const Graphics* domain : domains) {
+		const LBM_Domain* d = domain->lbm;
+		const uint ox = (uint)((d->Ox+(int)(d->Dx>1u))/(int)(d->Nx-2u*(uint)(d->Dx>1u)))*M[0]; // offset of the domain in the gathered lattice
+		const uint oy = (uint)((d->Oy+(int)(d->Dy>1u))/(int)(d->Ny-2u*(uint)(d->Dy>1u)))*M[1];
+		const uint oz = (uint)((d->Oz+(int)(d->Dz>1u))/(int)(d->Nz-2u*(uint)(d->Dz>1u)))*M[2];
+		parallel_for(M[1]*M[2], [&](uint r) { // copy rows along x
+			const uint y=r%M[1], z=r/M[1];
+			const ulong source = (ulong)r*(ulong)M[0];
+			const ulong target = (ulong)ox+((ulong)(oy+y)+(ulong)(oz+z)*(ulong)G[1])*(ulong)G[0];
+			std::copy(domain->lod_flags.data()+source, domain->lod_flags.data()+source+M[0], gather_flags.data()+target);
+#ifdef SURFACE
+			if(phi) std::copy(domain->lod_phi.data()+source, domain->lod_phi.data()+source+M[0], gather_phi.data()+target);
+#endif // SURFACE
+			if(fields) {
+				std::copy(domain->lod_rho.data()+source, domain->lod_rho.data()+source+M[0], gather_rho.data()+target);
+				for(uint i=0u; i<3u; i++) std::copy(domain->lod_u.data()+(ulong)i*NM+source, domain->lod_u.data()+(ulong)i*NM+source+M[0], gather_u.data()+(ulong)i*N+target); // u is SoA
+#ifdef TEMPERATURE
+				std::copy(domain->lod_T.data()+source, domain->lod_T.data()+source+M[0], gather_T.data()+target);
+#endif // TEMPERATURE
+			}
+		});
+	}
+	gather_flags.enqueue_write_to_device();
+#ifdef SURFACE
+	if(phi) gather_phi.enqueue_write_to_device();
+#endif // SURFACE
+	if(fields) {
+		gather_rho.enqueue_write_to_device();
+		gather_u.enqueue_write_to_device();
+#ifdef TEMPERATURE
+		gather_T.enqueue_write_to_device();
+#endif // TEMPERATURE
+	}
+}
+void LBM_Domain::Graphics::draw_gathered(const int view, const int visualization_modes, const int field_mode, const int slice_mode) {
+	Memory<float>& camera_parameters = view<0 ? this->camera_parameters : views[view].camera_parameters; // camera_parameters of the view are already on the device
+	Memory<int>& bitmap = view<0 ? this->bitmap : views[view].bitmap;
+	Memory<int>& zbuffer = view<0 ? this->zbuffer : views[view].zbuffer;
+	bitmap.enqueue_write_to_device(); // composited frame of all domains
+#ifndef GRAPHICS_TRANSPARENCY
+	zbuffer.enqueue_write_to_device();
+#endif // GRAPHICS_TRANSPARENCY
+#ifdef SURFACE
+	if((visualization_modes&VIS_PHI_RAYTRACE)&&gather_phi.length()==gather_flags.length()) kernel_graphics_raytrace_phi_gather.set_parameters(0u, camera_parameters, bitmap, zbuffer).enqueue_run(); // free surface is in the background
+#endif // SURFACE
+	if((visualization_modes&VIS_FIELD)&&slice_mode==0&&gather_rho.length()==gather_flags.length()) kernel_graphics_field_rt_gather.set_parameters(0u, camera_parameters, bitmap, field_mode).enqueue_run(); // field is blended over everything
+	bitmap.enqueue_read_from_device();
+	lbm->finish_queue();
+}
+void LBM_Domain::Graphics::allocate_views(const uint views_N) {
+	if((uint)views.size()==views_N) return;
+	views = vector<View>(views_N);
+	for(uint v=0u; v<views_N; v++) {
+		views[v].camera_parameters = Memory<float>(lbm->device, 15u);
+		views[v].bitmap = Memory<int>(lbm->device, camera.width*camera.height);
+		views[v].zbuffer = Memory<int>(lbm->device, camera.width*camera.height, 1u, lbm->get_D()>1u); // host copy is only needed for multi-domain compositing
+	}
+}
+void LBM_Domain::Graphics::enqueue_draw_view(const uint view, const int visualization_modes, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z) { // camera matrix has to be updated before
+	View& v = views[view];
+	for(uint i=0u; i<15u; i++) v.camera_parameters[i] = camera.data(i); // every view has its own camera_parameters, so host data stays valid until the enqueued transfer is done
+	v.camera_parameters.enqueue_write_to_device();
+	link_frame(v.camera_parameters, v.bitmap, v.zbuffer);
+	enqueue_render(visualization_modes, field_mode, slice_mode, slice_x, slice_y, slice_z);
+	link_frame(camera_parameters, bitmap, zbuffer); // restore default frame buffers
+	if(lbm->get_D()==1u) {
+		v.bitmap.enqueue_read_from_device();
+	} else {
+		enqueue_read_frame(v.bitmap, v.zbuffer, v.screen_rect, visualization_modes);
+	}
+}
+int* LBM_Domain::Graphics::get_bitmap(const int view) { // returns pointer to bitmap
+	return view<0 ? bitmap.data() : views[view].bitmap.data();
+}
+int* LBM_Domain::Graphics::get_zbuffer(const int view) { // returns pointer to zbuffer
+	return view<0 ? zbuffer.data() : views[view].zbuffer.data();
+}
+void LBM_Domain::Graphics::set_yuv_output(const bool enabled) {
+	if(enabled&&yuv.length()==0ull) { // allocate on first use
+		const ulong chroma = (ulong)((camera.width+1u)/2u)*(ulong)((camera.height+1u)/2u);
+		yuv = Memory<uchar>(lbm->device, (ulong)camera.width*(ulong)camera.height+2ull*chroma);
+		kernel_yuv420 = Kernel(lbm->device, chroma, "graphics_yuv420", bitmap, yuv);
+	}
+	yuv_output = enabled;
+}
+uchar* LBM_Domain::Graphics::get_yuv() { // returns pointer to yuv
+	return yuv.data();
 }
 
 string LBM_Domain::Graphics::device_defines() const { return
@@ -828,6 +1429,17 @@ void LBM::sanity_checks_constructor(const vector<Device_Info>& device_infos, con
 #else // TEMPERATURE
 	if(alpha==0.0f&&beta==0.0f) print_warning("The TEMPERATURE extension is enabled but the thermal diffusion/expansion coefficients alpha/beta in the LBM constructor are both set to zero. You may disable the extension by commenting out \"#define TEMPERATURE\" in defines.hpp.");
 #endif // TEMPERATURE
+#ifdef ACTIVE_CELLS
+	if((ulong)Nx*(ulong)Ny*(ulong)Nz/(ulong)(Dx*Dy*Dz)>=(ulong)max_uint) print_error("ACTIVE_CELLS uses 32-bit cell indices, but one domain has more than 4 billion cells. Use more domains or comment out \"#define ACTIVE_CELLS\" in defines.hpp.");
+#endif // ACTIVE_CELLS
+#ifdef TEMPORAL_BLOCKING
+	if(TEMPORAL_BLOCKING<1) print_error("TEMPORAL_BLOCKING has to be set to the number of time steps per kernel launch (at least 1) in defines.hpp.");
+	if(Dx*Dy*Dz>1u) print_error("TEMPORAL_BLOCKING does not work with multiple domains. Comment out \"#define TEMPORAL_BLOCKING\" in defines.hpp or use only a single domain.");
+#if defined(SURFACE)||defined(TEMPERATURE)||defined(PARTICLES)
+	print_error("TEMPORAL_BLOCKING is not compatible with the SURFACE, TEMPERATURE and PARTICLES extensions. Comment out \"#define TEMPORAL_BLOCKING\" in defines.hpp.");
+#endif // SURFACE || TEMPERATURE || PARTICLES
+	for(Device_Info device_info : device_infos) if(!device_info.is_cpu) print_warning("TEMPORAL_BLOCKING is intended for CPU devices with large caches. On GPUs, it is usually slower than regular stream_collide. You may disable it by commenting out \"#define TEMPORAL_BLOCKING\" in defines.hpp.");
+#endif // TEMPORAL_BLOCKING
 #ifdef PARTICLES
 	if(particles_N==0u) print_error("The PARTICLES extension is enabled but the number of particles is set to 0. Comment out \"#define PARTICLES\" in defines.hpp.");
 #if !defined(VOLUME_FORCE)||!defined(FORCE_FIELD)
@@ -844,21 +1456,29 @@ void LBM::sanity_checks_constructor(const vector<Device_Info>& device_infos, con
 void LBM::sanity_checks_initialization() { // sanity checks during initialization on used extensions based on used flags
 	uchar flags_used = 0u;
 	bool moving_boundaries_used=false, equilibrium_boundaries_used=false, surface_used=false, temperature_used=false; // identify used extensions based used flags
-	const uint threads = thread::hardware_concurrency();
-	vector<uchar> t_flags_used(threads, 0u);
-	vector<char> t_moving_boundaries_used(threads, false); // don't use vector<bool> as it uses bit-packing which is broken for multithreading
-	vector<char> t_equilibrium_boundaries_used(threads, false); // don't use vector<bool> as it uses bit-packing which is broken for multithreading
-	parallel_for(get_N(), threads, [&](ulong n, uint t) {
-		const uchar flagsn = flags[n];
-		const uchar flagsn_bo = flagsn&(TYPE_S|TYPE_E);
-		t_flags_used[t] = t_flags_used[t]|flagsn;
-		if(flagsn_bo&TYPE_S) t_moving_boundaries_used[t] = t_moving_boundaries_used[t] || (((flagsn_bo==TYPE_S)&&(u.x[n]!=0.0f||u.y[n]!=0.0f||u.z[n]!=0.0f))||(flagsn_bo==(TYPE_S|TYPE_E)));
-		t_equilibrium_boundaries_used[t] = t_equilibrium_boundaries_used[t] || flagsn_bo==TYPE_E;
-	});
-	for(uint t=0u; t<threads; t++) {
-		flags_used = flags_used|t_flags_used[t];
-		moving_boundaries_used = moving_boundaries_used || t_moving_boundaries_used[t];
-		equilibrium_boundaries_used = equilibrium_boundaries_used || t_equilibrium_boundaries_used[t];
+	if(setup_on_device) { // host copies of flags and u are outdated, so use one device reduction over flags and u instead, without any transfer of the fields
+		equilibrium_boundaries_used = count_flags(TYPE_E, TYPE_S|TYPE_E)>0ull;
+		for(uint d=0u; d<get_D(); d++) {
+			flags_used = flags_used|(uchar)lbm_domain[d]->flag_count[1];
+			moving_boundaries_used = moving_boundaries_used || lbm_domain[d]->flag_count[2]>0u; // TYPE_S cells with non-zero velocity or TYPE_MS cells
+		}
+	} else {
+		const uint threads = thread::hardware_concurrency();
+		vector<uchar> t_flags_used(threads, 0u);
+		vector<char> t_moving_boundaries_used(threads, false); // don't use vector<bool> as it uses bit-packing which is broken for multithreading
+		vector<char> t_equilibrium_boundaries_used(threads, false); // don't use vector<bool> as it uses bit-packing which is broken for multithreading
+		parallel_for(get_N(), threads, [&](ulong n, uint t) {
+			const uchar flagsn = flags[n];
+			const uchar flagsn_bo = flagsn&(TYPE_S|TYPE_E);
+			t_flags_used[t] = t_flags_used[t]|flagsn;
+			if(flagsn_bo&TYPE_S) t_moving_boundaries_used[t] = t_moving_boundaries_used[t] || (((flagsn_bo==TYPE_S)&&(u.x[n]!=0.0f||u.y[n]!=0.0f||u.z[n]!=0.0f))||(flagsn_bo==(TYPE_S|TYPE_E)));
+			t_equilibrium_boundaries_used[t] = t_equilibrium_boundaries_used[t] || flagsn_bo==TYPE_E;
+		});
+		for(uint t=0u; t<threads; t++) {
+			flags_used = flags_used|t_flags_used[t];
+			moving_boundaries_used = moving_boundaries_used || t_moving_boundaries_used[t];
+			equilibrium_boundaries_used = equilibrium_boundaries_used || t_equilibrium_boundaries_used[t];
+		}
 	}
 	surface_used = (bool)(flags_used&(TYPE_F|TYPE_I|TYPE_G));
 	temperature_used = (bool)(flags_used&TYPE_T);
@@ -888,8 +1508,10 @@ void LBM::initialize() { // write all data fields to device and call kernel_init
 #endif // BENCHMARK
 
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->rho.enqueue_write_to_device();
-	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->u.enqueue_write_to_device();
-	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->flags.enqueue_write_to_device();
+	if(!setup_on_device) { // with device_setup, voxelization results are already in device memory and host copies are outdated
+		for(uint d=0u; d<get_D(); d++) lbm_domain[d]->u.enqueue_write_to_device();
+		for(uint d=0u; d<get_D(); d++) lbm_domain[d]->flags.enqueue_write_to_device();
+	}
 #ifdef FORCE_FIELD
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->F.enqueue_write_to_device();
 	communicate_F();
@@ -923,8 +1545,41 @@ void LBM::initialize() { // write all data fields to device and call kernel_init
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->reset_time_step(); // set time step to 0 again
 	initialized = true;
+	setup_on_device = false;
+#ifdef ACTIVE_CELLS
+	active_cells_outdated = true;
+#endif // ACTIVE_CELLS
+}
+void LBM::prepare_voxelization() { // before initialization, write host flags and u to device once so voxelization does not overwrite host setup
+	if(initialized||setup_on_device) return; // device copies are already up-to-date
+	flags.write_to_device();
+	u.write_to_device();
+	setup_on_device = true;
+}
+void LBM::finish_voxelization() { // before initialization, copy voxelization results back to host unless device_setup is enabled
+	if(!device_setup) synchronize_setup();
+#ifdef ACTIVE_CELLS
+	active_cells_outdated = true;
+#endif // ACTIVE_CELLS
+}
+void LBM::allocate_solid_fraction() { // allocate solid_fraction on first use
+	if(solid_fraction.length()>0ull) return;
+	Memory<float>** buffers_solid_fraction = new Memory<float>*[get_D()];
+	for(uint d=0u; d<get_D(); d++) {
+		lbm_domain[d]->allocate_solid_fraction();
+		buffers_solid_fraction[d] = &(lbm_domain[d]->solid_fraction);
+	}
+	solid_fraction = Memory_Container(this, buffers_solid_fraction, "solid_fraction");
 }
 
+uint LBM::get_batch_steps() const { // number of time steps that run() enqueues back-to-back with only a single host synchronization
+	if(get_D()>1u) return 1u; // in multi-GPU, communication calls synchronize every time step anyway
+	uint steps = batch_steps>0u ? batch_steps : clamp(to_uint(0.01/info.runtime_lbm_timestep_smooth), 1u, 1000u); // adapt automatically such that one batch takes about 10ms, this keeps interactive graphics responsive
+#ifdef TEMPORAL_BLOCKING
+	steps = max(steps, (uint)TEMPORAL_BLOCKING);
+#endif // TEMPORAL_BLOCKING
+	return steps;
+}
 void LBM::do_time_step() { // call kernel_stream_collide to perform one LBM time step
 #ifdef SURFACE
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_surface_0();
@@ -940,6 +1595,9 @@ void LBM::do_time_step() { // call kernel_stream_collide to perform one LBM time
 	communicate_flags();
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_surface_3();
 	communicate_phi_massex_flags();
+#ifdef ACTIVE_CELLS
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_update_active_cells(); // flags have changed, number of active cells is not known on host, so kernel ranges stay at full size
+#endif // ACTIVE_CELLS
 #endif // SURFACE
 	communicate_fi();
 #ifdef TEMPERATURE
@@ -952,9 +1610,25 @@ void LBM::do_time_step() { // call kernel_stream_collide to perform one LBM time
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_integrate_particles(); // intgegrate particles forward in time and couple particles to fluid
 	communicate_particles(); // communicate_F() is not required in do_time_step()
 #endif // PARTICLES
-	if(get_D()==1u) for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue(); // this additional domain synchronization barrier is only required in single-GPU, as communication calls already provide all necessary synchronization barriers in multi-GPU
-	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->increment_time_step();
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->increment_time_step(); // in single-GPU, the host synchronization barrier is done only once per batch of time steps in run()
 }
+#ifdef TEMPORAL_BLOCKING
+void LBM::do_time_step_tb() { // call kernel_stream_collide_tb to perform TEMPORAL_BLOCKING LBM time steps at once (single domain only)
+	lbm_domain[0]->enqueue_stream_collide_tb();
+	lbm_domain[0]->increment_time_step((uint)TEMPORAL_BLOCKING);
+}
+#endif // TEMPORAL_BLOCKING
+
+#ifdef ACTIVE_CELLS
+void LBM::update_active_cells() { // rebuild compacted lists of active cells at the start of run() if flags have been changed in between (voxelization, update_moving_boundaries(), flags set on host)
+	if(!active_cells_outdated) return; // avoid a full lattice kernel and a blocking readback per run() call when flags are unchanged
+	active_cells_outdated = false;
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_update_active_cells();
+#ifndef SURFACE
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->update_active_cells_range(); // with SURFACE, the number of active cells changes every time step, so kernel ranges stay at full size
+#endif // SURFACE
+}
+#endif // ACTIVE_CELLS
 
 void LBM::run(const ulong steps, const ulong total_steps) { // initializes the LBM simulation (copies data to device and runs initialize kernel), then runs LBM
 	info.append(steps, total_steps, get_t()); // total_steps parameter is just for runtime estimation
@@ -965,15 +1639,39 @@ void LBM::run(const ulong steps, const ulong total_steps) { // initializes the L
 		camera.allow_rendering = true;
 #endif // GRAPHICS
 	}
+#ifdef ACTIVE_CELLS
+	update_active_cells();
+#endif // ACTIVE_CELLS
 	Clock clock;
-	for(ulong i=1ull; i<=steps; i++) {
+	for(ulong i=1ull; i<=steps; ) {
 #if defined(INTERACTIVE_GRAPHICS)||defined(INTERACTIVE_GRAPHICS_ASCII)
 		while(!key_P&&running) sleep(0.016);
 		if(!running) break;
 #endif // INTERACTIVE_GRAPHICS_ASCII || INTERACTIVE_GRAPHICS
+		const ulong batch = min((ulong)get_batch_steps(), steps-i+1ull); // enqueue batch time steps back-to-back, with only a single host synchronization at the end
 		clock.start();
-		do_time_step();
-		info.update(clock.stop());
+		Event event_start, event_end;
+		if(get_D()==1u) lbm_domain[0]->enqueue_marker(&event_start);
+		for(ulong k=0ull; k<batch; ) {
+#ifdef TEMPORAL_BLOCKING
+			if(batch-k>=(ulong)TEMPORAL_BLOCKING) { // enough steps left in batch for one temporally blocked kernel launch
+				do_time_step_tb();
+				k += (ulong)TEMPORAL_BLOCKING;
+				continue;
+			}
+#endif // TEMPORAL_BLOCKING
+			do_time_step();
+			k++;
+		}
+		double dt = 0.0;
+		if(get_D()==1u) { // this additional domain synchronization barrier is only required in single-GPU, as communication calls already provide all necessary synchronization barriers in multi-GPU
+			lbm_domain[0]->enqueue_marker(&event_end);
+			lbm_domain[0]->finish_queue();
+			dt = event_runtime(event_start, event_end); // device runtime of the batch, without host overhead
+		}
+		if(dt==0.0) dt = clock.stop(); // multi-GPU or event profiling not available
+		for(ulong k=0ull; k<batch; k++) info.update(dt/(double)batch);
+		i += batch;
 	}
 	if(get_D()>1u) for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue(); // wait for everything to finish (multi-GPU only)
 }
@@ -986,6 +1684,57 @@ void LBM::update_fields() { // update fields (rho, u, T) manually
 void LBM::reset() { // reset simulation (takes effect in following run() call)
 	initialized = false;
 }
+void LBM::synchronize_setup() { // copy flags and u of a device_setup back to host, so they can be read or modified on the host again before initialization
+	if(initialized||!setup_on_device) return; // host copies are already up-to-date
+	flags.read_from_device();
+	u.read_from_device();
+	setup_on_device = false;
+}
+ulong LBM::count_flags(const uchar flag_value, const uchar flag_mask) { // count cells with (flags&flag_mask)==flag_value with a device reduction
+	if(!initialized&&!setup_on_device) flags.write_to_device(); // host copy of flags is authoritative before initialization
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_count_flags(flag_value, flag_mask);
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+	ulong count = 0ull;
+	for(uint d=0u; d<get_D(); d++) count += (ulong)lbm_domain[d]->flag_count[0];
+	return count;
+}
+Mesh* LBM::extract_isosurface(const uint field, const float iso) { // extract isosurface of field (isosurface_u, isosurface_q or isosurface_phi) at isovalue iso with marching cubes on the device, returns mesh in lattice coordinates, has to be deleted by the caller
+#ifndef SURFACE
+	if(field==isosurface_phi) print_error("Isosurface of fill level requires the SURFACE extension. Uncomment \"#define SURFACE\" in defines.hpp.");
+#endif // SURFACE
+	if(field>isosurface_phi) print_error("Invalid isosurface field "+to_string(field)+".");
+	if(field!=isosurface_phi) {
+		update_fields();
+		if(get_D()>1u) communicate_rho_u_flags(); // update_fields() skips halo cells, and without SURFACE or GRAPHICS the u halo is not communicated in every time step
+	}
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_extract_isosurface(field, iso);
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+	for(uint d=0u; d<get_D(); d++) { // extract again in domains where the triangles did not fit into the buffer, it is reallocated for the counted number of triangles
+		if(9ull*(ulong)lbm_domain[d]->isosurface_count[0]>lbm_domain[d]->isosurface_triangles.length()) lbm_domain[d]->enqueue_extract_isosurface(field, iso);
+	}
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+	vector<ulong> triangle_offsets(get_D()+1u, 0ull); // triangles of all domains are concatenated
+	for(uint d=0u; d<get_D(); d++) {
+		const ulong triangle_number = (ulong)lbm_domain[d]->isosurface_count[0];
+		lbm_domain[d]->isosurface_triangles.enqueue_read_from_device(0ull, 9ull*triangle_number); // only copy the triangles, not the whole buffer
+		triangle_offsets[d+1u] = triangle_offsets[d]+triangle_number;
+	}
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+	if(triangle_offsets[get_D()]>(ulong)max_uint) print_error("Isosurface has too many triangles.");
+	Mesh* mesh = new Mesh((uint)triangle_offsets[get_D()], center());
+	const float3 offset = center(); // kernel positions are relative to the center of the simulation box
+	for(uint d=0u; d<get_D(); d++) {
+		const float* triangles = lbm_domain[d]->isosurface_triangles.data();
+		parallel_for(triangle_offsets[d+1u]-triangle_offsets[d], [&](ulong i) {
+			const ulong k = triangle_offsets[d]+i;
+			mesh->p0[k] = float3(triangles[9ull*i   ], triangles[9ull*i+1ull], triangles[9ull*i+2ull])+offset;
+			mesh->p1[k] = float3(triangles[9ull*i+3ull], triangles[9ull*i+4ull], triangles[9ull*i+5ull])+offset;
+			mesh->p2[k] = float3(triangles[9ull*i+6ull], triangles[9ull*i+7ull], triangles[9ull*i+8ull])+offset;
+		});
+	}
+	if(mesh->triangle_number>0u) mesh->find_bounds();
+	return mesh;
+}
 
 #ifdef FORCE_FIELD
 void LBM::update_force_field() { // calculate forces from fluid on TYPE_S cells
@@ -1024,6 +1773,9 @@ void LBM::update_moving_boundaries() { // mark/unmark cells next to TYPE_S cells
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_update_moving_boundaries();
 	communicate_flags();
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+#ifdef ACTIVE_CELLS
+	active_cells_outdated = true;
+#endif // ACTIVE_CELLS
 #ifdef GRAPHICS
 	camera.key_update = true; // to prevent flickering of flags in interactive graphics when camera is not moved
 #endif // GRAPHICS
@@ -1076,6 +1828,7 @@ void LBM::write_status(const string& path) { // write LBM status report to a .tx
 }
 
 void LBM::voxelize_mesh_on_device(const Mesh* mesh, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity) { // voxelize triangle mesh
+	prepare_voxelization();
 	if(get_D()==1u) {
 		lbm_domain[0]->voxelize_mesh_on_device(mesh, flag, rotation_center, linear_velocity, rotational_velocity); // if this crashes on Windows, create a TdrDelay 32-bit DWORD with decimal value 300 in Computer\HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Control\GraphicsDrivers
 	} else {
@@ -1086,17 +1839,39 @@ void LBM::voxelize_mesh_on_device(const Mesh* mesh, const uchar flag, const floa
 #ifdef MOVING_BOUNDARIES
 	if((flag&(TYPE_S|TYPE_E))==TYPE_S&&(length(linear_velocity)>0.0f||length(rotational_velocity)>0.0f)) update_moving_boundaries();
 #endif // MOVING_BOUNDARIES
-	if(!initialized) {
-		flags.read_from_device();
-		u.read_from_device();
+	finish_voxelization();
+}
+uint LBM::upload_rigid_mesh(const Mesh* mesh, const float3& rotation_axis) { // upload mesh once per domain, all domains assign the same handle
+	uint handle = 0u;
+	for(uint d=0u; d<get_D(); d++) handle = lbm_domain[d]->upload_rigid_mesh(mesh, rotation_axis);
+	return handle;
+}
+void LBM::release_rigid_mesh(const uint handle) {
+	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->release_rigid_mesh(handle);
+}
+void LBM::voxelize_rigid_mesh_on_device(const uint handle, const float3x3& rotation, const float3& translation, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity) { // voxelize rigid mesh in new pose, only the transform is uploaded
+	prepare_voxelization();
+	if(get_D()==1u) {
+		lbm_domain[0]->voxelize_rigid_mesh_on_device(handle, rotation, translation, flag, rotation_center, linear_velocity, rotational_velocity);
+	} else {
+		parallel_for(get_D(), get_D(), [&](uint d) {
+			lbm_domain[d]->voxelize_rigid_mesh_on_device(handle, rotation, translation, flag, rotation_center, linear_velocity, rotational_velocity);
+		});
 	}
+#ifdef MOVING_BOUNDARIES
+	if((flag&(TYPE_S|TYPE_E))==TYPE_S&&(length(linear_velocity)>0.0f||length(rotational_velocity)>0.0f)) update_moving_boundaries();
+#endif // MOVING_BOUNDARIES
+	finish_voxelization();
 }
 void LBM::unvoxelize_mesh_on_device(const Mesh* mesh, const uchar flag) { // remove voxelized triangle mesh from LBM grid by removing all flags in mesh bounding box (only required when bounding box size changes during re-voxelization)
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->enqueue_unvoxelize_mesh_on_device(mesh, flag);
 	for(uint d=0u; d<get_D(); d++) lbm_domain[d]->finish_queue();
+#ifdef ACTIVE_CELLS
+	active_cells_outdated = true;
+#endif // ACTIVE_CELLS
 }
-void LBM::write_mesh_to_vtk(const Mesh* mesh, const string& path, const bool convert_to_si_units) const { // write mesh to binary .vtk file
-	const string filename = default_filename(path, "mesh", ".vtk", get_t());
+void LBM::write_mesh_to_vtk(const Mesh* mesh, const string& path, const bool convert_to_si_units, const string& name) const { // write mesh to binary .vtk file
+	const string filename = default_filename(path, name, ".vtk", get_t());
 	const string header_1 = "# vtk DataFile Version 3.0\nFluidX3D "+filename.substr(filename.rfind('/')+1)+"\nBINARY\nDATASET POLYDATA\nPOINTS "+to_string(3u*mesh->triangle_number)+" float\n";
 	const string header_2 = "POLYGONS "+to_string(mesh->triangle_number)+" "+to_string(4u*mesh->triangle_number)+"\n";
 	float* points = new float[9u*mesh->triangle_number];
@@ -1131,12 +1906,79 @@ void LBM::write_mesh_to_vtk(const Mesh* mesh, const string& path, const bool con
 	print_info("File \""+filename+"\" saved.");
 	info.allow_printing.unlock();
 }
+void LBM::write_mesh_to_stl(const Mesh* mesh, const string& path, const bool convert_to_si_units, const string& name) const { // write mesh to binary .stl file
+	const string filename = default_filename(path, name, ".stl", get_t());
+	const string header = "FluidX3D "+filename.substr(filename.rfind('/')+1);
+	const ulong size = 84ull+50ull*(ulong)mesh->triangle_number; // 80 Byte header, triangle number, 50 Bytes per triangle
+	char* data = new char[size];
+	std::memset(data, 0, 84);
+	std::memcpy(data, header.c_str(), min((uint)header.length(), 80u));
+	std::memcpy(data+80, &mesh->triangle_number, 4);
+	const float spacing = convert_to_si_units ? units.si_x(1.0f) : 1.0f;
+	const float3 offset = center();
+	parallel_for(mesh->triangle_number, [&](uint i) {
+		const float3 p0=spacing*(mesh->p0[i]-offset), p1=spacing*(mesh->p1[i]-offset), p2=spacing*(mesh->p2[i]-offset);
+		const float3 normal = cross(p1-p0, p2-p0);
+		const float normal_length = length(normal);
+		const float3 n = normal_length>0.0f ? normal/normal_length : float3(0.0f); // marching cubes can produce degenerate triangles
+		const float triangle[12] = { n.x, n.y, n.z, p0.x, p0.y, p0.z, p1.x, p1.y, p1.z, p2.x, p2.y, p2.z };
+		char* t = data+84ull+50ull*(ulong)i;
+		std::memcpy(t, triangle, 48); // .stl is LittleEndian, no byte reversal needed
+		t[48] = t[49] = 0; // attribute byte count
+	});
+	create_folder(filename);
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write(data, size);
+	file.close();
+	delete[] data;
+	info.allow_printing.lock();
+	print_info("File \""+filename+"\" saved.");
+	info.allow_printing.unlock();
+}
+void LBM::write_mesh_to_ply(const Mesh* mesh, const string& path, const bool convert_to_si_units, const string& name) const { // write mesh to binary .ply file
+	const string filename = default_filename(path, name, ".ply", get_t());
+	const string header =
+		"ply\nformat binary_little_endian 1.0\ncomment FluidX3D "+filename.substr(filename.rfind('/')+1)+"\n"
+		"element vertex "+to_string(3u*mesh->triangle_number)+"\nproperty float x\nproperty float y\nproperty float z\n"
+		"element face "+to_string(mesh->triangle_number)+"\nproperty list uchar int vertex_indices\nend_header\n"
+	;
+	float* points = new float[9u*mesh->triangle_number];
+	char* faces = new char[13u*mesh->triangle_number]; // 1 Byte vertex number and 3 int vertex indices per triangle
+	const float spacing = convert_to_si_units ? units.si_x(1.0f) : 1.0f;
+	const float3 offset = center();
+	parallel_for(mesh->triangle_number, [&](uint i) {
+		const float3 p0=spacing*(mesh->p0[i]-offset), p1=spacing*(mesh->p1[i]-offset), p2=spacing*(mesh->p2[i]-offset);
+		points[9u*i   ] = p0.x; points[9u*i+1u] = p0.y; points[9u*i+2u] = p0.z;
+		points[9u*i+3u] = p1.x; points[9u*i+4u] = p1.y; points[9u*i+5u] = p1.z;
+		points[9u*i+6u] = p2.x; points[9u*i+7u] = p2.y; points[9u*i+8u] = p2.z;
+		const int vertices[3] = { 3*(int)i, 3*(int)i+1, 3*(int)i+2 };
+		faces[13u*i] = 3; // 3 vertices per triangle
+		std::memcpy(faces+13u*i+1u, vertices, 12); // .ply is written as LittleEndian, no byte reversal needed
+	});
+	create_folder(filename);
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write(header.c_str(), header.length()); // write non-binary file header
+	file.write((char*)points, 4u*9u*mesh->triangle_number); // write binary data
+	file.write(faces, 13u*mesh->triangle_number); // write binary data
+	file.close();
+	delete[] points;
+	delete[] faces;
+	info.allow_printing.lock();
+	print_info("File \""+filename+"\" saved.");
+	info.allow_printing.unlock();
+}
+void LBM::write_isosurface(const uint field, const float iso, const string& path, const string& extension, const bool convert_to_si_units) { // extract isosurface on the device and write it to binary .vtk, .stl or .ply file
+	const Mesh* mesh = extract_isosurface(field, iso);
+	const string name = field==isosurface_u ? "isosurface-u" : field==isosurface_q ? "isosurface-q" : "isosurface-phi";
+	/**/ if(extension==".stl") write_mesh_to_stl(mesh, path, convert_to_si_units, name);
+	else if(extension==".ply") write_mesh_to_ply(mesh, path, convert_to_si_units, name);
+	else write_mesh_to_vtk(mesh, path, convert_to_si_units, name);
+	delete mesh;
+}
 void LBM::voxelize_stl(const string& path, const float3& center, const float3x3& rotation, const float size, const uchar flag) { // voxelize triangle mesh
 	const Mesh* mesh = read_stl(path, this->size(), center, rotation, size);
-	flags.write_to_device();
 	voxelize_mesh_on_device(mesh, flag);
 	delete mesh;
-	flags.read_from_device();
 }
 void LBM::voxelize_stl(const string& path, const float3x3& rotation, const float size, const uchar flag) { // read and voxelize binary .stl file (place in box center)
 	voxelize_stl(path, center(), rotation, size, flag);
@@ -1149,29 +1991,36 @@ void LBM::voxelize_stl(const string& path, const float size, const uchar flag) {
 }
 
 void LBM::voxelize_sdf(const string& path, const float3& center, const float3x3& rotation, const float scale, const uchar flag) { // voxelize SDF
-	const SDF* sdf = read_sdf(path);
-	if(sdf == nullptr) return; // Error already printed by read_sdf
+	if(is_sparse_sdf(path)) { // narrow-band SDF, upload only dense bricks
+		const Sparse_SDF* sparse = read_sparse_sdf(path);
+		if(sparse == nullptr) return; // Error already printed by read_sparse_sdf
+		prepare_voxelization();
+		if(sdf_solid_fraction) allocate_solid_fraction();
+		for(uint d = 0u; d < get_D(); d++) lbm_domain[d]->voxelize_sparse_sdf_on_device(sparse, center, rotation, scale, flag, sdf_solid_fraction);
+		delete sparse;
+		const ulong total_solid = count_flags(flag);
+		if(sdf_solid_fraction && !device_setup) solid_fraction.read_from_device();
+		finish_voxelization();
+		print_info("SDF voxelization complete. Total solid voxels: " + to_string(total_solid));
+		return;
+	}
+	const std::shared_ptr<const SDF> sdf = read_sdf_cached(path); // reuses the SDF if the caller still holds it from an earlier read of the same unchanged file
+	if(!sdf) return; // Error already printed by read_sdf
 
-	flags.write_to_device();
+	prepare_voxelization();
+	if(sdf_solid_fraction) allocate_solid_fraction();
 
 	print_info("Voxelizing SDF on GPU...");
 	print_info("LBM grid: " + to_string(get_Nx()) + " x " + to_string(get_Ny()) + " x " + to_string(get_Nz()));
 
 	// Voxelize on GPU using kernel
 	for(uint d = 0u; d < get_D(); d++) {
-		lbm_domain[d]->voxelize_sdf_on_device(sdf, center, rotation, scale, flag);
+		lbm_domain[d]->voxelize_sdf_on_device(sdf.get(), center, rotation, scale, flag, sdf_solid_fraction);
 	}
-	flags.read_from_device();
-
-	delete sdf;
 
-	// Count total solid voxels
-	uint total_solid = 0;
-	for(ulong n = 0; n < get_N(); n++) {
-		if(flags[n] == flag) total_solid++;
-	}
-
-	flags.write_to_device(); // Push the modified flags back to GPU
+	const ulong total_solid = count_flags(flag); // count solid voxels with a device reduction, flags stay in device memory
+	if(sdf_solid_fraction && !device_setup) solid_fraction.read_from_device();
+	finish_voxelization();
 	print_info("SDF voxelization complete. Total solid voxels: " + to_string(total_solid));
 }
 void LBM::voxelize_sdf(const string& path, const float3x3& rotation, const float scale, const uchar flag) { // read and voxelize binary SDF file (place in box center)
@@ -1185,7 +2034,7 @@ void LBM::voxelize_sdf(const string& path, const float scale, const uchar flag)
 }
 
 #ifdef GRAPHICS
-int* LBM::Graphics::draw_frame() {
+int* LBM::Graphics::draw_frame(const bool preview) {
 #ifndef UPDATE_FIELDS
 	if(visualization_modes&(VIS_FIELD|VIS_STREAMLINES|VIS_Q_CRITERION)) {
 		for(uint d=0u; d<lbm->get_D(); d++) lbm->lbm_domain[d]->enqueue_update_fields(); // only call update_fields() if the time step has changed since the last rendered frame
@@ -1229,27 +2078,89 @@ int* LBM::Graphics::draw_frame() {
 	last_slice_y = slice_y;
 	last_slice_z = slice_z;
 	bool new_frame = true;
-	for(uint d=0u; d<lbm->get_D(); d++) new_frame = new_frame && lbm->lbm_domain[d]->graphics.enqueue_draw_frame(visualization_modes, field_mode, slice_mode, slice_x, slice_y, slice_z, visualization_change);
+	const int gathered = gather_modes();
+	uint lod_d = preview&&lod!=1u ? lbm->lbm_domain[0]->graphics.lod_factor(lod, lod_cells) : 1u; // all domains have the same size, so they use the same level of detail
+	if(gathered&&lod_d>1u) lod_d = max(lod_d, gather_factor()); // share the downsampled lattice with gathering while the camera moves
+	for(uint d=0u; d<lbm->get_D(); d++) lbm->lbm_domain[d]->graphics.gathered_raytracing = gathered!=0;
+	if(lod==1u&&!gathered) for(uint d=0u; d<lbm->get_D(); d++) lbm->lbm_domain[d]->graphics.free_lod(); // level of detail is disabled and gathering doesn't share the downsampled lattice, so release its VRAM
+	for(uint d=0u; d<lbm->get_D(); d++) new_frame = new_frame && lbm->lbm_domain[d]->graphics.enqueue_draw_frame(visualization_modes, field_mode, slice_mode, slice_x, slice_y, slice_z, visualization_change, lod_d);
 	for(uint d=0u; d<lbm->get_D(); d++) lbm->lbm_domain[d]->finish_queue();
-	int* bitmap = lbm->lbm_domain[0]->graphics.get_bitmap();
-	int* zbuffer = lbm->lbm_domain[0]->graphics.get_zbuffer();
-	for(uint d=1u; d<lbm->get_D()&&new_frame; d++) {
-		const int* bitmap_d = lbm->lbm_domain[d]->graphics.get_bitmap(); // each domain renders its own frame
-		const int* zbuffer_d = lbm->lbm_domain[d]->graphics.get_zbuffer();
-		for(uint i=0u; i<camera.width*camera.height; i++) {
+	if(new_frame&&lbm->get_D()>1u) {
+		composite(); // each domain renders its own frame, composite them into the frame of domain 0
+		if(gathered) {
+			gather(max(lbm->lbm_domain[0]->graphics.get_frame_lod(), gather_factor()));
+			lbm->lbm_domain[0]->graphics.draw_gathered(-1, visualization_modes, field_mode, slice_mode);
+		}
+	}
+	camera.allow_labeling = new_frame; // only print new label on frame if a new frame has been rendered
+	return lbm->lbm_domain[0]->graphics.get_bitmap();
+}
+int LBM::Graphics::gather_modes() const {
+	if(lbm->get_D()==1u||gather_cells==0ull) return 0;
+	int modes = 0;
+#ifdef SURFACE
+	if(visualization_modes&VIS_PHI_RAYTRACE) modes |= 0b01;
+#endif // SURFACE
+	if((visualization_modes&VIS_FIELD)&&slice_mode==0) modes |= 0b10;
+	return modes;
+}
+uint LBM::Graphics::gather_factor() const {
+	return lbm->lbm_domain[0]->graphics.lod_factor(0u, max(gather_cells/(ulong)lbm->get_D(), 1ull)); // every domain contributes the same number of cells
+}
+void LBM::Graphics::gather(const uint lod) {
+	const int modes = gather_modes();
+	if(lbm->get_t()==t_last_gather&&lod==last_gather_lod&&(modes&~last_gather_modes)==0) return; // gathered lattice is still up-to-date
+	t_last_gather = lbm->get_t();
+	last_gather_lod = lod;
+	last_gather_modes = modes;
+	const uint D = lbm->get_D();
+	vector<const LBM_Domain::Graphics*> domains(D);
+	for(uint d=0u; d<D; d++) {
+		lbm->lbm_domain[d]->graphics.enqueue_read_lod(lod, modes&0b01, modes&0b10);
+		domains[d] = &lbm->lbm_domain[d]->graphics;
+	}
+	for(uint d=0u; d<D; d++) lbm->lbm_domain[d]->finish_queue();
+	lbm->lbm_domain[0]->graphics.gather(domains, lod, modes&0b01, modes&0b10);
+}
+void LBM::Graphics::composite(const int view) { // overlay the frames of all domains into the frame of domain 0, view=-1 is the default frame
+	int* bitmap = lbm->lbm_domain[0]->graphics.get_bitmap(view);
+	const uint D=lbm->get_D(), width=camera.width;
+	parallel_for(camera.height, [&](uint y) { // rows are independent, and each domain only contributes within its screen-space bounding rectangle
+		int* bitmap_y = bitmap+(ulong)y*(ulong)width;
+		const uint* rect_0 = lbm->lbm_domain[0]->graphics.get_screen_rect(view);
 #ifndef GRAPHICS_TRANSPARENCY
-			const int zdi = zbuffer_d[i];
-			if(zdi>zbuffer[i]) {
-				bitmap[i] = bitmap_d[i]; // overlay frames using their z-buffers
-				zbuffer[i] = zdi;
+		int* zbuffer_y = lbm->lbm_domain[0]->graphics.get_zbuffer(view)+(ulong)y*(ulong)width;
+		if(y<rect_0[1]||y>=rect_0[3]) { // row was not read back, so it still contains the previous frame
+			for(uint x=0u; x<width; x++) {
+				bitmap_y[x] = GRAPHICS_BACKGROUND_COLOR;
+				zbuffer_y[x] = min_int;
+			}
+		}
+		for(uint d=1u; d<D; d++) {
+			const uint* rect_d = lbm->lbm_domain[d]->graphics.get_screen_rect(view);
+			if(y<rect_d[1]||y>=rect_d[3]) continue;
+			const int* bitmap_d = lbm->lbm_domain[d]->graphics.get_bitmap(view)+(ulong)y*(ulong)width;
+			const int* zbuffer_d = lbm->lbm_domain[d]->graphics.get_zbuffer(view)+(ulong)y*(ulong)width;
+			for(uint x=rect_d[0]; x<rect_d[2]; x++) {
+				const int zdx = zbuffer_d[x];
+				if(zdx>zbuffer_y[x]) {
+					bitmap_y[x] = bitmap_d[x]; // overlay frames using their z-buffers
+					zbuffer_y[x] = zdx;
+				}
 			}
+		}
 #else // GRAPHICS_TRANSPARENCY
-			bitmap[i] = color_add(bitmap[i], bitmap_d[i]);
-#endif // GRAPHICS_TRANSPARENCY
+		if(y<rect_0[1]||y>=rect_0[3]) {
+			for(uint x=0u; x<width; x++) bitmap_y[x] = GRAPHICS_BACKGROUND_COLOR;
 		}
-	}
-	camera.allow_labeling = new_frame; // only print new label on frame if a new frame has been rendered
-	return bitmap;
+		for(uint d=1u; d<D; d++) { // pixels outside of the bounding rectangle of domain d are background color
+			const uint* rect_d = lbm->lbm_domain[d]->graphics.get_screen_rect(view);
+			const bool row = y>=rect_d[1]&&y<rect_d[3];
+			const int* bitmap_d = lbm->lbm_domain[d]->graphics.get_bitmap(view)+(ulong)y*(ulong)width;
+			for(uint x=0u; x<width; x++) bitmap_y[x] = color_add(bitmap_y[x], row&&x>=rect_d[0]&&x<rect_d[2] ? bitmap_d[x] : GRAPHICS_BACKGROUND_COLOR);
+		}
+#endif // GRAPHICS_TRANSPARENCY
+	});
 }
 
 void LBM::Graphics::set_camera_centered(const float rx, const float ry, const float fov, const float zoom) {
@@ -1267,6 +2178,74 @@ void LBM::Graphics::set_camera_free(const float3& p, const float rx, const float
 	camera.zoom = 1E16f;
 	camera.pos = p;
 }
+void LBM::Graphics::add_view_centered(const float rx, const float ry, const float fov, const float zoom, const string& path) { // same camera settings as set_camera_centered()
+	View view;
+	view.free = false;
+	view.rx = 0.5*pi+((double)rx*pi/180.0);
+	view.ry = pi-((double)ry*pi/180.0);
+	view.fov = clamp((float)fov, 1E-6f, 179.0f);
+	view.zoom = (float)min(camera.width, camera.height)*zoom/(float)fmax(fmax(lbm->get_Nx(), lbm->get_Ny()), lbm->get_Nz());
+	view.path = path;
+	views.push_back(view);
+}
+void LBM::Graphics::add_view_free(const float3& p, const float rx, const float ry, const float fov, const string& path) { // same camera settings as set_camera_free()
+	View view;
+	view.free = true;
+	view.rx = 0.5*pi+((double)rx*pi/180.0);
+	view.ry = pi-((double)ry*pi/180.0);
+	view.fov = clamp((float)fov, 1E-6f, 179.0f);
+	view.zoom = 1E16f;
+	view.pos = p;
+	view.path = path;
+	views.push_back(view);
+}
+LBM::Graphics::View LBM::Graphics::get_view() const {
+	View view;
+	view.free = camera.free;
+	view.rx = camera.rx;
+	view.ry = camera.ry;
+	view.fov = camera.fov;
+	view.zoom = camera.zoom;
+	view.pos = camera.pos;
+	return view;
+}
+void LBM::Graphics::set_view(const View& view) {
+	camera.free = view.free;
+	camera.rx = view.rx;
+	camera.ry = view.ry;
+	camera.fov = view.fov;
+	camera.zoom = view.zoom;
+	camera.pos = view.pos;
+	camera.update_matrix();
+}
+vector<int*> LBM::Graphics::draw_views() { // render all views in one pass: fields are updated once and shared by all views, and all frames are read back with one synchronization
+	const uint V=(uint)views.size(), D=lbm->get_D();
+#ifndef UPDATE_FIELDS
+	if(visualization_modes&(VIS_FIELD|VIS_STREAMLINES|VIS_Q_CRITERION)) {
+		for(uint d=0u; d<D; d++) lbm->lbm_domain[d]->enqueue_update_fields();
+	}
+#endif // UPDATE_FIELDS
+	const int gathered = gather_modes();
+	for(uint d=0u; d<D; d++) {
+		lbm->lbm_domain[d]->graphics.allocate_views(V);
+		lbm->lbm_domain[d]->graphics.gathered_raytracing = gathered!=0;
+	}
+	const View current = get_view(); // views temporarily replace the camera settings
+	for(uint v=0u; v<V; v++) {
+		set_view(views[v]);
+		for(uint d=0u; d<D; d++) lbm->lbm_domain[d]->graphics.enqueue_draw_view(v, visualization_modes, field_mode, slice_mode, slice_x, slice_y, slice_z);
+	}
+	set_view(current);
+	for(uint d=0u; d<D; d++) lbm->lbm_domain[d]->finish_queue();
+	if(gathered) gather(gather_factor()); // all views share one gathered lattice
+	vector<int*> frames(V);
+	for(uint v=0u; v<V; v++) {
+		if(D>1u) composite((int)v);
+		if(gathered) lbm->lbm_domain[0]->graphics.draw_gathered((int)v, visualization_modes, field_mode, slice_mode);
+		frames[v] = lbm->lbm_domain[0]->graphics.get_bitmap((int)v);
+	}
+	return frames;
+}
 bool LBM::Graphics::next_frame(const ulong total_time_steps, const float video_length_seconds) { // returns true once simulation time has progressed enough to render the next video frame for a 60fps video of specified length
 	const uint new_frame = to_uint((float)lbm->get_t()/(float)total_time_steps*video_length_seconds*60.0f);
 	if(new_frame!=last_exported_frame) {
@@ -1290,14 +2269,200 @@ void LBM::Graphics::print_frame() { // preview current frame in console
 	camera.rendring_frame.unlock();
 #endif // INTERACTIVE_GRAPHICS_ASCII
 }
-void encode_image(Image* image, const string& filename, const string& extension, std::atomic_int* running_encoders) {
-	if(extension==".png") write_png(filename, image);
-	if(extension==".qoi") write_qoi(filename, image);
-	if(extension==".bmp") write_bmp(filename, image);
-	delete image; // delete image when done
-	(*running_encoders)--;
+void Encoder_Pool::configure(const uint threads_N, const uint queue_length, const bool drop_frames) {
+	finish(); // new settings apply to a new set of threads
+	std::lock_guard<std::mutex> lock(mutex);
+	this->threads_N = threads_N;
+	this->queue_length = queue_length;
+	this->drop_frames = drop_frames;
+}
+void Encoder_Pool::worker() {
+	while(true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job_queued.wait(lock, [&]() { return stop||!queue.empty(); });
+			if(queue.empty()) return; // only stop once all queued frames are encoded
+			job = queue.front();
+			queue.pop_front();
+		}
+		Clock clock;
+		if(job.extension==".png") write_png(job.filename, job.image, job.png_level);
+		if(job.extension==".qoi") write_qoi(job.filename, job.image, max((uint)thread::hardware_concurrency()/threads_N, 1u)); // strips of one frame are encoded in parallel, without oversubscribing the CPU cores
+		if(job.extension==".bmp") write_bmp(job.filename, job.image);
+		const double t = clock.stop();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free_frames.push_back(job.image); // keep frame buffer for the next frame instead of deleting it
+			frames_encoded++;
+			time_encode_total += t;
+			time_encode_max = fmax(time_encode_max, t);
+			time_encode_last = t;
+		}
+		frame_freed.notify_one();
+	}
 }
-void LBM::Graphics::write_frame(const string& path, const string& name, const string& extension, bool print_preview) { // save current frame as .png file (smallest file size, but slow)
+Image* Encoder_Pool::acquire(const uint width, const uint height) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if(threads.empty()) { // start encoder threads
+		if(threads_N==0u) threads_N = max((uint)thread::hardware_concurrency()/2u, 1u);
+		if(queue_length==0u) queue_length = 2u*threads_N;
+		stop = false;
+		for(uint i=0u; i<threads_N; i++) threads.emplace_back(&Encoder_Pool::worker, this);
+	}
+	while(free_frames.empty()&&frames_allocated>=threads_N+queue_length) { // all frame buffers are queued or being encoded
+		if(drop_frames) {
+			frames_dropped++;
+			return nullptr;
+		}
+		frame_freed.wait(lock); // backpressure: block until an encoder thread has finished a frame
+	}
+	if(free_frames.empty()) {
+		frames_allocated++;
+		return new Image(width, height);
+	}
+	Image* image = free_frames.back();
+	free_frames.pop_back();
+	if(image->width()!=width||image->height()!=height) { // frame size changed, for example with cropped write_frame()
+		delete image;
+		image = new Image(width, height);
+	}
+	return image;
+}
+void Encoder_Pool::submit(Image* image, const string& filename, const string& extension, const uint png_level) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(Job{image, filename, extension, png_level});
+	}
+	job_queued.notify_one();
+}
+void Encoder_Pool::finish() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(threads.empty()) return;
+		if(!queue.empty()) print_info("Finishing encoder threads: "+to_string((uint)queue.size())+" frames queued");
+		stop = true;
+	}
+	job_queued.notify_all();
+	for(thread& t : threads) t.join();
+	threads.clear();
+	for(Image* image : free_frames) delete image;
+	free_frames.clear();
+	frames_allocated = 0u;
+	if(frames_encoded>0ull) print_info("Encoded "+to_string(frames_encoded)+" frames, "+to_string(1E3*time_encode_total/(double)frames_encoded, 1u)+" ms/frame average, "+to_string(1E3*time_encode_max, 1u)+" ms/frame max"+(frames_dropped>0ull ? ", dropped "+to_string(frames_dropped)+" frames" : ""));
+	frames_encoded = frames_dropped = 0ull;
+	time_encode_total = time_encode_max = 0.0;
+}
+uint Encoder_Pool::queued() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return (uint)queue.size();
+}
+double Encoder_Pool::get_time_encode_last() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return time_encode_last;
+}
+double Encoder_Pool::get_time_encode_average() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return frames_encoded>0ull ? time_encode_total/(double)frames_encoded : 0.0;
+}
+void LBM::Graphics::open_stream(const string& path, const bool yuv, const uint fps) {
+	close_stream();
+	stream_yuv = yuv;
+	stream_pipe = path.length()>0u&&path[0]=='|';
+	if(stream_pipe) {
+#ifdef _WIN32
+		stream = _popen(path.substr(1u).c_str(), "wb");
+#else // Linux
+		stream = popen(path.substr(1u).c_str(), "w");
+#endif // Linux
+	} else {
+		create_folder(path);
+		stream = fopen(path.c_str(), "wb"); // also works for named pipes, blocks until a reader opens the pipe
+	}
+	if(stream==nullptr) {
+		print_error("Could not open video stream \""+path+"\".");
+		return;
+	}
+	if(stream_yuv) {
+		const string header = "YUV4MPEG2 W"+to_string(camera.width)+" H"+to_string(camera.height)+" F"+to_string(fps)+":1 Ip A1:1 C420jpeg\n";
+		fwrite(header.c_str(), 1u, header.length(), stream);
+	} else {
+		print_info("Video stream \""+path+"\" is raw RGB24, read it with: -f rawvideo -pix_fmt rgb24 -s "+to_string(camera.width)+"x"+to_string(camera.height)+" -r "+to_string(fps)+" -i -");
+	}
+}
+void LBM::Graphics::write_stream_frame() {
+	if(stream==nullptr) {
+		print_warning("No video stream is open, call open_stream() first.");
+		return;
+	}
+	camera.rendring_frame.lock(); // block rendering for other threads until finished
+	camera.key_update = true; // force rendering new frame
+	const bool device_yuv = stream_yuv&&lbm->get_D()==1u; // multi-domain frames are composited on the host, so they are converted there too
+	if(device_yuv) lbm->lbm_domain[0]->graphics.set_yuv_output(true);
+	const int* image_data = draw_frame(); // make sure the frame is fully rendered
+	const uint width=camera.width, height=camera.height, cw=(width+1u)/2u, ch=(height+1u)/2u;
+	const ulong pixels = (ulong)width*(ulong)height;
+	const uchar* data = nullptr;
+	ulong length = 0ull;
+	if(device_yuv) {
+		lbm->lbm_domain[0]->graphics.set_yuv_output(false);
+		data = lbm->lbm_domain[0]->graphics.get_yuv();
+		length = pixels+2ull*(ulong)cw*(ulong)ch;
+	} else if(stream_yuv) { // same conversion as graphics_yuv420 kernel
+		length = pixels+2ull*(ulong)cw*(ulong)ch;
+		stream_buffer.resize(length);
+		uchar* yuv = stream_buffer.data();
+		parallel_for(ch, [&](uint cy) {
+			for(uint cx=0u; cx<cw; cx++) {
+				float sum[3] = { 0.0f, 0.0f, 0.0f };
+				for(uint j=0u; j<2u; j++) {
+					for(uint i=0u; i<2u; i++) {
+						const uint x=min(2u*cx+i, width-1u), y=min(2u*cy+j, height-1u);
+						const int c = image_data[x+y*width];
+						const float r=(float)((c>>16)&255), g=(float)((c>>8)&255), b=(float)(c&255);
+						yuv[x+y*width] = (uchar)clamp(16.0f+0.858824f*(0.2126f*r+0.7152f*g+0.0722f*b)+0.5f, 0.0f, 255.0f);
+						sum[0] += r; sum[1] += g; sum[2] += b;
+					}
+				}
+				const float r=0.25f*sum[0], g=0.25f*sum[1], b=0.25f*sum[2];
+				yuv[pixels                  +(ulong)cx+(ulong)cy*(ulong)cw] = (uchar)clamp(128.0f+0.878431f*(-0.1146f*r-0.3854f*g+0.5000f*b)+0.5f, 0.0f, 255.0f);
+				yuv[pixels+(ulong)cw*(ulong)ch+(ulong)cx+(ulong)cy*(ulong)cw] = (uchar)clamp(128.0f+0.878431f*( 0.5000f*r-0.4542f*g-0.0458f*b)+0.5f, 0.0f, 255.0f);
+			}
+		});
+		data = yuv;
+	} else { // raw RGB24
+		length = 3ull*pixels;
+		stream_buffer.resize(length);
+		uchar* rgb = stream_buffer.data();
+		parallel_for(height, [&](uint y) {
+			for(uint x=0u; x<width; x++) {
+				const int c = image_data[x+y*width];
+				uchar* pixel = rgb+3ull*((ulong)x+(ulong)y*(ulong)width);
+				pixel[0] = (c>>16)&255;
+				pixel[1] = (c>> 8)&255;
+				pixel[2] =  c     &255;
+			}
+		});
+		data = rgb;
+	}
+	if(stream_yuv) fwrite("FRAME\n", 1u, 6u, stream);
+	if(fwrite(data, 1u, length, stream)!=length) print_warning("Could not write frame to video stream.");
+	camera.rendring_frame.unlock();
+}
+void LBM::Graphics::close_stream() {
+	if(stream==nullptr) return;
+	if(stream_pipe) {
+#ifdef _WIN32
+		_pclose(stream);
+#else // Linux
+		pclose(stream);
+#endif // Linux
+	} else {
+		fclose(stream);
+	}
+	stream = nullptr;
+}
+void LBM::Graphics::write_frame(const string& path, const string& name, const string& extension, bool print_preview) { // save current frame as .png file (small file size, compression level set with png_level)
 	write_frame(0u, 0u, camera.width, camera.height, path, name, extension, print_preview);
 }
 void LBM::Graphics::write_frame(const uint x1, const uint y1, const uint x2, const uint y2, const string& path, const string& name, const string& extension, bool print_preview) { // save a cropped current frame with two corner points (x1,y1) and (x2,y2)
@@ -1307,8 +2472,12 @@ void LBM::Graphics::write_frame(const uint x1, const uint y1, const uint x2, con
 	const string filename = default_filename(path, name, extension, lbm->get_t());
 	const uint xa=max(min(x1, x2), 0u), xb=min(max(x1, x2), camera.width ); // sort coordinates if necessary
 	const uint ya=max(min(y1, y2), 0u), yb=min(max(y1, y2), camera.height);
-	Image* image = new Image(xb-xa, yb-ya); // create local copy of frame buffer
-	for(uint y=0u; y<image->height(); y++) for(uint x=0u; x<image->width(); x++) image->set_color(x, y, image_data[camera.width*(ya+y)+(xa+x)]);
+	Image* image = encoder.acquire(xb-xa, yb-ya); // reused frame buffer, waits for a free one if all are in the encoder queue
+	if(image==nullptr) { // encoder queue is full and frame dropping is enabled
+		camera.rendring_frame.unlock();
+		return;
+	}
+	for(uint y=0u; y<image->height(); y++) std::copy(image_data+(ulong)camera.width*(ulong)(ya+y)+(ulong)xa, image_data+(ulong)camera.width*(ulong)(ya+y)+(ulong)xb, image->data()+(ulong)image->width()*(ulong)y); // create local copy of frame buffer
 #ifndef INTERACTIVE_GRAPHICS_ASCII
 	if(print_preview) {
 		info.allow_printing.lock();
@@ -1318,12 +2487,21 @@ void LBM::Graphics::write_frame(const uint x1, const uint y1, const uint x2, con
 		info.allow_printing.unlock();
 	}
 #endif // INTERACTIVE_GRAPHICS_ASCII
-	running_encoders++;
-	thread encoder(encode_image, image, filename, extension, &running_encoders); // the main bottleneck in rendering images to the hard disk is .png encoding, so encode image in new thread
-	encoder.detach(); // detatch thread so it can run concurrently
+	encoder.submit(image, filename, extension, png_level); // the main bottleneck in rendering images to the hard disk is .png encoding, so encode image in encoder threads
+	camera.rendring_frame.unlock();
+}
+void LBM::Graphics::write_views(const string& name, const string& extension) { // save one frame per view, each into the path of its view
+	camera.rendring_frame.lock(); // block rendering for other threads until finished
+	const vector<int*> frames = draw_views();
+	for(uint v=0u; v<(uint)frames.size(); v++) {
+		Image* image = encoder.acquire(camera.width, camera.height); // reused frame buffer, waits for a free one if all are in the encoder queue
+		if(image==nullptr) continue; // encoder queue is full and frame dropping is enabled
+		std::copy(frames[v], frames[v]+(ulong)camera.width*(ulong)camera.height, image->data()); // frames of views are overwritten by the next draw_views() call
+		encoder.submit(image, default_filename(views[v].path, name, extension, lbm->get_t()), extension, png_level);
+	}
 	camera.rendring_frame.unlock();
 }
-void LBM::Graphics::write_frame_png(const string& path, bool print_preview) { // save current frame as .png file (smallest file size, but slow)
+void LBM::Graphics::write_frame_png(const string& path, bool print_preview) { // save current frame as .png file (small file size, compression level set with png_level)
 	write_frame(path, "image", ".png", print_preview);
 }
 void LBM::Graphics::write_frame_qoi(const string& path, bool print_preview) { // save current frame as .qoi file (small file size, fast)
@@ -1332,7 +2510,7 @@ void LBM::Graphics::write_frame_qoi(const string& path, bool print_preview) { //
 void LBM::Graphics::write_frame_bmp(const string& path, bool print_preview) { // save current frame as .bmp file (large file size, fast)
 	write_frame(path, "image", ".bmp", print_preview);
 }
-void LBM::Graphics::write_frame_png(const uint x1, const uint y1, const uint x2, const uint y2, const string& path, bool print_preview) { // save current frame as .png file (smallest file size, but slow)
+void LBM::Graphics::write_frame_png(const uint x1, const uint y1, const uint x2, const uint y2, const string& path, bool print_preview) { // save current frame as .png file (small file size, compression level set with png_level)
 	write_frame(x1, y1, x2, y2, path, "image", ".png", print_preview);
 }
 void LBM::Graphics::write_frame_qoi(const uint x1, const uint y1, const uint x2, const uint y2, const string& path, bool print_preview) { // save current frame as .qoi file (small file size, fast)
@@ -13,9 +13,11 @@ uint3 resolution(const float3 box_aspect_ratio, const uint memory); // input: si
 
 string default_filename(const string& path, const string& name, const string& extension, const ulong t); // generate a default filename with timestamp
 string default_filename(const string& name, const string& extension, const ulong t); // generate a default filename with timestamp at exe_path/export/
+vector<Device_Info> smart_device_selection(const uint D); // select devices for D domains, either as specified by the user in command line arguments, or automatically
 
 #pragma warning(disable:26812)
 enum enum_transfer_field { fi, rho_u_flags, flags, F, phi_massex_flags, gi, T, enum_transfer_field_length };
+enum enum_isosurface { isosurface_u, isosurface_q, isosurface_phi }; // field for isosurface extraction: velocity magnitude, Q-criterion, fill level (only for SURFACE extension)
 
 class LBM_Domain {
 private:
@@ -62,6 +64,36 @@ private:
 #ifdef PARTICLES
 	Kernel kernel_integrate_particles; // intgegrates particles forward in time and couples particles to fluid
 #endif // PARTICLES
+#ifdef TEMPORAL_BLOCKING
+	Kernel kernel_stream_collide_tb; // temporally blocked LBM kernel, performs TEMPORAL_BLOCKING time steps per launch
+	Memory<fpxx> fi_tb; // second DDF buffer, kernel_stream_collide_tb reads from fi and writes to fi_tb, then their device buffers are swapped, fi_tb has no host buffer
+	Memory<float> tb_region; // one region buffer (tile plus halo) per work-group; only exists in device memory
+	uint tb_Tx=1u, tb_Ty=1u, tb_Tz=1u; // tile dimensions
+	uint tb_groups = 1u; // number of work-groups, each processes one tile at a time
+#endif // TEMPORAL_BLOCKING
+#ifdef ACTIVE_CELLS
+	Kernel kernel_update_active_cells; // compact indices of all non-solid and non-gas cells into active_cells
+	Memory<uint> active_cells; // compacted list of active cell indices, stream_collide only runs over these; only exists in device memory
+	Memory<uint> active_count; // number of active cells
+#endif // ACTIVE_CELLS
+
+	struct Rigid_Mesh { // triangle mesh that stays resident in device memory for re-voxelization with voxelize_rigid_mesh_on_device()
+		uint triangle_number = 0u;
+		float3 mesh_pmin, mesh_pmax; // bounding box of mesh in its reference pose
+		uint direction = 0u; // ray direction of voxelize_mesh
+		uint bins_u=1u, bins_v=1u; // triangle bins in mesh coordinates, in the ray plane
+		float u0=0.0f, v0=0.0f, bin_size=1.0f;
+		vector<uint> bin_offsets_host, bin_triangles_host;
+		bool voxelized = false; // whether pmin/pmax of a previous pose exist
+		float3 pmin, pmax; // bounding box of previous pose
+		Memory<float> vertices; // copy of packed triangle vertices p0|p1|p2 in mesh coordinates, independent of the host mesh
+		Memory<uint> bin_offsets, bin_triangles;
+		Memory<float> parameters; // bounding box, velocity, bins and inverse pose for voxelize_mesh
+		Kernel kernel_voxelize_mesh;
+	};
+	vector<Rigid_Mesh*> rigid_meshes; // meshes that are resident in device memory, indexed by handle, nullptr once released (handles are never reused)
+	Kernel kernel_count_flags; // count cells with (flags&flag_mask)==flag_value, bitwise-or all flags and count moving boundary cells
+	Kernel kernel_extract_isosurface; // marching cubes on a field, compacts triangles into isosurface_triangles
 
 	void allocate(Device& device); // allocate all memory for data fields on host and device and set up kernels
 	string device_defines() const; // returns preprocessor constants for embedding in OpenCL C code
@@ -70,6 +102,10 @@ public:
 	Memory<float> rho; // density of every cell
 	Memory<float> u; // velocity of every cell
 	Memory<uchar> flags; // flags of every cell
+	Memory<uint> flag_count; // number of matching cells, bitwise-or of all flags and number of moving boundary cells from kernel_count_flags
+	Memory<float> isosurface_triangles; // triangles of the last extracted isosurface, 9 floats (p0, p1, p2) each, only allocated with the first extraction
+	Memory<uint> isosurface_count; // number of triangles of the last extracted isosurface, can be larger than the capacity of isosurface_triangles
+	Memory<float> solid_fraction; // solid volume fraction of every cell from voxelize_sdf(), only allocated if LBM::sdf_solid_fraction is enabled
 #ifdef FORCE_FIELD
 	Memory<float> F; // individual force for every cell
 	Memory<float> object_sum; // sum of individual cell data for an object
@@ -92,10 +128,16 @@ public:
 	void enqueue_transfer_insert_field(Kernel& kernel_transfer_insert_field, const uint direction, const uint bytes_per_cell);
 
 	LBM_Domain(const Device_Info& device_info, const uint Nx, const uint Ny, const uint Nz, const uint Dx, const uint Dy, const uint Dz, const int Ox, const int Oy, const int Oz, const float nu, const float fx, const float fy, const float fz, const float sigma, const float alpha, const float beta, const uint particles_N, const float particles_rho); // compiles OpenCL C code and allocates memory
+	~LBM_Domain(); // frees resident meshes
 
 	void enqueue_initialize(); // write all data fields to device and call kernel_initialize
 	void enqueue_stream_collide(); // call kernel_stream_collide to perform one LBM time step
+#ifdef TEMPORAL_BLOCKING
+	void enqueue_stream_collide_tb(); // call kernel_stream_collide_tb to perform TEMPORAL_BLOCKING LBM time steps at once
+#endif // TEMPORAL_BLOCKING
 	void enqueue_update_fields(); // update fields (rho, u, T) manually
+	void enqueue_count_flags(const uchar flag_value, const uchar flag_mask=0xFFu); // count cells with (flags&flag_mask)==flag_value into flag_count
+	void enqueue_extract_isosurface(const uint field, const float iso); // compact triangles of the isosurface of field at isovalue iso into isosurface_triangles and their number into isosurface_count
 #ifdef SURFACE
 	void enqueue_surface_0();
 	void enqueue_surface_1();
@@ -114,10 +156,15 @@ public:
 #ifdef PARTICLES
 	void enqueue_integrate_particles(const uint time_step_multiplicator=1u); // intgegrates particles forward in time and couples particles to fluid
 #endif // PARTICLES
+#ifdef ACTIVE_CELLS
+	void enqueue_update_active_cells(); // rebuild compacted list of active cells after flags have changed
+	void update_active_cells_range(); // read number of active cells from device and shrink kernel ranges accordingly (blocking)
+#endif // ACTIVE_CELLS
 
 	void increment_time_step(const uint steps=1u); // increment time step
 	void reset_time_step(); // reset time step
 	void finish_queue();
+	void enqueue_marker(Event* event_returned); // enqueue marker event, for example for device-side timing
 
 	const Device& get_device() const { return device; }
 	uint get_Nx() const { return Nx; } // get (local) lattice dimensions in x-direction
@@ -144,7 +191,12 @@ public:
 	void set_f(const float fx, const float fy, const float fz) { set_fx(fx); set_fy(fy); set_fz(fz); } // set global froce per volume
 
 	void voxelize_mesh_on_device(const Mesh* mesh, const uchar flag=TYPE_S, const float3& rotation_center=float3(0.0f), const float3& linear_velocity=float3(0.0f), const float3& rotational_velocity=float3(0.0f)); // voxelize mesh
-	void voxelize_sdf_on_device(const SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag); // voxelize SDF on GPU
+	uint upload_rigid_mesh(const Mesh* mesh, const float3& rotation_axis); // upload mesh and triangle bins to device memory once, returns handle
+	void release_rigid_mesh(const uint handle); // free device memory of resident mesh
+	void voxelize_rigid_mesh_on_device(const uint handle, const float3x3& rotation, const float3& translation, const uchar flag, const float3& rotation_center, const float3& linear_velocity, const float3& rotational_velocity); // voxelize mesh that stays resident in device memory in new pose
+	void voxelize_sdf_on_device(const SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag, const bool compute_solid_fraction=false); // voxelize SDF on GPU
+	void allocate_solid_fraction(); // allocate solid_fraction on first use, initialized to 0
+	void voxelize_sparse_sdf_on_device(const Sparse_SDF* sdf, const float3& center, const float3x3& rotation, const float scale, const uchar flag, const bool compute_solid_fraction=false); // voxelize narrow-band SDF on GPU
 	void enqueue_unvoxelize_mesh_on_device(const Mesh* mesh, const uchar flag=TYPE_S); // remove voxelized triangle mesh from LBM grid
 
 #ifdef GRAPHICS
@@ -176,8 +228,52 @@ public:
 		Kernel kernel_graphics_particles;
 #endif // PARTICLES
 
+		Kernel kernel_yuv420; // convert bitmap to YUV 4:2:0 for video streaming, only allocated when used
+		Memory<uchar> yuv; // Y plane, then U and V planes with half resolution
+		bool yuv_output = false; // read back yuv instead of bitmap
+
+		struct View { // frame buffers of one additional camera view for multi-view rendering
+			Memory<float> camera_parameters;
+			Memory<int> bitmap, zbuffer;
+			uint screen_rect[4] = { 0u, 0u, 0u, 0u };
+		};
+		vector<View> views; // views rendered by enqueue_draw_view(), allocated with allocate_views()
+
+		Kernel kernel_graphics_lod; // downsample fields and flags into bricks of lod^3 cells, only allocated when used
+		Kernel kernel_graphics_flags_lod, kernel_graphics_flags_mc_lod, kernel_graphics_field_slice_lod, kernel_graphics_q_lod; // render downsampled lattice
+		Memory<float> lod_rho, lod_u; // downsampled fields, device only
+		Memory<uchar> lod_flags;
+#ifdef SURFACE
+		Memory<float> lod_phi;
+		Kernel kernel_graphics_rasterize_phi_lod;
+#endif // SURFACE
+#ifdef TEMPERATURE
+		Memory<float> lod_T;
+#endif // TEMPERATURE
+		uint lod = 0u; // factor of the allocated downsampled lattice, 0 means not allocated (gathering uses lod=1 for a full resolution copy)
+		ulong t_last_lod = max_ulong; // downsampled lattice is only rebuilt if the LBM time step has changed
+		bool last_frame_lod = false; // last frame was rendered from the downsampled lattice, so the next frame has to be rendered in full resolution even if the scene is unchanged
+
+		Memory<uchar> gather_flags; // multi-domain: downsampled lattices of all domains, gathered on domain 0 for raytracing
+		Memory<float> gather_rho, gather_u;
+		Kernel kernel_graphics_field_rt_gather; // raytrace gathered fields
+#ifdef SURFACE
+		Memory<float> gather_phi;
+		Kernel kernel_graphics_raytrace_phi_gather; // raytrace gathered free surface
+#endif // SURFACE
+#ifdef TEMPERATURE
+		Memory<float> gather_T;
+#endif // TEMPERATURE
+
 		ulong t_last_rendered_frame = max_ulong; // optimization to not call draw_frame() multiple times if camera_parameters and LBM time step are unchanged
+		uint screen_rect[4] = { 0u, 0u, 0u, 0u }; // screen-space bounding rectangle (x0, y0, x1, y1) of everything this domain draws, for multi-domain compositing
 		bool update_camera(); // update camera_parameters and return if they are changed from their previous state
+		void update_screen_rect(uint* rect, const int visualization_modes) const; // project domain bounding box to screen, falls back to the entire screen if the box is not fully in front of the camera or force vectors are drawn
+		void link_frame(const Memory<float>& camera_parameters, const Memory<int>& bitmap, const Memory<int>& zbuffer); // set the camera and frame buffers of all rendering kernels
+		void enqueue_render(const int visualization_modes, const int field_mode, const int slice_mode, const int slice_x, const int slice_y, const int slice_z, const bool use_lod=false); // enqueue clearing and all rendering kernels for the linked frame buffers
+		void lod_dimensions(const uint lod, uint* M) const; // dimensions of the downsampled lattice without halo, same as lod_size() in OpenCL C
+		void allocate_lod(const uint lod); // allocate downsampled lattice and its kernels, only reallocates if lod has changed
+		void enqueue_read_frame(Memory<int>& bitmap, Memory<int>& zbuffer, uint* rect, const int visualization_modes); // multi-domain: only read back the rows this domain can have drawn to
 
 	public:
 		Graphics() {} // default constructor
@@ -195,9 +291,21 @@ public:
 			return *this;
 		}
 		void allocate(Device& device); // allocate memory for bitmap and zbuffer
-		bool enqueue_draw_frame(const int visualization_modes, const int field_mode=0, const int slice_mode=0, const int slice_x=0, const int slice_y=0, const int slice_z=0, const bool visualization_change=true); // main rendering function, calls rendering kernels, returns true if new frame is rendered, false if old frame is returned when camera has not moved
-		int* get_bitmap(); // returns pointer to bitmap
-		int* get_zbuffer(); // returns pointer to zbuffer
+		bool enqueue_draw_frame(const int visualization_modes, const int field_mode=0, const int slice_mode=0, const int slice_x=0, const int slice_y=0, const int slice_z=0, const bool visualization_change=true, const uint lod=1u); // main rendering function, calls rendering kernels, returns true if new frame is rendered, false if old frame is returned when camera has not moved, renders from bricks of lod^3 cells while the camera moves
+		uint lod_factor(const uint lod, const ulong lod_cells) const; // resolve lod setting: 0 picks the smallest power of 2 that keeps the downsampled lattice below lod_cells
+		uint get_frame_lod() const { return last_frame_lod ? lod : 1u; } // level of detail of the last rendered frame
+		void free_lod(); // delete downsampled lattice and its kernels to release their VRAM
+		bool gathered_raytracing = false; // multi-domain: raytraced modes are not rendered per domain, but from the lattice gathered on domain 0 after compositing
+		void enqueue_read_lod(const uint lod, const bool phi, const bool fields); // multi-domain: build downsampled lattice if the time step has changed, and read it back for gathering
+		void gather(const vector<const Graphics*>& domains, const uint lod, const bool phi, const bool fields); // domain 0 only: assemble the downsampled lattices of all domains and copy them to the device
+		void draw_gathered(const int view, const int visualization_modes, const int field_mode, const int slice_mode); // domain 0 only: raytrace the gathered lattice into the composited frame of the specified view, or of the default frame for view=-1
+		void allocate_views(const uint views_N); // allocate frame buffers for views_N additional camera views, only reallocates if views_N has changed
+		void enqueue_draw_view(const uint view, const int visualization_modes, const int field_mode=0, const int slice_mode=0, const int slice_x=0, const int slice_y=0, const int slice_z=0); // render the current camera settings into the frame buffers of the specified view
+		int* get_bitmap(const int view=-1); // returns pointer to bitmap, or to bitmap of the specified view
+		int* get_zbuffer(const int view=-1); // returns pointer to zbuffer, or to zbuffer of the specified view
+		void set_yuv_output(const bool enabled); // single-domain only: convert frame to YUV 4:2:0 on the device and read back that instead of bitmap
+		uchar* get_yuv(); // returns pointer to yuv
+		const uint* get_screen_rect(const int view=-1) const { return view<0 ? screen_rect : views[view].screen_rect; } // only rows screen_rect[1] to screen_rect[3]-1 of bitmap/zbuffer are read back for multi-domain rendering
 		string device_defines() const; // returns preprocessor constants for embedding in OpenCL C code
 	}; // Graphics
 	Graphics graphics;
@@ -206,16 +314,69 @@ public:
 
 
 
+#ifdef GRAPHICS
+#include <condition_variable> // for Encoder_Pool
+#include <deque>
+class Encoder_Pool { // fixed number of image encoder threads with a bounded queue of reusable frame buffers
+private:
+	struct Job {
+		Image* image = nullptr;
+		string filename, extension;
+		uint png_level = 2u;
+	};
+	vector<thread> threads;
+	std::mutex mutex;
+	std::condition_variable job_queued; // wakes up encoder threads
+	std::condition_variable frame_freed; // wakes up acquire() when a frame buffer has been encoded
+	std::deque<Job> queue; // frames waiting to be encoded
+	vector<Image*> free_frames; // encoded frame buffers, reused by acquire()
+	uint threads_N=0u, queue_length=0u, frames_allocated=0u; // at most threads_N+queue_length frame buffers exist at any time
+	bool drop_frames=false, stop=false;
+	ulong frames_encoded=0ull, frames_dropped=0ull;
+	double time_encode_total=0.0, time_encode_max=0.0, time_encode_last=0.0; // per-frame encode timing in seconds
+	void worker();
+
+public:
+	Encoder_Pool() {} // threads are started lazily on the first acquire()
+	~Encoder_Pool() { finish(); }
+	Encoder_Pool(const Encoder_Pool&) = delete;
+	Encoder_Pool& operator=(const Encoder_Pool&) = delete;
+	void configure(const uint threads_N, const uint queue_length, const bool drop_frames); // threads_N=0 uses half of the CPU cores, queue_length=0 uses 2*threads_N, drop_frames=false blocks write_frame() while the queue is full
+	Image* acquire(const uint width, const uint height); // returns a frame buffer to copy a frame into, or nullptr if the queue is full and drop_frames is set
+	void submit(Image* image, const string& filename, const string& extension, const uint png_level=2u); // queue frame buffer from acquire() for encoding
+	void finish(); // encode all queued frames, then stop encoder threads
+	uint queued(); // number of frames waiting to be encoded
+	double get_time_encode_last(); // encode time of the last frame in seconds
+	double get_time_encode_average(); // average encode time per frame in seconds
+}; // Encoder_Pool
+#endif // GRAPHICS
+
+
+
 class LBM {
 private:
 	uint Nx=1u, Ny=1u, Nz=1u; // (global) lattice dimensions
 	uint Dx=1u, Dy=1u, Dz=1u; // lattice domains
 	bool initialized = false; // becomes true after LBM::initialize() has been called
+	bool setup_on_device = false; // true while device copies of flags and u are newer than host copies before initialization
+#ifdef ACTIVE_CELLS
+	bool active_cells_outdated = true; // set whenever flags change in device memory outside of the time step (initialization, voxelization, update_moving_boundaries(), flags.write_to_device()), so run() only rebuilds active cells when needed
+#endif // ACTIVE_CELLS
 
 	void sanity_checks_constructor(const vector<Device_Info>& device_infos, const uint Nx, const uint Ny, const uint Nz, const uint Dx, const uint Dy, const uint Dz, const float nu, const float fx, const float fy, const float fz, const float sigma, const float alpha, const float beta, const uint particles_N, const float particles_rho); // sanity checks on grid resolution and extension support
 	void sanity_checks_initialization(); // sanity checks during initialization on used extensions based on used flags
 	void initialize(); // write all data fields to device and call kernel_initialize
+	void prepare_voxelization(); // before initialization, write host flags and u to device once so voxelization does not overwrite host setup
+	void finish_voxelization(); // before initialization, copy voxelization results back to host unless device_setup is enabled
+	void allocate_solid_fraction(); // allocate solid_fraction on first use
+#ifdef ACTIVE_CELLS
+	void update_active_cells(); // rebuild compacted lists of active cells at the start of run() if flags have been changed in between
+#endif // ACTIVE_CELLS
+	uint get_batch_steps() const; // number of time steps that run() enqueues back-to-back with only a single host synchronization
 	void do_time_step(); // call kernel_stream_collide to perform one LBM time step
+#ifdef TEMPORAL_BLOCKING
+	void do_time_step_tb(); // call kernel_stream_collide_tb to perform TEMPORAL_BLOCKING LBM time steps at once
+#endif // TEMPORAL_BLOCKING
 
 	void communicate_field(const enum_transfer_field field, const uint bytes_per_cell);
 
@@ -245,47 +406,22 @@ public:
 		Memory<T>** buffers = nullptr; // host buffers
 		string name = "";
 
-		uint Nx=1u, Ny=1u, Nz=1u, Dx=1u, Dy=1u, Dz=1u, D=1u; // auxiliary variables: (local) lattice dimensions, lattice domains, number of domains
-		uint NxDx=1u, NyDy=1u, NzDz=1u, Hx=0u, Hy=0u, Hz=0u; // auxiliary variables: number of domains, shortcuts for N_/D_, halo offsets
-		ulong NxNy=1ull, local_Nx=1ull, local_Ny=1ull, local_Nz=1ull, local_N=1ull; // auxiliary variables: shortcut for Nx*Ny, size of each domain, number of cells in each domain
+		uint Nx=1u, Ny=1u, Nz=1u, D=1u; // auxiliary variables: lattice dimensions, number of domains
+		Domain_Stitching stitching; // maps global indices to domain buffers
 		inline void initialize_auxiliary_variables() { // these variables are frequently used in reference() functions, so pre-compute them only once here
 			Nx = lbm->get_Nx(); Ny = lbm->get_Ny(); Nz = lbm->get_Nz();
-			Dx = lbm->get_Dx(); Dy = lbm->get_Dy(); Dz = lbm->get_Dz();
-			D = Dx*Dy*Dz; // number of domains
-			NxNy = (ulong)Nx*(ulong)Ny; // shortcut for Nx*Ny
-			NxDx=Nx/Dx; NyDy=Ny/Dy; NzDz=Nz/Dz; // shortcuts for N_/D_
-			Hx=Dx>1u; Hy=Dy>1u; Hz=Dz>1u; // halo offsets
-			local_Nx=(ulong)(NxDx+2u*Hx); local_Ny=(ulong)(NyDy+2u*Hy); local_Nz=(ulong)(NzDz+2u*Hz); // size of each domain
-			local_N = local_Nx*local_Ny*local_Nz; // number of cells in each domain
+			stitching = Domain_Stitching(Nx, Ny, Nz, lbm->get_Dx(), lbm->get_Dy(), lbm->get_Dz());
+			D = stitching.D; // number of domains
 		}
 		inline void initialize_auxiliary_pointers() {
 			/********/ x = Pointer(this, 0x0u);
 			if(d>0x1u) y = Pointer(this, 0x1u);
 			if(d>0x2u) z = Pointer(this, 0x2u);
 		}
-		inline T& reference(const ulong i) { // stitch together domain buffers and make them appear as one single large buffer
-			if(D==1u) { // take shortcut for single domain
-				return buffers[0]->data()[i]; // array of structures
-			} else { // decompose index for multiple domains
-				const ulong global_i=i%N, t=global_i%NxNy;
-				const uint x=(uint)(t%(ulong)Nx), y=(uint)(t/(ulong)Nx), z=(uint)(global_i/NxNy); // n = x+(y+z*Ny)*Nx
-				const uint px=x%NxDx, py=y%NyDy, pz=z%NzDz, dx=x/NxDx, dy=y/NyDy, dz=z/NzDz, domain=dx+(dy+dz*Dy)*Dx; // 3D position within domain and which domain
-				const ulong local_i = (ulong)(px+Hx)+((ulong)(py+Hy)+(ulong)(pz+Hz)*local_Ny)*local_Nx; // add halo offsets
-				const ulong local_dimension = i/N;
-				return buffers[domain]->data()[local_i+local_dimension*local_N]; // array of structures
-			}
-		}
-		inline T& reference(const ulong i, const uint dimension) { // stitch together domain buffers and make them appear as one single large buffer
-			if(D==1u) { // take shortcut for single domain
-				return buffers[0]->data()[i+(ulong)dimension*N]; // array of structures
-			} else { // decompose index for multiple domains
-				const ulong global_i=i%N, t=global_i%NxNy;
-				const uint x=(uint)(t%(ulong)Nx), y=(uint)(t/(ulong)Nx), z=(uint)(global_i/NxNy); // n = x+(y+z*Ny)*Nx
-				const uint px=x%NxDx, py=y%NyDy, pz=z%NzDz, dx=x/NxDx, dy=y/NyDy, dz=z/NzDz, domain=dx+(dy+dz*Dy)*Dx; // 3D position within domain and which domain
-				const ulong local_i = (ulong)(px+Hx)+((ulong)(py+Hy)+(ulong)(pz+Hz)*local_Ny)*local_Nx; // add halo offsets
-				const ulong local_dimension = max(i/N, (ulong)dimension);
-				return buffers[domain]->data()[local_i+local_dimension*local_N]; // array of structures
-			}
+		inline T& reference(const ulong i, const uint dimension=0u) { // stitch together domain buffers and make them appear as one single large buffer
+			uint domain = 0u;
+			const ulong local_i = stitching.index(i, dimension, domain);
+			return buffers[domain]->data()[local_i]; // array of structures
 		}
 		inline string vtk_type() const {
 			/**/ if constexpr(std::is_same<T, char >::value) return "char" ; else if constexpr(std::is_same<T, uchar >::value) return "unsigned_char" ;
@@ -316,25 +452,11 @@ public:
 				"POINT_DATA "+to_string((ulong)Nx*(ulong)Ny*(ulong)Nz)+"\n"
 				"SCALARS data "+vtk_type()+" "+to_string(dimensions())+"\nLOOKUP_TABLE default\n"
 			;
-			const uint chunk_size_MB = 4u*thread::hardware_concurrency(); // in MB; convert and write data in chunks, to reduce memory footprint and time for large memory allocation
-			const ulong chunk_elements = (1048576ull*(ulong)chunk_size_MB)/((ulong)dimensions()*sizeof(T));
-			const ulong chunks=length()/chunk_elements, chunk_remainder=length()%chunk_elements;
-			T* data = new T[chunk_elements*(ulong)dimensions()];
 			create_folder(filename);
 			std::ofstream file(filename, std::ios::out|std::ios::binary);
 			file.write(header.c_str(), header.length()); // write non-binary file header
-			for(ulong c=0u; c<chunks+1ull; c++) { // iterate over all full chunks + last chunk_remainder chunk
-				const ulong N = c<chunks ? chunk_elements : chunk_remainder;
-				if(N==0ull) break; // chunk_remainder may be 0, then skip last iteration
-				parallel_for(N, [&](ulong i) {
-					for(uint d=0u; d<dimensions(); d++) { // LBM to SI units, LittleEndian to BigEndian, AoS to SoA
-						data[i*(ulong)dimensions()+(ulong)d] = reverse_bytes((T)(unit_conversion_factor*reference(c*chunk_elements+i, d)));
-					}
-				});
-				file.write((char*)data, N*(ulong)dimensions()*sizeof(T)); // write binary data
-			}
+			write_vtk_data<T>(file, length(), dimensions(), [&](const ulong n, const uint d) { return unit_conversion_factor*reference(n, d); }); // LBM to SI units
 			file.close();
-			delete[] data;
 			info.allow_printing.lock();
 			print_info("File \""+filename+"\" saved.");
 			info.allow_printing.unlock();
@@ -398,6 +520,9 @@ public:
 		inline void write_to_device() {
 			for(uint domain=0u; domain<D; domain++) buffers[domain]->enqueue_write_to_device();
 			for(uint domain=0u; domain<D; domain++) buffers[domain]->finish_queue();
+#ifdef ACTIVE_CELLS
+			if(name=="flags") lbm->active_cells_outdated = true;
+#endif // ACTIVE_CELLS
 		}
 		inline void write_host_to_vtk(const string& path="", const bool convert_to_si_units=true) { // write binary .vtk file
 			write_vtk(default_filename(path, name, ".vtk", lbm->get_t()), convert_to_si_units);
@@ -422,9 +547,13 @@ public:
 #ifdef TEMPERATURE
 	Memory_Container<float> T; // temperature of every cell
 #endif // TEMPERATURE
+	Memory_Container<float> solid_fraction; // solid volume fraction of every cell, only allocated by voxelize_sdf() with sdf_solid_fraction enabled
 #ifdef PARTICLES
 	Memory<float>* particles; // particle positions
 #endif // PARTICLES
+	uint batch_steps = 0u; // number of time steps that run() enqueues back-to-back per host synchronization (single-GPU only); 0 = adapt automatically to the runtime per time step
+	bool device_setup = false; // if true, voxelization results stay in device memory before initialization, host copies of flags and u are only updated by synchronize_setup()
+	bool sdf_solid_fraction = false; // if true, voxelize_sdf() also computes the solid volume fraction of every cell near the surface into solid_fraction
 
 	LBM(const uint Nx, const uint Ny, const uint Nz, const uint Dx, const uint Dy, const uint Dz, const float nu, const float fx=0.0f, const float fy=0.0f, const float fz=0.0f, const float sigma=0.0f, const float alpha=0.0f, const float beta=0.0f, const uint particles_N=0u, const float particles_rho=0.0f); // compiles OpenCL C code and allocates memory
 	LBM(const uint Nx, const uint Ny, const uint Nz, const float nu, const float fx=0.0f, const float fy=0.0f, const float fz=0.0f, const float sigma=0.0f, const float alpha=0.0f, const float beta=0.0f, const uint particles_N=0u, const float particles_rho=1.0f); // compiles OpenCL C code and allocates memory
@@ -439,6 +568,9 @@ public:
 	void run(const ulong steps=max_ulong, const ulong total_steps=max_ulong); // initializes the LBM simulation (copies data to device and runs initialize kernel), then runs LBM
 	void update_fields(); // update fields (rho, u, T) manually
 	void reset(); // reset simulation (takes effect in following run() call)
+	void synchronize_setup(); // copy flags and u of a device_setup back to host, so they can be read or modified on the host again before initialization
+	ulong count_flags(const uchar flag_value, const uchar flag_mask=0xFFu); // count cells with (flags&flag_mask)==flag_value with a device reduction
+	Mesh* extract_isosurface(const uint field, const float iso); // extract isosurface of field (isosurface_u, isosurface_q or isosurface_phi) at isovalue iso with marching cubes on the device, returns mesh in lattice coordinates, has to be deleted by the caller
 #ifdef FORCE_FIELD
 	void update_force_field(); // calculate forces from fluid on TYPE_S cells
 	float3 object_center_of_mass(const uchar flag_marker=TYPE_S); // calculate center of mass of all cells flagged with flag_marker
@@ -537,8 +669,14 @@ public:
 	void write_status(const string& path=""); // write LBM status report to a .txt file
 
 	void voxelize_mesh_on_device(const Mesh* mesh, const uchar flag=TYPE_S, const float3& rotation_center=float3(0.0f), const float3& linear_velocity=float3(0.0f), const float3& rotational_velocity=float3(0.0f)); // voxelize mesh
+	uint upload_rigid_mesh(const Mesh* mesh, const float3& rotation_axis=float3(0.0f)); // upload mesh in its reference pose to device memory once, returns handle for voxelize_rigid_mesh_on_device(); the mesh is copied, so the host mesh can be modified or deleted afterwards, rotation_axis selects the ray direction for the triangle bins
+	void release_rigid_mesh(const uint handle); // free device memory of mesh uploaded with upload_rigid_mesh(), handle becomes invalid
+	void voxelize_rigid_mesh_on_device(const uint handle, const float3x3& rotation, const float3& translation=float3(0.0f), const uchar flag=TYPE_S, const float3& rotation_center=float3(0.0f), const float3& linear_velocity=float3(0.0f), const float3& rotational_velocity=float3(0.0f)); // voxelize resident mesh in pose rotation*(p-rotation_center)+rotation_center+translation, only the pose is uploaded
 	void unvoxelize_mesh_on_device(const Mesh* mesh, const uchar flag=TYPE_S); // remove voxelized triangle mesh from LBM grid
-	void write_mesh_to_vtk(const Mesh* mesh, const string& path="", const bool convert_to_si_units=true) const; // write mesh to binary .vtk file
+	void write_mesh_to_vtk(const Mesh* mesh, const string& path="", const bool convert_to_si_units=true, const string& name="mesh") const; // write mesh to binary .vtk file
+	void write_mesh_to_stl(const Mesh* mesh, const string& path="", const bool convert_to_si_units=true, const string& name="mesh") const; // write mesh to binary .stl file
+	void write_mesh_to_ply(const Mesh* mesh, const string& path="", const bool convert_to_si_units=true, const string& name="mesh") const; // write mesh to binary .ply file
+	void write_isosurface(const uint field, const float iso, const string& path="", const string& extension=".vtk", const bool convert_to_si_units=true); // extract isosurface on the device and write it to binary .vtk, .stl or .ply file
 	void voxelize_stl(const string& path, const float3& center, const float3x3& rotation, const float size=0.0f, const uchar flag=TYPE_S); // read and voxelize binary .stl file
 	void voxelize_stl(const string& path, const float3x3& rotation, const float size=0.0f, const uchar flag=TYPE_S); // read and voxelize binary .stl file (place in box center)
 	void voxelize_stl(const string& path, const float3& center, const float size=0.0f, const uchar flag=TYPE_S); // read and voxelize binary .stl file (no rotation)
@@ -552,9 +690,29 @@ public:
 	class Graphics {
 	private:
 		LBM* lbm = nullptr;
-		std::atomic_int running_encoders = 0;
+		Encoder_Pool encoder; // encodes exported frames in the background
+		FILE* stream = nullptr; // video stream opened with open_stream()
+		bool stream_pipe=false, stream_yuv=true;
+		vector<uchar> stream_buffer; // frame in stream format, if converted on the host
+		struct View { // camera settings of one view for multi-view rendering
+			float3 pos;
+			double rx=0.0, ry=0.0;
+			float fov=100.0f, zoom=1.0f;
+			bool free = false;
+			string path = "";
+		};
+		vector<View> views; // views that are rendered together with draw_views()
 		uint last_exported_frame = 0u; // for next_frame(...) function
 		int last_visualization_modes=0, last_field_mode=0, last_slice_mode=0, last_slice_x=0, last_slice_y=0, last_slice_z=0; // don't render a new frame if the scene hasn't changed since last frame
+		ulong t_last_gather = max_ulong; // gathered lattice is only updated if the time step, level of detail or raytraced modes have changed
+		uint last_gather_lod = 0u;
+		int last_gather_modes = 0;
+		int gather_modes() const; // multi-domain: raytraced modes that need the gathered lattice, bit 0: free surface, bit 1: field
+		uint gather_factor() const; // level of detail of the gathered lattice in full resolution frames
+		void gather(const uint lod); // gather downsampled lattices of all domains on domain 0
+		void composite(const int view=-1); // multi-domain: overlay the frames of all domains into the frame of domain 0
+		View get_view() const; // current camera settings
+		void set_view(const View& view); // apply camera settings to the camera
 		void default_settings() {
 			visualization_modes |= VIS_FLAG_LATTICE;
 #ifdef PARTICLES
@@ -563,6 +721,7 @@ public:
 		}
 
 	public:
+		uint png_level = 2u; // compression level for .png frames: 0 (no compression, fastest), 1 (fast), 2 (balanced), 3 (smallest file size, but slow)
 		int visualization_modes=0, field_mode=0, slice_mode=0, slice_x=0, slice_y=0, slice_z=0; // field_mode = { 0 (u), 1 (rho), 2 (T) }, slice_mode = { 0 (no slice), 1 (x), 2 (y), 3 (z), 4 (xz), 5 (xyz), 6 (yz), 7 (xy) }, slice_{xyz} = position of slices
 
 		Graphics() {} // default constructor
@@ -575,15 +734,8 @@ public:
 			default_settings();
 		}
 		~Graphics() { // destructor must wait for all encoder threads to finish
-			int last_value = running_encoders.load();
-			while(last_value>0) {
-				const int current_value = running_encoders.load();
-				if(last_value!=current_value) {
-					print_info("Finishing encoder threads: "+to_string(current_value));
-					last_value = current_value;
-				}
-				sleep(0.016);
-			}
+			encoder.finish();
+			close_stream();
 		}
 		Graphics& operator=(const Graphics& graphics) { // copy assignment
 			lbm = graphics.lbm;
@@ -593,21 +745,40 @@ public:
 			slice_x = graphics.slice_x;
 			slice_y = graphics.slice_y;
 			slice_z = graphics.slice_z;
+			lod = graphics.lod;
+			lod_cells = graphics.lod_cells;
+			gather_cells = graphics.gather_cells;
 			return *this;
 		}
 
-		int* draw_frame(); // main rendering function, calls rendering kernels
+		uint lod = 0u; // level of detail while the camera moves: 0 (automatic), 1 (always full resolution), 2/4/8/... (render from bricks of lod^3 cells); the frame is refined to full resolution once the camera stops
+		ulong lod_cells = 16777216ull; // automatic level of detail: maximum number of downsampled cells per domain; the downsampled lattice allocates an extra 17 Bytes/cell (+4 each with SURFACE and TEMPERATURE) of VRAM, up to 285 MB per domain at the default; lod=1 frees it
+		ulong gather_cells = 33554432ull; // multi-domain: maximum number of cells gathered on domain 0 to raytrace the free surface and the field, the lattice is downsampled to fit; 0 disables raytracing for multiple domains
+
+		int* draw_frame(const bool preview=false); // main rendering function, calls rendering kernels, preview=true renders interactive frames with level of detail while the camera moves
+		void set_encoder(const uint threads=0u, const uint queue_length=0u, const bool drop_frames=false) { encoder.configure(threads, queue_length, drop_frames); } // number of .png/.qoi/.bmp encoder threads (0: half of CPU cores), maximum queued frames (0: 2*threads), drop frames instead of blocking write_frame() when the queue is full
 
 		void set_camera_centered(const float rx=0.0f, const float ry=0.0f, const float fov=100.0f, const float zoom=1.0f); // set camera centered
 		void set_camera_free(const float3& p=float3(0.0f), const float rx=0.0f, const float ry=0.0f, const float fov=100.0f); // set camera free
+		void add_view_centered(const float rx=0.0f, const float ry=0.0f, const float fov=100.0f, const float zoom=1.0f, const string& path=""); // add a centered camera view for draw_views()/write_views(), path is the export folder of this view
+		void add_view_free(const float3& p=float3(0.0f), const float rx=0.0f, const float ry=0.0f, const float fov=100.0f, const string& path=""); // add a free camera view for draw_views()/write_views(), path is the export folder of this view
+		void clear_views() { views.clear(); } // remove all views
+		vector<int*> draw_views(); // render all views in one pass, returns pointers to their frames
 		bool next_frame(const ulong total_time_steps, const float video_length_seconds); // returns true once simulation time has progressed enough to render the next video frame for a 60fps video of specified length
 		void print_frame(); // preview preview of current frame in console
 		void write_frame(const string& path="", const string& name="image", const string& extension=".png", bool print_preview=false); // save current frame
 		void write_frame(const uint x1, const uint y1, const uint x2, const uint y2, const string& path="", const string& name="image", const string& extension=".png", bool print_preview=false); // save current frame cropped with two corner points (x1,y1) and (x2,y2)
-		void write_frame_png(const string& path="", bool print_preview=false); // save current frame as .png file (smallest file size, but slow)
+		void write_frame_png(const string& path="", bool print_preview=false); // save current frame as .png file (small file size, compression level set with png_level)
 		void write_frame_qoi(const string& path="", bool print_preview=false); // save current frame as .qoi file (small file size, fast)
 		void write_frame_bmp(const string& path="", bool print_preview=false); // save current frame as .bmp file (large file size, fast)
-		void write_frame_png(const uint x1, const uint y1, const uint x2, const uint y2, const string& path="", bool print_preview=false); // save current frame as .png file (smallest file size, but slow)
+		void write_views(const string& name="image", const string& extension=".png"); // render all views in one pass and save one frame per view in its path
+		void write_views_png() { write_views("image", ".png"); } // save one .png frame per view
+		void write_views_qoi() { write_views("image", ".qoi"); } // save one .qoi frame per view
+		void write_views_bmp() { write_views("image", ".bmp"); } // save one .bmp frame per view
+		void open_stream(const string& path, const bool yuv=true, const uint fps=60u); // stream frames into one file or named pipe, or into a program with path="|command"; yuv=true writes .y4m (YUV 4:2:0), yuv=false writes raw RGB24 frames
+		void write_stream_frame(); // render current frame and append it to the stream
+		void close_stream();
+		void write_frame_png(const uint x1, const uint y1, const uint x2, const uint y2, const string& path="", bool print_preview=false); // save current frame as .png file (small file size, compression level set with png_level)
 		void write_frame_qoi(const uint x1, const uint y1, const uint x2, const uint y2, const string& path="", bool print_preview=false); // save current frame as .qoi file (small file size, fast)
 		void write_frame_bmp(const uint x1, const uint y1, const uint x2, const uint y2, const string& path="", bool print_preview=false); // save current frame as .bmp file (large file size, fast)
 	}; // Graphics
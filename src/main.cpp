@@ -58,6 +58,7 @@ void draw_scale(const int field_mode, const int color) {
 void main_label(const double frametime) {
 	if(camera.allow_rendering&&camera.allow_labeling) {
 		info.print_update();
+#if defined(INTERACTIVE_GRAPHICS)||defined(INTERACTIVE_GRAPHICS_ASCII) // labels are only shown on screen and never part of exported frames, so don't draw them when rendering is export-only
 		const int c = invert(GRAPHICS_BACKGROUND_COLOR);
 		{
 			const int ox=camera.width-37*(FONT_WIDTH)-1, oy=camera.height-11*(FONT_HEIGHT)-1;
@@ -135,11 +136,12 @@ void main_label(const double frametime) {
 			draw_label(ox, oy+i, "N/M ("+to_string(camera.eye_distance, 1u)+"): adjust eye distance for stereoscopic rendering", c); i+=2*FONT_HEIGHT;
 			draw_label(ox, oy+i, "Esc/Alt+F4: quit", c);
 		}
+#endif // INTERACTIVE_GRAPHICS||INTERACTIVE_GRAPHICS_ASCII
 	}
 }
 
 void main_graphics() {
-	if(camera.allow_rendering) draw_bitmap(info.lbm->graphics.draw_frame());
+	if(camera.allow_rendering) draw_bitmap(info.lbm->graphics.draw_frame(true)); // interactive frames use level of detail while the camera moves
 }
 #endif // GRAPHICS
 
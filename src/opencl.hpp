@@ -303,7 +303,7 @@ public:
 	inline Device(const Device_Info& info, const string& opencl_c_code=get_opencl_c_code()) {
 		print_device_info(info);
 		this->info = info;
-		this->cl_queue = cl::CommandQueue(info.cl_context, info.cl_device); // queue to push commands for the device
+		this->cl_queue = cl::CommandQueue(info.cl_context, info.cl_device, CL_QUEUE_PROFILING_ENABLE); // queue to push commands for the device, with event profiling for device-side timing
 		cl::Program::Sources cl_source;
 		const string kernel_code = enable_device_capabilities()+"\n"+opencl_c_code;
 		cl_source.push_back({ kernel_code.c_str(), kernel_code.length() });
@@ -328,12 +328,20 @@ public:
 	inline Device() {} // default constructor
 	inline void barrier(const vector<Event>* event_waitlist=nullptr, Event* event_returned=nullptr) { cl_queue.enqueueBarrierWithWaitList(event_waitlist, event_returned); }
 	inline void finish_queue() { cl_queue.finish(); }
+	inline void enqueue_marker(Event* event_returned) { cl_queue.enqueueMarkerWithWaitList(nullptr, event_returned); } // event_returned completes once all previously enqueued commands have completed
 	inline cl::Context get_cl_context() const { return info.cl_context; }
 	inline cl::Program get_cl_program() const { return cl_program; }
 	inline cl::CommandQueue get_cl_queue() const { return cl_queue; }
 	inline bool is_initialized() const { return exists; }
 };
 
+inline double event_runtime(const Event& event_start, const Event& event_end) { // device runtime in seconds from completion of event_start to completion of event_end, returns 0 if event profiling is not available
+	int error_start=0, error_end=0;
+	const ulong t_start = (ulong)event_start.getProfilingInfo<CL_PROFILING_COMMAND_END>(&error_start);
+	const ulong t_end = (ulong)event_end.getProfilingInfo<CL_PROFILING_COMMAND_END>(&error_end);
+	return error_start||error_end||t_end<=t_start ? 0.0 : 1E-9*(double)(t_end-t_start);
+}
+
 template<typename T> class Memory {
 private:
 	ulong N = 0ull; // buffer length
@@ -432,6 +440,24 @@ public:
 		}
 		return *this; // destructor of memory will be called automatically
 	}
+	inline void swap(Memory<T>& memory) { // exchange host and device buffers with another Memory object of the same size, for example for ping-pong buffering; kernels have to be re-linked afterwards
+		if(length()!=memory.length()||dimensions()!=memory.dimensions()) print_error("Memory objects to swap have different sizes.");
+		std::swap(host_buffer_exists, memory.host_buffer_exists);
+		std::swap(device_buffer_exists, memory.device_buffer_exists);
+		std::swap(external_host_buffer, memory.external_host_buffer);
+		std::swap(is_zero_copy, memory.is_zero_copy);
+		std::swap(host_buffer, memory.host_buffer);
+		std::swap(host_buffer_unaligned, memory.host_buffer_unaligned);
+		std::swap(device_buffer, memory.device_buffer);
+		initialize_auxiliary_pointers();
+		memory.initialize_auxiliary_pointers();
+	}
+	inline void swap_device_buffer(Memory<T>& memory) { // exchange only device buffers with another Memory object of the same size, host buffers stay where they are, for ping-pong buffering with a device-only buffer; kernels have to be re-linked afterwards
+		if(length()!=memory.length()||dimensions()!=memory.dimensions()) print_error("Memory objects to swap have different sizes.");
+		std::swap(device_buffer_exists, memory.device_buffer_exists);
+		std::swap(is_zero_copy, memory.is_zero_copy); // a zero-copy device buffer keeps using the host buffer it was created with, so read_from_device()/write_to_device() copy between the other host and device buffer
+		std::swap(device_buffer, memory.device_buffer);
+	}
 	inline T* const exchange_host_buffer(T* const host_buffer) { // sets host_buffer to new pointer and returns old pointer
 		T* const swap = this->host_buffer;
 		this->host_buffer = host_buffer;
@@ -1,6 +1,7 @@
 #include "hash_utils.hpp"
 #include <cstring>
 #include <fstream>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 
@@ -126,6 +127,28 @@ uint64_t xxhash64_stl_file(const char* filename, uint64_t seed) {
     return hash;
 }
 
+// Compute xxHash64 of a whole file, chained over chunks like xxhash64_stl_file
+uint64_t xxhash64_file(const char* filename, uint64_t seed) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    const size_t chunk_size = 1 << 20;
+    std::vector<uint8_t> buffer(chunk_size);
+    uint64_t hash = seed;
+
+    while (file.good()) {
+        file.read(reinterpret_cast<char*>(buffer.data()), chunk_size);
+        size_t bytes_read = file.gcount();
+        if (bytes_read > 0) {
+            hash = xxhash64(buffer.data(), bytes_read, hash);
+        }
+    }
+
+    return hash;
+}
+
 // Compute SDF cache key from all parameters affecting SDF output
 uint64_t compute_sdf_cache_key(const std::string& stl_path, uint32_t target_nx, uint32_t target_ny, uint32_t target_nz, int32_t padding) {
     // Start with STL file hash
@@ -33,6 +33,18 @@ uint64_t xxhash64(const void* data, size_t length, uint64_t seed = 0);
  */
 uint64_t xxhash64_stl_file(const char* filename, uint64_t seed = 0);
 
+/**
+ * @brief Compute xxHash64 of a whole file
+ *
+ * Hashes the file in 1 MB chunks, each chunk seeded with the hash of the previous ones.
+ * Used as checksum of cached SDF files.
+ *
+ * @param filename Path to file
+ * @param seed Hash seed (default: 0)
+ * @return 64-bit hash value, or 0 if file cannot be opened
+ */
+uint64_t xxhash64_file(const char* filename, uint64_t seed = 0);
+
 /**
  * @brief Compute cache key for SDF generation parameters
  *
@@ -3,6 +3,7 @@
 #include "sdfgen_unified.h"
 #include "sdf_io.h"
 #include "vec.h"
+#include "utilities.hpp" // float_to_half()
 #include <iostream>
 #include <filesystem>
 #include <sstream>
@@ -11,19 +12,98 @@
 #include <vector>
 #include <limits>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <fcntl.h>
+#include <sys/locking.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
 
 namespace fs = std::filesystem;
 
 // Note: SDF Cache is now dimension-driven instead of VRAM-driven
 // The caller (GeometrySetup) calculates target dimensions and passes them directly
 
-// Helper function to format hash as 8-character hex string
-static std::string format_hash(uint64_t hash) {
-    std::ostringstream oss;
-    oss << std::hex << std::setw(8) << std::setfill('0') << (hash & 0xFFFFFFFF);
-    return oss.str();
+// Current time in seconds since epoch, for LRU bookkeeping in the index
+static int64_t now_seconds() {
+    return (int64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
+// Process id, to give temporary files of concurrent processes distinct names
+static int process_id() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return (int)getpid();
+#endif
+}
+
+// Cross-process lock on a lock file, held as an OS file lock (flock() on POSIX, _locking() on Windows) while the file is open.
+// The OS releases the lock when its holder exits or crashes, so there are no stale lock files to detect and remove.
+// The holder deletes the lock file on release. On POSIX, a waiter may then still lock the deleted file,
+// so try_acquire() only succeeds if the locked file is still the one at path; on Windows, an open file cannot be deleted.
+class FileLock {
+public:
+    explicit FileLock(const fs::path& path) : path_(path) {}
+    ~FileLock() { release(); }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    bool try_acquire() {
+        if (fd_ >= 0) return true;
+#ifdef _WIN32
+        const int fd = _open(path_.string().c_str(), _O_CREAT | _O_RDWR, _S_IREAD | _S_IWRITE);
+        if (fd < 0) return false;
+        if (_locking(fd, _LK_NBLCK, 1) != 0) { // lock the first byte, which is allowed beyond the end of the empty file
+            _close(fd);
+            return false;
+        }
+#else
+        const int fd = open(path_.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return false;
+        struct stat locked, current;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0 || fstat(fd, &locked) != 0 || stat(path_.c_str(), &current) != 0 || locked.st_dev != current.st_dev || locked.st_ino != current.st_ino) {
+            close(fd); // held by another process, or the lock file was released and deleted after it was opened here
+            return false;
+        }
+#endif
+        fd_ = fd;
+        return true;
+    }
+    void acquire() { // blocking
+        while (!try_acquire()) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    void release() {
+        if (fd_ < 0) return;
+        std::error_code ec;
+#ifdef _WIN32
+        _lseek(fd_, 0, SEEK_SET);
+        _locking(fd_, _LK_UNLCK, 1);
+        _close(fd_);
+        fs::remove(path_, ec); // fails if another process has the lock file open, then that process deletes it later
+#else
+        fs::remove(path_, ec); // delete before unlocking, so no process can lock the file at path after it is released
+        close(fd_);
+#endif
+        fd_ = -1;
+    }
+
+private:
+    fs::path path_;
+    int fd_ = -1;
+};
+
 // Load binary STL file (simple format: 80-byte header + triangles)
 static bool load_binary_stl(const char* filename, std::vector<Vec3f>& vertList, std::vector<Vec3ui>& faceList,
                             Vec3f& min_box, Vec3f& max_box) {
@@ -82,6 +162,99 @@ static bool load_binary_stl(const char* filename, std::vector<Vec3f>& vertList,
     return true;
 }
 
+// Write SDF in FluidX3D's x-fastest layout ("SDFX" magic + 36-byte header + data[x + Nx*(y + Ny*z)])
+// phi_grid is already stored x-fastest, so this avoids the transpose in both write_sdf_binary() and read_sdf()
+static bool write_sdf_x_fastest(const std::string& path, const Array3f& phi_grid, const Vec3f& min_box, float dx, int* inside_count) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    const int32_t header_int[3] = { phi_grid.ni, phi_grid.nj, phi_grid.nk };
+    const float header_float[6] = { min_box[0], min_box[1], min_box[2],
+                                    min_box[0] + phi_grid.ni * dx, min_box[1] + phi_grid.nj * dx, min_box[2] + phi_grid.nk * dx };
+    file.write("SDFX", 4);
+    file.write(reinterpret_cast<const char*>(header_int), sizeof(header_int));
+    file.write(reinterpret_cast<const char*>(header_float), sizeof(header_float));
+    std::vector<float> row(phi_grid.ni);
+    int count = 0;
+    for (int k = 0; k < phi_grid.nk; ++k) {
+        for (int j = 0; j < phi_grid.nj; ++j) {
+            for (int i = 0; i < phi_grid.ni; ++i) {
+                row[i] = phi_grid(i, j, k);
+                count += row[i] < 0.0f;
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+        }
+    }
+    if (inside_count) *inside_count = count;
+    return file.good();
+}
+
+// Write narrow-band SDF ("SDFB" magic), format as documented at write_sparse_sdf() in FluidX3D's utilities.hpp:
+// header, one uint32 per 8^3 brick (dense slot, 0xFFFFFFFF outside, 0xFFFFFFFE inside), then dense brick values in cells
+static bool write_sdf_sparse(const std::string& path, const Array3f& phi_grid, const Vec3f& min_box, float dx, float band, bool fp16, int* inside_count) {
+    const uint32_t B = 8;
+    const int ni = phi_grid.ni, nj = phi_grid.nj, nk = phi_grid.nk;
+    const uint32_t bx = (ni + B - 1) / B, by = (nj + B - 1) / B, bz = (nk + B - 1) / B;
+    std::vector<uint32_t> brick_index((size_t)bx * by * bz);
+    uint32_t dense_bricks = 0;
+    int count = 0;
+    for (uint32_t b = 0; b < brick_index.size(); ++b) {
+        const int i0 = (int)(b % bx) * B, j0 = (int)((b / bx) % by) * B, k0 = (int)(b / (bx * by)) * B;
+        bool is_inside = false, is_outside = false, is_near = false;
+        for (int k = k0; k < std::min(k0 + (int)B, nk); ++k) {
+            for (int j = j0; j < std::min(j0 + (int)B, nj); ++j) {
+                for (int i = i0; i < std::min(i0 + (int)B, ni); ++i) {
+                    const float d = phi_grid(i, j, k);
+                    is_near = is_near || std::fabs(d) <= band * dx;
+                    is_inside = is_inside || d <= 0.0f;
+                    is_outside = is_outside || d > 0.0f;
+                    count += d < 0.0f;
+                }
+            }
+        }
+        brick_index[b] = (is_near || (is_inside && is_outside)) ? dense_bricks++ : is_inside ? 0xFFFFFFFEu : 0xFFFFFFFFu;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    const int32_t header_int[3] = { ni, nj, nk };
+    const float header_float[6] = { min_box[0], min_box[1], min_box[2], min_box[0] + ni * dx, min_box[1] + nj * dx, min_box[2] + nk * dx };
+    uint32_t brick_header[4] = { B, fp16 ? 1u : 0u, 0u, dense_bricks };
+    std::memcpy(&brick_header[2], &band, sizeof(float));
+    file.write("SDFB", 4);
+    file.write(reinterpret_cast<const char*>(header_int), sizeof(header_int));
+    file.write(reinterpret_cast<const char*>(header_float), sizeof(header_float));
+    file.write(reinterpret_cast<const char*>(brick_header), sizeof(brick_header));
+    file.write(reinterpret_cast<const char*>(brick_index.data()), brick_index.size() * sizeof(uint32_t));
+    std::vector<float> values(B * B * B);
+    std::vector<uint16_t> halfs(B * B * B);
+    for (uint32_t b = 0; b < brick_index.size(); ++b) {
+        if (brick_index[b] >= 0xFFFFFFFEu) continue; // dense bricks are stored in slot order, which is brick order
+        const int i0 = (int)(b % bx) * B, j0 = (int)((b / bx) % by) * B, k0 = (int)(b / (bx * by)) * B;
+        size_t n = 0;
+        for (int k = k0; k < k0 + (int)B; ++k) {
+            for (int j = j0; j < j0 + (int)B; ++j) {
+                for (int i = i0; i < i0 + (int)B; ++i) {
+                    values[n] = phi_grid(std::min(i, ni - 1), std::min(j, nj - 1), std::min(k, nk - 1)) / dx; // clamp samples beyond the grid edge
+                    halfs[n] = float_to_half(values[n]);
+                    n++;
+                }
+            }
+        }
+        if (fp16) file.write(reinterpret_cast<const char*>(halfs.data()), halfs.size() * sizeof(uint16_t));
+        else file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+    }
+    if (inside_count) *inside_count = count;
+    return file.good();
+}
+
+// Cache key including the file format, so dense and narrow-band files of the same geometry do not collide
+static uint64_t sdf_cache_key(const SDFCacheConfig& config, const std::string& stl_path, uint32_t target_nx, uint32_t target_ny, uint32_t target_nz, int32_t padding) {
+    const uint64_t key = compute_sdf_cache_key(stl_path, target_nx, target_ny, target_nz, padding);
+    if (!config.sparse) return key;
+    const float format[2] = { config.sparse_band, config.sparse_fp16 ? 1.0f : 0.0f };
+    return xxhash64(format, sizeof(format), key);
+}
+
 SDFCacheManager::SDFCacheManager(const SDFCacheConfig& config)
     : config_(config) {
     // Create cache directory if it doesn't exist
@@ -90,6 +263,15 @@ SDFCacheManager::SDFCacheManager(const SDFCacheConfig& config)
     }
 }
 
+SDFCacheManager::~SDFCacheManager() {
+    if (accessed_.empty()) return;
+    // append the pending last access times to the access log without taking the index lock, they are merged into the index with its next change
+    std::ostringstream log;
+    for (const auto& [key, last_access] : accessed_) log << key << ' ' << last_access << '\n';
+    std::ofstream file(fs::path(config_.cache_directory) / "sdf_cache.access", std::ios::app);
+    file << log.str(); // one small append, so lines of concurrent processes do not interleave
+}
+
 std::string SDFCacheManager::get_or_generate(const std::string& stl_path, uint32_t target_nx, uint32_t target_ny, uint32_t target_nz, int32_t padding) {
     // If caching disabled or force regenerate, generate directly
     if (!config_.enable_cache || config_.force_regenerate) {
@@ -100,14 +282,10 @@ std::string SDFCacheManager::get_or_generate(const std::string& stl_path, uint32
     }
 
     // Compute cache key
-    uint64_t cache_key = compute_sdf_cache_key(stl_path, target_nx, target_ny, target_nz, padding);
-
-    // Get STL basename
-    fs::path stl_file(stl_path);
-    std::string stl_basename = stl_file.stem().string();
+    uint64_t cache_key = sdf_cache_key(config_, stl_path, target_nx, target_ny, target_nz, padding);
 
     // Check for cached SDF
-    std::string cached_path = find_cached_sdf(stl_basename, cache_key, target_nx, target_ny, target_nz);
+    std::string cached_path = find_cached_sdf(cache_key, target_nx, target_ny, target_nz);
 
     if (!cached_path.empty()) {
         if (config_.verbose) {
@@ -116,7 +294,25 @@ std::string SDFCacheManager::get_or_generate(const std::string& stl_path, uint32
         return cached_path;
     }
 
-    // Cache miss - generate new SDF
+    // Cache miss - take the per-key lock, so concurrent processes wait for one generation instead of duplicating it
+    FileLock lock(fs::path(config_.cache_directory) / (index_key(cache_key, target_nx, target_ny, target_nz) + ".lock"));
+    if (!lock.try_acquire()) {
+        if (config_.verbose) {
+            std::cout << "[SDF Cache] Waiting for another process generating the same SDF..." << std::endl;
+        }
+        while (!lock.try_acquire()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    }
+    load_index(true);
+    cached_path = find_cached_sdf(cache_key, target_nx, target_ny, target_nz); // the other process may have published it meanwhile
+    if (!cached_path.empty()) {
+        if (config_.verbose) {
+            std::cout << "[SDF Cache] Cache HIT: " << cached_path << std::endl;
+        }
+        return cached_path;
+    }
+
     if (config_.verbose) {
         std::cout << "[SDF Cache] Cache MISS - generating..." << std::endl;
     }
@@ -126,24 +322,25 @@ std::string SDFCacheManager::get_or_generate(const std::string& stl_path, uint32
 
 int SDFCacheManager::clear_cache(const std::string& stl_basename) {
     int deleted_count = 0;
-
-    try {
-        for (const auto& entry : fs::directory_iterator(config_.cache_directory)) {
-            if (entry.is_regular_file()) {
-                std::string filename = entry.path().filename().string();
-                // Check if filename starts with basename
-                if (filename.find(stl_basename) == 0 && filename.substr(filename.size() - 4) == ".sdf") {
-                    fs::remove(entry.path());
-                    deleted_count++;
-                    if (config_.verbose) {
-                        std::cout << "[SDF Cache] Deleted: " << filename << std::endl;
-                    }
+    const std::string prefix = stl_basename + "_sdf_";
+
+    modify_index([&]() {
+        for (auto it = index_.begin(); it != index_.end();) {
+            if (it->second.filename.compare(0, prefix.size(), prefix) == 0) {
+                std::error_code ec;
+                fs::remove(fs::path(config_.cache_directory) / it->second.filename, ec);
+                index_size_bytes_ -= it->second.size_bytes;
+                deleted_count++;
+                if (config_.verbose) {
+                    std::cout << "[SDF Cache] Deleted: " << it->second.filename << std::endl;
                 }
+                verified_.erase(it->first);
+                it = index_.erase(it);
+            } else {
+                ++it;
             }
         }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << "[SDF Cache] ERROR clearing cache: " << e.what() << std::endl;
-    }
+    });
 
     return deleted_count;
 }
@@ -151,72 +348,245 @@ int SDFCacheManager::clear_cache(const std::string& stl_basename) {
 int SDFCacheManager::clear_all_cache() {
     int deleted_count = 0;
 
-    try {
-        for (const auto& entry : fs::directory_iterator(config_.cache_directory)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".sdf") {
-                fs::remove(entry.path());
-                deleted_count++;
-                if (config_.verbose) {
-                    std::cout << "[SDF Cache] Deleted: " << entry.path().filename().string() << std::endl;
+    modify_index([&]() {
+        try { // scan the directory here, to also remove files that are not in the index
+            for (const auto& entry : fs::directory_iterator(config_.cache_directory)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".sdf") {
+                    fs::remove(entry.path());
+                    deleted_count++;
+                    if (config_.verbose) {
+                        std::cout << "[SDF Cache] Deleted: " << entry.path().filename().string() << std::endl;
+                    }
                 }
             }
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "[SDF Cache] ERROR clearing cache: " << e.what() << std::endl;
         }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << "[SDF Cache] ERROR clearing cache: " << e.what() << std::endl;
-    }
+        index_.clear();
+        index_size_bytes_ = 0;
+        verified_.clear();
+    });
 
     return deleted_count;
 }
 
 void SDFCacheManager::get_cache_stats(int& total_files, float& total_size_mb) {
-    total_files = 0;
-    total_size_mb = 0.0f;
+    load_index();
+    total_files = (int)index_.size();
+    total_size_mb = (float)((double)index_size_bytes_ / (1024.0 * 1024.0));
+}
+
+void SDFCacheManager::set_verbose(bool verbose) {
+    config_.verbose = verbose;
+}
+
+std::string SDFCacheManager::index_key(uint64_t hash, uint32_t nx, uint32_t ny, uint32_t nz) {
+    return format_hash(hash) + "_" + std::to_string(nx) + "x" + std::to_string(ny) + "x" + std::to_string(nz);
+}
 
+void SDFCacheManager::load_index(bool force) {
+    const fs::path index_path = fs::path(config_.cache_directory) / "sdf_cache.index";
+    std::error_code ec;
+    const fs::file_time_type index_time = fs::last_write_time(index_path, ec);
+    if (index_loaded_ && !force && !ec && index_time == index_time_) return; // other processes replace the index file, so its time changes with every update
+    index_loaded_ = true;
+    index_time_ = ec ? fs::file_time_type() : index_time;
+    index_.clear();
+    index_size_bytes_ = 0;
+
+    // Index file: header line, then one line per entry: key nx ny nz size_bytes last_access checksum filename
+    // (version 1 has no checksum column)
+    std::ifstream file(index_path);
+    std::string line;
+    if (file.is_open() && std::getline(file, line) && (line == "SDF_CACHE_INDEX 1" || line == "SDF_CACHE_INDEX 2")) {
+        const bool has_checksum = line == "SDF_CACHE_INDEX 2";
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string key;
+            IndexEntry entry;
+            if (!(iss >> key >> entry.nx >> entry.ny >> entry.nz >> entry.size_bytes >> entry.last_access)) continue;
+            if (has_checksum && !(iss >> std::hex >> entry.checksum >> std::dec)) continue;
+            iss.get(); // skip separator, file names may contain spaces
+            std::getline(iss, entry.filename);
+            if (entry.filename.empty()) continue;
+            index_size_bytes_ += entry.size_bytes;
+            index_[key] = entry;
+        }
+        apply_accessed();
+        return;
+    }
+
+    // No index yet: rebuild it once from the file names {basename}_sdf_{nx}x{ny}x{nz}_{hash8}.sdf
+    const int64_t now = now_seconds();
     try {
         for (const auto& entry : fs::directory_iterator(config_.cache_directory)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".sdf") {
-                total_files++;
-                total_size_mb += static_cast<float>(fs::file_size(entry.path())) / (1024.0f * 1024.0f);
-            }
+            if (!entry.is_regular_file() || entry.path().extension() != ".sdf") continue;
+            const std::string filename = entry.path().filename().string();
+            const size_t pos = filename.rfind("_sdf_");
+            unsigned nx = 0, ny = 0, nz = 0;
+            char hash_str[9] = {};
+            if (pos == std::string::npos || std::sscanf(filename.c_str() + pos + 5, "%ux%ux%u_%8[0-9a-f]", &nx, &ny, &nz, hash_str) != 4 || nx < 2 || ny < 2 || nz < 2) continue;
+            IndexEntry index_entry;
+            index_entry.filename = filename;
+            index_entry.nx = nx; index_entry.ny = ny; index_entry.nz = nz;
+            index_entry.size_bytes = (uint64_t)entry.file_size();
+            index_entry.last_access = now;
+            // file names contain the SDF dimensions, which are the target dimensions + 2 (see generate_sdf)
+            const std::string key = std::string(hash_str) + "_" + std::to_string(nx - 2) + "x" + std::to_string(ny - 2) + "x" + std::to_string(nz - 2);
+            index_size_bytes_ += index_entry.size_bytes;
+            index_[key] = index_entry;
         }
     } catch (const fs::filesystem_error&) {
         // Directory doesn't exist or can't be read
     }
+    apply_accessed();
+    if (!index_.empty()) {
+        FileLock lock(fs::path(config_.cache_directory) / "sdf_cache.index.lock");
+        if (lock.try_acquire()) save_index(); // if another process holds the lock, it is writing an index already
+    }
 }
 
-void SDFCacheManager::set_verbose(bool verbose) {
-    config_.verbose = verbose;
+void SDFCacheManager::modify_index(const std::function<void()>& modify) {
+    std::error_code ec;
+    fs::create_directories(config_.cache_directory, ec);
+    FileLock lock(fs::path(config_.cache_directory) / "sdf_cache.index.lock");
+    lock.acquire();
+    load_index(true); // apply the change on top of the latest index, so updates of other processes are not lost
+    merge_access_log();
+    modify();
+    save_index();
+    accessed_.clear(); // pending last access times are written now
 }
 
-std::string SDFCacheManager::find_cached_sdf(const std::string& stl_basename, uint64_t expected_hash, uint32_t nx, uint32_t ny, uint32_t nz) {
-    // Look for files matching: {basename}_sdf_{nx}x{ny}x{nz}_{hash8}.sdf
-    std::string hash_str = format_hash(expected_hash);
-    std::string dim_pattern = "_sdf_" + std::to_string(nx + 2) + "x" + std::to_string(ny + 2) + "x" + std::to_string(nz + 2);
-    std::string pattern_suffix = "_" + hash_str + ".sdf";
+void SDFCacheManager::merge_access_log() {
+    const fs::path directory(config_.cache_directory);
+    const fs::path merge_path = directory / ("sdf_cache.access.merge." + std::to_string(process_id()));
+    std::error_code ec;
+    fs::rename(directory / "sdf_cache.access", merge_path, ec); // processes appending from now on start a new log
+    if (ec) return; // no access log
+    std::ifstream file(merge_path);
+    std::string key;
+    int64_t last_access = 0;
+    while (file >> key >> last_access) {
+        const auto it = index_.find(key);
+        if (it != index_.end()) it->second.last_access = std::max(it->second.last_access, last_access);
+    }
+    file.close();
+    fs::remove(merge_path, ec);
+}
 
-    try {
-        for (const auto& entry : fs::directory_iterator(config_.cache_directory)) {
-            if (entry.is_regular_file()) {
-                std::string filename = entry.path().filename().string();
-
-                // Check if filename:
-                // 1. Starts with basename
-                // 2. Contains the dimension pattern (e.g., "_sdf_479x479x85")
-                // 3. Ends with hash pattern
-                if (filename.find(stl_basename) == 0 &&
-                    filename.find(dim_pattern) != std::string::npos &&
-                    filename.size() > pattern_suffix.size() &&
-                    filename.substr(filename.size() - pattern_suffix.size()) == pattern_suffix) {
-                    return entry.path().string();
-                }
-            }
+void SDFCacheManager::apply_accessed() {
+    for (const auto& [key, last_access] : accessed_) {
+        const auto it = index_.find(key);
+        if (it != index_.end()) it->second.last_access = std::max(it->second.last_access, last_access);
+    }
+}
+
+void SDFCacheManager::save_index() {
+    const fs::path directory(config_.cache_directory);
+    const fs::path index_path = directory / "sdf_cache.index";
+    const fs::path temp_path = directory / ("sdf_cache.index.tmp." + std::to_string(process_id()));
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        file << "SDF_CACHE_INDEX 2\n";
+        for (const auto& [key, entry] : index_) {
+            file << key << ' ' << entry.nx << ' ' << entry.ny << ' ' << entry.nz << ' ' << entry.size_bytes << ' ' << entry.last_access << ' '
+                 << std::hex << std::setw(16) << std::setfill('0') << entry.checksum << std::dec << ' ' << entry.filename << '\n';
+        }
+        if (!file.good()) {
+            std::cerr << "[SDF Cache] ERROR: Failed to write cache index" << std::endl;
+            return;
         }
-    } catch (const fs::filesystem_error&) {
-        // Directory doesn't exist or can't be read
-        return "";
     }
+    fs::rename(temp_path, index_path, ec); // atomic replace, readers see either the old or the new index
+    if (ec) {
+        std::cerr << "[SDF Cache] ERROR: Failed to update cache index: " << ec.message() << std::endl;
+        fs::remove(temp_path, ec);
+        return;
+    }
+    index_time_ = fs::last_write_time(index_path, ec);
+}
 
-    return "";
+void SDFCacheManager::add_to_index(const std::string& key, const std::string& path, uint32_t nx, uint32_t ny, uint32_t nz, uint64_t checksum) {
+    IndexEntry entry;
+    entry.filename = fs::path(path).filename().string();
+    entry.nx = nx; entry.ny = ny; entry.nz = nz;
+    std::error_code ec;
+    entry.size_bytes = (uint64_t)fs::file_size(path, ec);
+    if (ec) entry.size_bytes = 0;
+    entry.last_access = now_seconds();
+    entry.checksum = checksum;
+
+    modify_index([&]() {
+        const auto it = index_.find(key);
+        if (it != index_.end()) { // same geometry and parameters were cached before, possibly under another STL name
+            index_size_bytes_ -= it->second.size_bytes;
+            if (it->second.filename != entry.filename) fs::remove(fs::path(config_.cache_directory) / it->second.filename, ec);
+        }
+        index_size_bytes_ += entry.size_bytes;
+        index_[key] = entry;
+        verified_.insert(key); // checksum was just computed from the file
+        evict_to_budget(key);
+    });
+}
+
+void SDFCacheManager::evict_to_budget(const std::string& keep_key) {
+    if (config_.max_cache_size_mb <= 0.0f) return;
+    const uint64_t budget = (uint64_t)((double)config_.max_cache_size_mb * 1024.0 * 1024.0);
+    if (index_size_bytes_ <= budget) return;
+
+    std::vector<std::pair<int64_t, std::string>> lru; // (last access, key), oldest first
+    lru.reserve(index_.size());
+    for (const auto& [key, entry] : index_) {
+        if (key != keep_key) lru.emplace_back(entry.last_access, key);
+    }
+    std::sort(lru.begin(), lru.end());
+
+    for (const auto& [last_access, key] : lru) {
+        if (index_size_bytes_ <= budget) break;
+        const IndexEntry& entry = index_[key];
+        std::error_code ec;
+        fs::remove(fs::path(config_.cache_directory) / entry.filename, ec);
+        index_size_bytes_ -= entry.size_bytes;
+        if (config_.verbose) {
+            std::cout << "[SDF Cache] Evicted: " << entry.filename << std::endl;
+        }
+        verified_.erase(key);
+        index_.erase(key);
+    }
+}
+
+std::string SDFCacheManager::find_cached_sdf(uint64_t expected_hash, uint32_t nx, uint32_t ny, uint32_t nz) {
+    load_index();
+    const std::string key = index_key(expected_hash, nx, ny, nz);
+    const auto it = index_.find(key);
+    if (it == index_.end()) return "";
+
+    const fs::path path = fs::path(config_.cache_directory) / it->second.filename;
+    const IndexEntry entry = it->second;
+    std::error_code ec;
+    const uint64_t size_bytes = (uint64_t)fs::file_size(path, ec);
+    bool valid = !ec && size_bytes == entry.size_bytes; // file deleted or truncated behind our back
+    if (valid && config_.verify_checksum && entry.checksum != 0 && verified_.count(key) == 0) {
+        valid = xxhash64_file(path.string().c_str()) == entry.checksum;
+        if (valid) verified_.insert(key);
+    }
+    if (!valid) {
+        std::cerr << "[SDF Cache] WARNING: Cached SDF " << entry.filename << " is missing or corrupt, regenerating" << std::endl;
+        modify_index([&]() {
+            const auto stale = index_.find(key);
+            if (stale == index_.end() || stale->second.filename != entry.filename || stale->second.checksum != entry.checksum) return; // replaced meanwhile
+            fs::remove(path, ec);
+            index_size_bytes_ -= stale->second.size_bytes;
+            index_.erase(stale);
+        });
+        return "";
+    }
+    // only mark the index dirty here, rewriting it on every hit would serialize lookups of all processes on the index lock
+    accessed_[key] = it->second.last_access = now_seconds();
+    return path.string();
 }
 
 std::string SDFCacheManager::generate_sdf(const std::string& stl_path, uint32_t target_nx, uint32_t target_ny, uint32_t target_nz, int32_t padding) {
@@ -277,9 +647,10 @@ std::string SDFCacheManager::generate_sdf(const std::string& stl_path, uint32_t
     sprintf(dims, "_sdf_%dx%dx%d", phi_grid.ni, phi_grid.nj, phi_grid.nk);
     std::string filename = stl_basename + std::string(dims);
 
+    uint64_t cache_key = 0;
     if (config_.enable_cache) {
         // Add hash to filename
-        uint64_t cache_key = compute_sdf_cache_key(stl_path, target_nx, target_ny, target_nz, padding);
+        cache_key = sdf_cache_key(config_, stl_path, target_nx, target_ny, target_nz, padding);
         std::string hash_str = format_hash(cache_key);
         filename += "_" + hash_str;
     }
@@ -306,22 +677,39 @@ std::string SDFCacheManager::generate_sdf(const std::string& stl_path, uint32_t
         std::cout << std::endl;
     }
 
-    // Use shared SDF file writing function
+    // Write x-fastest layout so read_sdf() can copy the data without transposing it
     int inside_count = 0;
     int total_count = phi_grid.ni * phi_grid.nj * phi_grid.nk;
 
-    if (!write_sdf_binary(output_path, phi_grid, min_box, dx, &inside_count)) {
+    // Write to a temporary file and rename it into place, so other processes never see a partially written SDF
+    const std::string temp_path = output_path + ".tmp." + std::to_string(process_id());
+    const bool written = config_.sparse ? write_sdf_sparse(temp_path, phi_grid, min_box, dx, config_.sparse_band, config_.sparse_fp16, &inside_count)
+                                        : write_sdf_x_fastest(temp_path, phi_grid, min_box, dx, &inside_count);
+    std::error_code ec;
+    if (!written) {
         std::cerr << "[SDF Cache] ERROR: Failed to write SDF file" << std::endl;
+        fs::remove(temp_path, ec);
+        return "";
+    }
+    const uint64_t checksum = config_.enable_cache ? xxhash64_file(temp_path.c_str()) : 0ull;
+    fs::rename(temp_path, output_path, ec);
+    if (ec) {
+        std::cerr << "[SDF Cache] ERROR: Failed to publish SDF file: " << ec.message() << std::endl;
+        fs::remove(temp_path, ec);
         return "";
     }
 
     if (config_.verbose) {
-        long long file_size_bytes = 36 + (long long)total_count * sizeof(float);
+        long long file_size_bytes = (long long)fs::file_size(output_path);
         float file_size_mb = file_size_bytes / (1024.0f * 1024.0f);
         std::cout << "[SDF Cache] Saved: " << output_path
                   << " (" << file_size_mb << " MB, "
                   << (100.0f * inside_count / total_count) << "% solid)" << std::endl;
     }
 
+    if (config_.enable_cache) {
+        add_to_index(index_key(cache_key, target_nx, target_ny, target_nz), output_path, (uint32_t)phi_grid.ni, (uint32_t)phi_grid.nj, (uint32_t)phi_grid.nk, checksum);
+    }
+
     return output_path;
 }
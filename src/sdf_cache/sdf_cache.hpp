@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 /**
  * @file sdf_cache.hpp
@@ -8,6 +13,7 @@
  *
  * Provides automatic caching of SDF files based on STL content and generation parameters.
  * Cache keys are computed using xxHash64 of all parameters affecting SDF output.
+ * Cached files are tracked in an index file in the cache directory, so lookups never scan the directory.
  */
 
 /**
@@ -18,6 +24,11 @@ struct SDFCacheConfig {
     bool enable_cache = true;
     bool force_regenerate = false;
     bool verbose = false;
+    bool sparse = false;        // write narrow-band "SDFB" files: dense 8^3 bricks near the surface, one sign per brick elsewhere
+    float sparse_band = 3.0f;   // narrow band half width in cells (>= sqrt(3) keeps voxelization identical to the dense SDF)
+    bool sparse_fp16 = true;    // store dense brick values as IEEE-754 half
+    float max_cache_size_mb = 0.0f; // evict least recently used SDFs beyond this size, 0 = unlimited
+    bool verify_checksum = true; // verify the file checksum once per process before returning a cached SDF
 };
 
 /**
@@ -25,6 +36,21 @@ struct SDFCacheConfig {
  *
  * Manages automatic generation and caching of SDF files.
  * Uses hash-based lookup to detect when STL or parameters change.
+ *
+ * The index file "sdf_cache.index" in the cache directory maps each cache key to its file,
+ * grid dimensions, size and last access time. It is loaded once, looked up in O(1) and
+ * rewritten atomically (temporary file + rename) when entries are inserted or evicted. Cache hits
+ * only update the last access time in memory. On destruction, the cache manager appends them to the
+ * access log "sdf_cache.access" without locking, and the log is merged into the index with its next
+ * insertion or eviction. If the index is missing, it is rebuilt once from the
+ * "{basename}_sdf_{nx}x{ny}x{nz}_{hash8}.sdf" file names.
+ *
+ * Multiple processes can share one cache directory:
+ * - SDFs are written to a temporary file and renamed into place, so no process ever reads a partial file
+ * - a per-key lock file "{key}.lock" makes other processes wait for an in-flight generation instead of duplicating it,
+ *   the locks are OS file locks, which the OS releases if their holder crashes
+ * - index changes are made under "sdf_cache.index.lock" after reloading the index, so no update is lost
+ * - the xxHash64 checksum of every SDF is stored in the index and verified before a cached file is returned
  */
 class SDFCacheManager {
 public:
@@ -33,6 +59,11 @@ public:
      */
     explicit SDFCacheManager(const SDFCacheConfig& config = {});
 
+    /**
+     * @brief Append last access times of cache hits that are not yet in the index file to the access log
+     */
+    ~SDFCacheManager();
+
     /**
      * @brief Get cached SDF or generate new one at specified resolution
      *
@@ -84,17 +115,74 @@ public:
 private:
     SDFCacheConfig config_;
 
+    struct IndexEntry {
+        std::string filename;    // file name within the cache directory
+        uint32_t nx = 0, ny = 0, nz = 0; // SDF grid dimensions
+        uint64_t size_bytes = 0;
+        int64_t last_access = 0; // seconds since epoch, for LRU eviction
+        uint64_t checksum = 0;   // xxhash64_file() of the SDF, 0 = unknown (rebuilt or version 1 index)
+    };
+    std::unordered_map<std::string, IndexEntry> index_; // key: "{hash8}_{target_nx}x{target_ny}x{target_nz}"
+    uint64_t index_size_bytes_ = 0; // total size of all indexed files
+    bool index_loaded_ = false;
+    std::filesystem::file_time_type index_time_; // modification time of the index file when it was loaded
+    std::unordered_set<std::string> verified_; // keys whose checksum was already verified by this process
+    std::unordered_map<std::string, int64_t> accessed_; // last access times of cache hits not yet written to the index file
+
+    /**
+     * @brief Index key of a cache entry
+     */
+    static std::string index_key(uint64_t hash, uint32_t nx, uint32_t ny, uint32_t nz);
+
+    /**
+     * @brief Load the index file if it changed on disk, or rebuild it from the cache directory if it does not exist
+     *
+     * @param force Reload even if the modification time is unchanged
+     */
+    void load_index(bool force = false);
+
+    /**
+     * @brief Reload, modify and save the index while holding the cross-process index lock
+     */
+    void modify_index(const std::function<void()>& modify);
+
+    /**
+     * @brief Merge the access log of all processes into the index, call while holding the index lock
+     */
+    void merge_access_log();
+
+    /**
+     * @brief Apply last access times of cache hits that are not yet written to the index file
+     */
+    void apply_accessed();
+
+    /**
+     * @brief Write the index file atomically (temporary file + rename)
+     */
+    void save_index();
+
+    /**
+     * @brief Add or replace an index entry for a file in the cache directory, then evict to the size budget
+     */
+    void add_to_index(const std::string& key, const std::string& path, uint32_t nx, uint32_t ny, uint32_t nz, uint64_t checksum);
+
+    /**
+     * @brief Delete least recently used SDFs until the cache fits into max_cache_size_mb
+     *
+     * @param keep_key Entry that must not be evicted (the one just added or accessed)
+     */
+    void evict_to_budget(const std::string& keep_key);
+
     /**
-     * @brief Find cached SDF file matching the expected hash and dimensions
+     * @brief Find cached SDF file matching the expected hash and dimensions (index lookup, updates last access time in memory only)
      *
-     * @param stl_basename Basename of STL (e.g., "hill")
      * @param expected_hash Expected 64-bit hash (will be formatted as 8 hex chars)
      * @param nx Target dimension X
      * @param ny Target dimension Y
      * @param nz Target dimension Z
      * @return Path to cached SDF, or empty string if not found
      */
-    std::string find_cached_sdf(const std::string& stl_basename, uint64_t expected_hash, uint32_t nx, uint32_t ny, uint32_t nz);
+    std::string find_cached_sdf(uint64_t expected_hash, uint32_t nx, uint32_t ny, uint32_t nz);
 
     /**
      * @brief Generate SDF at specified resolution
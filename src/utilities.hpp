@@ -4188,6 +4188,25 @@ inline void set_environment_variable(char* s) { // usage: set_environment_variab
 #ifndef UTILITIES_NO_CPP17
 #include <filesystem> // needed for get_resource_path and other file functions
 #endif // UTILITIES_NO_CPP17
+#include <cstring> // for memcpy() of unaligned file data
+#include <unordered_map> // for index_mesh() and read_sdf_cached()
+#include <memory> // for read_sdf_cached()
+#include <mutex> // for read_sdf_cached()
+#include <atomic> // for write_png()
+#if defined(_WIN32)
+#ifndef UTILITIES_CONSOLE_COLOR
+#define WIN32_LEAN_AND_MEAN
+#define VC_EXTRALEAN
+#include <Windows.h> // for memory-mapped files
+#undef min
+#undef max
+#endif // UTILITIES_CONSOLE_COLOR
+#elif defined(__linux__)||defined(__APPLE__)
+#include <sys/mman.h> // for memory-mapped files
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // Windows/Linux
 inline string get_resource_path(const string& relative_path) {
 #ifndef UTILITIES_NO_CPP17
 	// Location 1: CMake compile-time path (development builds with CLion, etc.)
@@ -4276,6 +4295,120 @@ template<typename T, typename U> inline void write_file(const string& filename,
 	for(uint i=0u; i<n; i++) s += to_string(x[i])+"\t"+to_string(y[i])+"\n";
 	write_file(filename, s);
 }
+struct Domain_Stitching { // maps global cell indices of a lattice that is split into Dx*Dy*Dz domains (with one halo layer in each split direction) to indices in the domain buffers, used by LBM::Memory_Container
+	uint Nx=1u, Ny=1u, Nz=1u, Dx=1u, Dy=1u, Dz=1u, D=1u; // global lattice dimensions, lattice domains, number of domains
+	uint NxDx=1u, NyDy=1u, NzDz=1u, Hx=0u, Hy=0u, Hz=0u; // shortcuts for N_/D_, halo offsets
+	ulong N=1ull, NxNy=1ull, local_Nx=1ull, local_Ny=1ull, local_Nz=1ull, local_N=1ull; // global number of cells, shortcut for Nx*Ny, size of each domain, number of cells in each domain
+	inline Domain_Stitching() {} // default constructor
+	inline Domain_Stitching(const uint Nx, const uint Ny, const uint Nz, const uint Dx, const uint Dy, const uint Dz) { // these variables are frequently used in index(), so pre-compute them only once here
+		this->Nx = Nx; this->Ny = Ny; this->Nz = Nz;
+		this->Dx = Dx; this->Dy = Dy; this->Dz = Dz;
+		D = Dx*Dy*Dz; // number of domains
+		N = (ulong)Nx*(ulong)Ny*(ulong)Nz;
+		NxNy = (ulong)Nx*(ulong)Ny; // shortcut for Nx*Ny
+		NxDx=Nx/Dx; NyDy=Ny/Dy; NzDz=Nz/Dz; // shortcuts for N_/D_
+		Hx=Dx>1u; Hy=Dy>1u; Hz=Dz>1u; // halo offsets
+		local_Nx=(ulong)(NxDx+2u*Hx); local_Ny=(ulong)(NyDy+2u*Hy); local_Nz=(ulong)(NzDz+2u*Hz); // size of each domain
+		local_N = local_Nx*local_Ny*local_Nz; // number of cells in each domain
+	}
+	inline ulong index(const ulong i, const uint dimension, uint& domain) const { // returns index of global array-of-structures index i (and vector dimension) in the buffer of domain
+		if(D==1u) { // take shortcut for single domain
+			domain = 0u;
+			return i+(ulong)dimension*N; // array of structures
+		} else { // decompose index for multiple domains
+			const ulong global_i=i%N, t=global_i%NxNy;
+			const uint x=(uint)(t%(ulong)Nx), y=(uint)(t/(ulong)Nx), z=(uint)(global_i/NxNy); // n = x+(y+z*Ny)*Nx
+			const uint px=x%NxDx, py=y%NyDy, pz=z%NzDz, dx=x/NxDx, dy=y/NyDy, dz=z/NzDz; // 3D position within domain and which domain
+			domain = dx+(dy+dz*Dy)*Dx;
+			const ulong local_i = (ulong)(px+Hx)+((ulong)(py+Hy)+(ulong)(pz+Hz)*local_Ny)*local_Nx; // add halo offsets
+			const ulong local_dimension = max(i/N, (ulong)dimension);
+			return local_i+local_dimension*local_N; // array of structures
+		}
+	}
+};
+template<typename T, typename F> inline void write_vtk_data(std::ofstream& file, const ulong N, const uint dimensions, F value) { // write N cells with dimensions components each as big-endian binary .vtk data, value(n, d) returns component d of cell n
+	const uint chunk_size_MB = 4u*thread::hardware_concurrency(); // in MB; convert and write data in chunks, to reduce memory footprint and time for large memory allocation
+	const ulong chunk_elements = (1048576ull*(ulong)chunk_size_MB)/((ulong)dimensions*sizeof(T));
+	const ulong chunks=N/chunk_elements, chunk_remainder=N%chunk_elements;
+	T* data = new T[chunk_elements*(ulong)dimensions];
+	for(ulong c=0u; c<chunks+1ull; c++) { // iterate over all full chunks + last chunk_remainder chunk
+		const ulong chunk_N = c<chunks ? chunk_elements : chunk_remainder;
+		if(chunk_N==0ull) break; // chunk_remainder may be 0, then skip last iteration
+		parallel_for(chunk_N, [&](ulong i) {
+			for(uint d=0u; d<dimensions; d++) { // LittleEndian to BigEndian, AoS to SoA
+				data[i*(ulong)dimensions+(ulong)d] = reverse_bytes((T)value(c*chunk_elements+i, d));
+			}
+		});
+		file.write((char*)data, chunk_N*(ulong)dimensions*sizeof(T)); // write binary data
+	}
+	delete[] data;
+}
+class Mapped_File { // read-only memory-mapped file, falls back to reading the whole file into memory if mapping is not available
+private:
+	const uchar* file_data = nullptr;
+	ulong file_size = 0ull;
+	bool opened = false;
+	vector<uchar> buffer; // only used if mapping is not available
+#if defined(_WIN32)
+	HANDLE file_handle=INVALID_HANDLE_VALUE, mapping_handle=NULL;
+#elif defined(__linux__)||defined(__APPLE__)
+	int file_descriptor = -1;
+#endif // Windows/Linux
+public:
+	inline Mapped_File(const string& filename) {
+#if defined(_WIN32)
+		file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		LARGE_INTEGER size;
+		if(file_handle!=INVALID_HANDLE_VALUE&&GetFileSizeEx(file_handle, &size)) {
+			opened = true;
+			file_size = (ulong)size.QuadPart;
+			if(file_size>0ull) mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if(mapping_handle!=NULL) file_data = (const uchar*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+		}
+#elif defined(__linux__)||defined(__APPLE__)
+		file_descriptor = open(filename.c_str(), O_RDONLY);
+		struct stat file_stat;
+		if(file_descriptor!=-1&&fstat(file_descriptor, &file_stat)==0) {
+			opened = true;
+			file_size = (ulong)file_stat.st_size;
+			if(file_size>0ull) {
+				void* mapping = mmap(nullptr, (size_t)file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+				if(mapping!=MAP_FAILED) {
+					file_data = (const uchar*)mapping;
+					madvise(mapping, (size_t)file_size, MADV_WILLNEED); // file is read by all threads at once, so prefetch aggressively
+				}
+			}
+		}
+#endif // Windows/Linux
+		if(file_data==nullptr&&(!opened||file_size>0ull)) { // mapping failed or is not available on this platform
+			std::ifstream file(filename, std::ios::in|std::ios::binary);
+			if(file.fail()) return;
+			opened = true;
+			file.seekg(0, std::ios::end);
+			file_size = (ulong)file.tellg();
+			file.seekg(0, std::ios::beg);
+			buffer.resize(file_size);
+			file.read((char*)buffer.data(), (std::streamsize)file_size);
+			file.close();
+			file_data = buffer.data();
+		}
+	}
+	inline ~Mapped_File() {
+#if defined(_WIN32)
+		if(file_data!=nullptr&&buffer.empty()) UnmapViewOfFile(file_data);
+		if(mapping_handle!=NULL) CloseHandle(mapping_handle);
+		if(file_handle!=INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+#elif defined(__linux__)||defined(__APPLE__)
+		if(file_data!=nullptr&&buffer.empty()) munmap((void*)file_data, (size_t)file_size);
+		if(file_descriptor!=-1) close(file_descriptor);
+#endif // Windows/Linux
+	}
+	Mapped_File(const Mapped_File&) = delete;
+	Mapped_File& operator=(const Mapped_File&) = delete;
+	inline bool is_open() const { return opened; }
+	inline const uchar* data() const { return file_data; }
+	inline ulong size() const { return file_size; } // in Byte, 64-bit for files larger than 4GB
+};
 #pragma warning(disable:6385)
 inline Image* read_bmp(const string& filename, Image* image=nullptr) {
 	std::ifstream file(create_file_extension(filename, ".bmp"), std::ios::in|std::ios::binary);
@@ -4333,120 +4466,159 @@ inline void write_bmp(const string& filename, const Image* image) {
 	file.close();
 	delete[] data;
 }
-inline Image* read_qoi(const string& filename, Image* image=nullptr) { // 4-channel .qoi decoder, source: https://qoiformat.org/qoi-specification.pdf
-	std::ifstream file(create_file_extension(filename, ".qoi"), std::ios::in|std::ios::binary);
-	if(file.fail()) print_error("File \""+filename+"\" does not exist!");
-	file.seekg(0, std::ios::end);
-	const uint filesize = (uint)file.tellg();
-	file.seekg(0, std::ios::beg);
-	uchar* data = new uchar[filesize];
-	file.read((char*)data, filesize);
-	file.close();
-	if(filesize<22u||((int*)data)[0]!=1718185841) print_error("File \""+filename+"\" is corrupt!");
-	uint width=0u, height=0u;
-	for(uint i=0u; i<4u; i++) {
-		width  |= data[ 7u-i]<<(8u*i);
-		height |= data[11u-i]<<(8u*i);
-	}
-	if(image==nullptr||image->width()!=width||image->height()!=height) {
-		delete image;
-		image = new Image(width, height);
-	}
-	uint counter = 14u; // header size
-	int pixel=0xFF000000, runlength=0, lookup[64]={0};
-	for(uint i=0u; i<image->length()&&counter<filesize-8u; i++) {
-		if(runlength>0) {
-			runlength--;
-		} else {
-			const int chunk = (int)data[counter++];
-			const int tag = chunk&0b11000000;
-			if(chunk==0b11111110) { // raw rgb encoding (4 bytes)
-				const int r = (int)data[counter++];
-				const int g = (int)data[counter++];
-				const int b = (int)data[counter++];
-				pixel = color(r, g, b, 255);
-			} else if(chunk==0b11111111) { // raw rgba encoding (5 bytes)
-				const int r = (int)data[counter++];
-				const int g = (int)data[counter++];
-				const int b = (int)data[counter++];
-				const int a = (int)data[counter++];
-				pixel = color(r, g, b, a);
-			} else if(tag==0b00000000) { // lookup table encoding (1 byte)
-				pixel = lookup[chunk]; // chunk&0b00111111
-			} else if(tag==0b01000000) { // difference encoding (1 byte)
-				const int r = red  (pixel)+((chunk>>4)&3)-2;
-				const int g = green(pixel)+((chunk>>2)&3)-2;
-				const int b = blue (pixel)+( chunk    &3)-2;
-				pixel = color(r, g, b, alpha(pixel));
-			} else if(tag==0b10000000) { // luma encoding (2 bytes)
-				const int luma = (int)data[counter++];
-				const int dg=(chunk&0b00111111)-32, drdg=((luma>>4)&0xF)-8, dbdg=(luma&0xF)-8;
-				const int r = red  (pixel)+drdg+dg;
-				const int g = green(pixel)+     dg;
-				const int b = blue (pixel)+dbdg+dg;
-				pixel = color(r, g, b, alpha(pixel));
-			} else if(tag==0b11000000) { // runlength encoding (1 byte)
-				runlength = chunk&0b00111111;
-			}
-			lookup[(3*red(pixel)+5*green(pixel)+7*blue(pixel)+11*alpha(pixel))%64] = pixel;
-		}
-		image->set_color(i, pixel);
-	}
-	delete[] data;
-	return image;
+inline uint qoi_strips(const uint height) { // number of horizontal strips of a .qoi file written by write_qoi(), about 64 rows each
+	return max((height+32u)/64u, 1u);
 }
-inline void write_qoi(const string& filename, const Image* image) { // 3-channel .qoi encoder, source: https://qoiformat.org/qoi-specification.pdf
-	create_folder(filename);
-	uchar header[14] = { 'q','o','i','f', 0,0,0,0, 0,0,0,0, 3,0 }; // 3 channels for red, green, blue (no alpha)
-	const uchar padding[8] = { 0,0,0,0,0,0,0,1 };
-	for(uint i=0u; i<4u; i++) {
-		header[ 7u-i] = (char)((image->width() >>(8u*i))&255);
-		header[11u-i] = (char)((image->height()>>(8u*i))&255);
-	}
-	int current=0, previous=current, runlength=0, lookup[64]={0};
-	uchar* data = new uchar[22u+4u*image->length()];
-	uint filesize = 0u;
-	for(uint i=0u; i<14u; i++) data[filesize++] = header[i];
-	for(uint i=0u; i<image->length(); i++) {
-		current = image->color(i)&0x00FFFFFF; // ignore alpha channel
+inline ulong qoi_strip_begin(const Image* image, const uint strip, const uint strips) { // first pixel of strip, strips are whole rows
+	return ((ulong)strip*(ulong)image->height()/(ulong)strips)*(ulong)image->width();
+}
+inline ulong qoi_encode_strip(const Image* image, const ulong i0, const ulong i1, uchar* data) { // encode pixels [i0, i1) into data (at most 4 Byte per pixel), returns number of Bytes
+	int previous=-1, runlength=0, lookup[64]; // -1 never equals a pixel with cleared alpha channel, so the first pixel is encoded raw and the lookup table starts empty, no state is carried over from the previous strip
+	for(uint i=0u; i<64u; i++) lookup[i] = -1;
+	ulong size = 0ull;
+	for(ulong i=i0; i<i1; i++) {
+		const int current = image->color((uint)i)&0x00FFFFFF; // ignore alpha channel
 		if(current==previous) { // runlength encoding (1 byte)
 			runlength++;
-			if(runlength>=62||i>=image->length()-1u) {
-				data[filesize++] = (uchar)(0b11000000|(runlength-1));
+			if(runlength>=62||i>=i1-1ull) { // runs end at the strip boundary
+				data[size++] = (uchar)(0b11000000|(runlength-1));
 				runlength = 0;
 			}
 		} else {
 			if(runlength>0) { // runlength encoding (1 byte)
-				data[filesize++] = (uchar)(0b11000000|(runlength-1));
+				data[size++] = (uchar)(0b11000000|(runlength-1));
 				runlength = 0;
 			}
 			const int hash = (3*red(current)+5*green(current)+7*blue(current)+11*255)%64;
 			if(lookup[hash]==current) { // lookup table encoding (1 byte)
-				data[filesize++] = (uchar)hash; // 0b00000000|hash
+				data[size++] = (uchar)hash; // 0b00000000|hash
 			} else {
 				lookup[hash] = current;
 				const int dr=red(current)-red(previous), dg=green(current)-green(previous), db=blue(current)-blue(previous);
 				const int drdg=dr-dg, dbdg=db-dg;
-				if(dr>=-2&&dr<2 && dg>=-2&&dg<2 && db>=-2&&db<2) { // difference encoding (1 byte)
-					data[filesize++] = (uchar)(0b01000000|(dr+2)<<4|(dg+2)<<2|(db+2));
-				} else if(dg>=-32&&dg<32 && drdg>=-8&&drdg<8 && dbdg>=-8&&dbdg<8) { // luma encoding (2 bytes)
-					data[filesize++] = (uchar)(0b10000000|(dg+32));
-					data[filesize++] = (uchar)((drdg+8)<<4|(dbdg+8));
+				if(previous>=0 && dr>=-2&&dr<2 && dg>=-2&&dg<2 && db>=-2&&db<2) { // difference encoding (1 byte)
+					data[size++] = (uchar)(0b01000000|(dr+2)<<4|(dg+2)<<2|(db+2));
+				} else if(previous>=0 && dg>=-32&&dg<32 && drdg>=-8&&drdg<8 && dbdg>=-8&&dbdg<8) { // luma encoding (2 bytes)
+					data[size++] = (uchar)(0b10000000|(dg+32));
+					data[size++] = (uchar)((drdg+8)<<4|(dbdg+8));
 				} else {
-					data[filesize++] = (uchar)0b11111110; // raw rgb encoding (4 bytes)
-					data[filesize++] = (uchar)red(current);
-					data[filesize++] = (uchar)green(current);
-					data[filesize++] = (uchar)blue(current);
+					data[size++] = (uchar)0b11111110; // raw rgb encoding (4 bytes)
+					data[size++] = (uchar)red(current);
+					data[size++] = (uchar)green(current);
+					data[size++] = (uchar)blue(current);
 				}
 			}
 		}
 		previous = current;
 	}
-	for(uint i=0u; i<8u; i++) data[filesize++] = padding[i];
+	return size;
+}
+inline ulong qoi_decode_strip(const uchar* data, const ulong size, int* pixels, const ulong n) { // decode n pixels from data of size Bytes, starting with the state of an empty stream, returns number of decoded pixels
+	int pixel=0xFF000000, lookup[64]={0};
+	ulong i=0ull, counter=0ull;
+	while(i<n&&counter<size) {
+		const int chunk = (int)data[counter++];
+		const int tag = chunk&0b11000000;
+		if(chunk==0b11111110) { // raw rgb encoding (4 bytes)
+			if(counter+3ull>size) break;
+			pixel = (pixel&0xFF000000)|(int)data[counter]<<16|(int)data[counter+1ull]<<8|(int)data[counter+2ull];
+			counter += 3ull;
+		} else if(chunk==0b11111111) { // raw rgba encoding (5 bytes)
+			if(counter+4ull>size) break;
+			pixel = color((int)data[counter], (int)data[counter+1ull], (int)data[counter+2ull], (int)data[counter+3ull]);
+			counter += 4ull;
+		} else if(tag==0b00000000) { // lookup table encoding (1 byte)
+			pixel = lookup[chunk]; // chunk&0b00111111
+		} else if(tag==0b01000000) { // difference encoding (1 byte)
+			pixel = color(red(pixel)+((chunk>>4)&3)-2, green(pixel)+((chunk>>2)&3)-2, blue(pixel)+(chunk&3)-2, alpha(pixel));
+		} else if(tag==0b10000000) { // luma encoding (2 bytes)
+			if(counter>=size) break;
+			const int luma = (int)data[counter++];
+			const int dg=(chunk&0b00111111)-32, drdg=((luma>>4)&0xF)-8, dbdg=(luma&0xF)-8;
+			pixel = color(red(pixel)+drdg+dg, green(pixel)+dg, blue(pixel)+dbdg+dg, alpha(pixel));
+		} else { // runlength encoding (1 byte)
+			const ulong runlength = min((ulong)(chunk&0b00111111), n-i-1ull); // all but the last pixel of the run, that one is written below
+			std::fill(pixels+i, pixels+i+runlength, pixel);
+			i += runlength;
+		}
+		lookup[(3*red(pixel)+5*green(pixel)+7*blue(pixel)+11*alpha(pixel))%64] = pixel;
+		pixels[i++] = pixel;
+	}
+	return i;
+}
+inline Image* read_qoi(const string& filename, Image* image=nullptr, const uint threads=(uint)thread::hardware_concurrency()) { // 4-channel .qoi decoder, source: https://qoiformat.org/qoi-specification.pdf, strips of files from write_qoi() are decoded in parallel
+	const Mapped_File file(create_file_extension(filename, ".qoi"));
+	if(!file.is_open()) print_error("File \""+filename+"\" does not exist!");
+	const uchar* data = file.data();
+	const ulong filesize = file.size();
+	if(filesize<22ull||data[0]!='q'||data[1]!='o'||data[2]!='i'||data[3]!='f') print_error("File \""+filename+"\" is corrupt!");
+	uint width=0u, height=0u;
+	for(uint i=0u; i<4u; i++) {
+		width  |= data[ 7u-i]<<(8u*i);
+		height |= data[11u-i]<<(8u*i);
+	}
+	if(image==nullptr||image->width()!=width||image->height()!=height) {
+		delete image;
+		image = new Image(width, height);
+	}
+	vector<ulong> offsets = { 14ull, filesize-8ull }; // without strip table, decode the whole file as one strip
+	if(filesize>=30ull&&data[filesize-4ull]=='q'&&data[filesize-3ull]=='o'&&data[filesize-2ull]=='i'&&data[filesize-1ull]=='s') { // strip table written by write_qoi()
+		uint strips = 0u;
+		for(uint i=0u; i<4u; i++) strips |= (uint)data[filesize-5ull-i]<<(8u*i);
+		const ulong table = filesize-8ull-4ull*(ulong)strips; // strip offsets, after end marker
+		if(strips>0u&&strips<=height&&4ull*(ulong)strips+30ull<=filesize) {
+			offsets.resize(strips+1u);
+			for(uint s=0u; s<strips; s++) {
+				uint offset = 0u;
+				for(uint i=0u; i<4u; i++) offset |= (uint)data[table+4ull*(ulong)s+3ull-i]<<(8u*i);
+				offsets[s] = (ulong)offset;
+			}
+			offsets[strips] = table-8ull;
+			for(uint s=0u; s<strips; s++) if(offsets[s]<14ull||offsets[s]>offsets[s+1u]) print_error("File \""+filename+"\" is corrupt!");
+		}
+	}
+	const uint strips = (uint)offsets.size()-1u;
+	vector<ulong> missing(strips); // pixels that could not be decoded in each strip
+	parallel_for(strips, min(max(threads, 1u), strips), [&](uint s) {
+		const ulong i0=qoi_strip_begin(image, s, strips), i1=qoi_strip_begin(image, s+1u, strips);
+		missing[s] = (i1-i0)-qoi_decode_strip(data+offsets[s], offsets[s+1u]-offsets[s], image->data()+i0, i1-i0);
+	});
+	for(uint s=0u; s<strips; s++) if(missing[s]>0ull) print_error("File \""+filename+"\" is corrupt!");
+	return image;
+}
+inline void write_qoi(const string& filename, const Image* image, const uint threads=(uint)thread::hardware_concurrency()) { // 3-channel .qoi encoder, source: https://qoiformat.org/qoi-specification.pdf
+	// horizontal strips are encoded in parallel, each starting with a raw pixel and an empty lookup table, so the file is a valid .qoi stream for any decoder
+	// strip offsets are appended after the end marker (big-endian uint offsets, uint strip number, "qois"), where other decoders ignore them, so read_qoi() can decode the strips in parallel too
+	create_folder(filename);
+	uchar header[14] = { 'q','o','i','f', 0,0,0,0, 0,0,0,0, 3,0 }; // 3 channels for red, green, blue (no alpha)
+	const uchar padding[8] = { 0,0,0,0,0,0,0,1 };
+	for(uint i=0u; i<4u; i++) {
+		header[ 7u-i] = (char)((image->width() >>(8u*i))&255);
+		header[11u-i] = (char)((image->height()>>(8u*i))&255);
+	}
+	const uint strips = qoi_strips(image->height());
+	thread_local vector<uchar> data; // worst case 4 Bytes per pixel, kept for the next frame encoded on this thread
+	if(data.size()<4ull*(ulong)image->length()) data.resize(4ull*(ulong)image->length());
+	uchar* buffer = data.data(); // data itself refers to another instance on the worker threads
+	vector<ulong> sizes(strips);
+	parallel_for(strips, min(max(threads, 1u), strips), [&](uint s) { // strip s is encoded into buffer at 4*(first pixel of strip)
+		const ulong i0=qoi_strip_begin(image, s, strips), i1=qoi_strip_begin(image, s+1u, strips);
+		sizes[s] = qoi_encode_strip(image, i0, i1, buffer+4ull*i0);
+	});
+	vector<uchar> table(4ull*(ulong)strips+8ull); // strip offsets, strip number, "qois"
+	ulong offset = 14ull;
+	for(uint s=0u; s<=strips; s++) {
+		const uint value = s<strips ? (uint)offset : strips;
+		for(uint i=0u; i<4u; i++) table[4u*s+3u-i] = (uchar)((value>>(8u*i))&255);
+		if(s<strips) offset += sizes[s];
+	}
+	table[4u*strips+4u]='q'; table[4u*strips+5u]='o'; table[4u*strips+6u]='i'; table[4u*strips+7u]='s';
 	std::ofstream file(create_file_extension(filename, ".qoi"), std::ios::out|std::ios::binary);
-	file.write((char*)data, filesize);
+	file.write((char*)header, 14);
+	for(uint s=0u; s<strips; s++) file.write((char*)buffer+4ull*qoi_strip_begin(image, s, strips), (std::streamsize)sizes[s]);
+	file.write((char*)padding, 8);
+	if(strips>1u) file.write((char*)table.data(), (std::streamsize)table.size()); // a single strip is a plain .qoi file
 	file.close();
-	delete[] data;
 }
 #ifdef UTILITIES_PNG
 #include "lodepng.h"
@@ -4463,76 +4635,499 @@ inline Image* read_png(const string& filename, Image* image=nullptr) {
 	}
 	return image;
 }
-inline void write_png(const string& filename, const Image* image) {
+inline uint png_crc32(const uchar* data, const ulong length, uint crc=0u) { // CRC-32 of PNG chunks (slicing-by-8), can be continued by passing the previous crc
+	static const vector<uint> table = []() {
+		vector<uint> t(8u*256u);
+		for(uint n=0u; n<256u; n++) {
+			uint c = n;
+			for(uint k=0u; k<8u; k++) c = c&1u ? 0xEDB88320u^(c>>1) : c>>1;
+			t[n] = c;
+		}
+		for(uint n=0u; n<256u; n++) for(uint k=1u; k<8u; k++) t[256u*k+n] = t[t[256u*(k-1u)+n]&255u]^(t[256u*(k-1u)+n]>>8);
+		return t;
+	}();
+	const uint* t = table.data();
+	crc = ~crc;
+	ulong i = 0ull;
+	for(; i+8ull<=length; i+=8ull) {
+		const uint lo = crc^((uint)data[i]|(uint)data[i+1ull]<<8|(uint)data[i+2ull]<<16|(uint)data[i+3ull]<<24);
+		const uint hi = (uint)data[i+4ull]|(uint)data[i+5ull]<<8|(uint)data[i+6ull]<<16|(uint)data[i+7ull]<<24;
+		crc = t[7u*256u+(lo&255u)]^t[6u*256u+((lo>>8)&255u)]^t[5u*256u+((lo>>16)&255u)]^t[4u*256u+(lo>>24)]^t[3u*256u+(hi&255u)]^t[2u*256u+((hi>>8)&255u)]^t[256u+((hi>>16)&255u)]^t[hi>>24];
+	}
+	for(; i<length; i++) crc = t[(crc^data[i])&255u]^(crc>>8);
+	return ~crc;
+}
+inline uint png_adler32(const uchar* data, const ulong length) { // Adler-32 of zlib stream
+	uint a=1u, b=0u;
+	for(ulong i=0ull; i<length;) {
+		const ulong n = min(length-i, 5552ull); // largest n for which b does not overflow before the modulo
+		for(ulong j=0ull; j<n; j++) {
+			a += data[i+j];
+			b += a;
+		}
+		a %= 65521u;
+		b %= 65521u;
+		i += n;
+	}
+	return b<<16|a;
+}
+inline uint png_adler32_combine(const uint adler1, const uint adler2, const ulong length2) { // Adler-32 of concatenated data from Adler-32 of both parts, same as adler32_combine() in zlib
+	const uint base = 65521u;
+	const uint rem = (uint)(length2%(ulong)base);
+	uint sum1 = adler1&0xFFFFu;
+	uint sum2 = (uint)(((ulong)rem*(ulong)sum1)%(ulong)base);
+	sum1 += (adler2&0xFFFFu)+base-1u;
+	sum2 += (adler1>>16)+(adler2>>16)+base-rem;
+	if(sum1>=base) sum1 -= base;
+	if(sum1>=base) sum1 -= base;
+	if(sum2>=2u*base) sum2 -= 2u*base;
+	if(sum2>=base) sum2 -= base;
+	return sum2<<16|sum1;
+}
+inline void png_huffman_lengths(const uint* frequency, const uint n, const uint max_length, uchar* lengths) { // length-limited Huffman code lengths, always a complete code with at least 2 symbols as zlib requires
+	vector<uint> f(frequency, frequency+n);
+	uint used = 0u;
+	for(uint i=0u; i<n; i++) used += f[i]>0u;
+	for(uint i=0u; i<n&&used<2u; i++) if(f[i]==0u) { f[i] = 1u; used++; }
+	vector<uint> symbols;
+	for(uint i=0u; i<n; i++) if(f[i]>0u) symbols.push_back(i);
+	std::stable_sort(symbols.begin(), symbols.end(), [&](const uint a, const uint b) { return f[a]<f[b]; });
+	const uint m = (uint)symbols.size();
+	vector<ulong> weight(2u*m-1u); // Huffman tree with two queues: sorted leaves 0..m-1, then internal nodes in the order they are created
+	vector<uint> parent(2u*m-1u), depth(2u*m-1u, 0u);
+	for(uint i=0u; i<m; i++) weight[i] = (ulong)f[symbols[i]];
+	uint leaf=0u, next=m;
+	for(uint k=m; k<2u*m-1u; k++) {
+		uint child[2];
+		for(uint c=0u; c<2u; c++) child[c] = leaf<m&&(next>=k||weight[leaf]<=weight[next]) ? leaf++ : next++;
+		weight[k] = weight[child[0]]+weight[child[1]];
+		parent[child[0]] = parent[child[1]] = k;
+	}
+	for(int k=(int)(2u*m)-3; k>=0; k--) depth[k] = depth[parent[k]]+1u;
+	const uint limit = 1u<<max_length;
+	uint kraft = 0u;
+	vector<uint> length(m);
+	for(uint i=0u; i<m; i++) {
+		length[i] = min(depth[i], max_length);
+		kraft += 1u<<(max_length-length[i]);
+	}
+	while(kraft>limit) { // clamping made the code over-subscribed, lengthen the least frequent codes that are still shorter than max_length
+		for(uint i=0u; i<m; i++) if(length[i]<max_length) { kraft -= 1u<<(max_length-length[i]-1u); length[i]++; break; }
+	}
+	while(kraft<limit) { // fill up an incomplete code by shortening the most frequent codes
+		for(int i=(int)m-1; i>=0; i--) if(length[i]>1u&&kraft+(1u<<(max_length-length[i]))<=limit) { kraft += 1u<<(max_length-length[i]); length[i]--; break; }
+	}
+	for(uint i=0u; i<n; i++) lengths[i] = 0u;
+	for(uint i=0u; i<m; i++) lengths[symbols[i]] = (uchar)length[i];
+}
+inline void png_huffman_codes(const uchar* lengths, const uint n, uint* codes) { // canonical Huffman codes from code lengths, bit-reversed because deflate writes codes LSB first
+	uint count[16]={0u}, next[16]={0u};
+	for(uint i=0u; i<n; i++) count[lengths[i]]++;
+	count[0] = 0u;
+	for(uint bits=1u, code=0u; bits<16u; bits++) next[bits] = code = (code+count[bits-1u])<<1;
+	for(uint i=0u; i<n; i++) {
+		const uint l = lengths[i];
+		if(l==0u) continue;
+		const uint code = next[l]++;
+		uint r = 0u;
+		for(uint b=0u; b<l; b++) r |= ((code>>b)&1u)<<(l-1u-b);
+		codes[i] = r;
+	}
+}
+struct Png_Bit_Writer { // deflate bit stream, LSB first
+	vector<uchar>& data;
+	ulong buffer = 0ull;
+	uint bits = 0u;
+	Png_Bit_Writer(vector<uchar>& data) : data(data) {}
+	inline void write(const uint value, const uint n) {
+		buffer |= (ulong)value<<bits;
+		bits += n;
+		while(bits>=8u) {
+			data.push_back((uchar)buffer);
+			buffer >>= 8;
+			bits -= 8u;
+		}
+	}
+	inline void align() { // pad to byte boundary
+		if(bits>0u) write(0u, 8u-bits);
+	}
+};
+inline void png_deflate_strip(const uchar* data, const uint length, const uint level, const bool last, vector<uchar>& compressed) { // compress one strip independently, ends byte-aligned so compressed strips can be concatenated
+	Png_Bit_Writer bits(compressed);
+	compressed.reserve(level==0u ? (ulong)length+5ull*((ulong)length/65535ull+2ull) : (ulong)length/4ull);
+	if(level==0u) { // stored blocks
+		for(uint i=0u; i<length; i+=65535u) {
+			const uint n = min(length-i, 65535u);
+			bits.write(last&&i+n==length, 1u);
+			bits.write(0u, 2u);
+			bits.align();
+			bits.write(n, 16u);
+			bits.write(~n&0xFFFFu, 16u);
+			compressed.insert(compressed.end(), data+i, data+i+n);
+		}
+		if(!last) { // empty stored block aligns to a byte boundary (sync flush)
+			bits.write(0u, 3u);
+			bits.align();
+			bits.write(0x0000u, 16u);
+			bits.write(0xFFFFu, 16u);
+		}
+		return;
+	}
+	const uint length_base[29] = { 3u, 4u, 5u, 6u, 7u, 8u, 9u, 10u, 11u, 13u, 15u, 17u, 19u, 23u, 27u, 31u, 35u, 43u, 51u, 59u, 67u, 83u, 99u, 115u, 131u, 163u, 195u, 227u, 258u };
+	const uint length_extra[29] = { 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 1u, 1u, 1u, 1u, 2u, 2u, 2u, 2u, 3u, 3u, 3u, 3u, 4u, 4u, 4u, 4u, 5u, 5u, 5u, 5u, 0u };
+	const uint distance_base[30] = { 1u, 2u, 3u, 4u, 5u, 7u, 9u, 13u, 17u, 25u, 33u, 49u, 65u, 97u, 129u, 193u, 257u, 385u, 513u, 769u, 1025u, 1537u, 2049u, 3073u, 4097u, 6145u, 8193u, 12289u, 16385u, 24577u };
+	const uint distance_extra[30] = { 0u, 0u, 0u, 0u, 1u, 1u, 2u, 2u, 3u, 3u, 4u, 4u, 5u, 5u, 6u, 6u, 7u, 7u, 8u, 8u, 9u, 9u, 10u, 10u, 11u, 11u, 12u, 12u, 13u, 13u };
+	static const vector<uchar> length_code = [&]() { // match length 0..258 -> length code 0..28
+		vector<uchar> t(259u, 0u);
+		for(uint c=0u; c<29u; c++) for(uint l=length_base[c]; l<(c<28u ? length_base[c+1u] : 259u); l++) t[l] = (uchar)c;
+		t[258] = 28u;
+		return t;
+	}();
+	static const vector<uchar> distance_code = [&]() { // match distance 1..32768 -> distance code 0..29
+		vector<uchar> t(32769u, 0u);
+		for(uint c=0u; c<30u; c++) for(uint d=distance_base[c]; d<(c<29u ? distance_base[c+1u] : 32769u); d++) t[d] = (uchar)c;
+		return t;
+	}();
+	const uint window=32768u, hash_bits=15u, block_tokens=32768u;
+	const uint max_chain = level==1u ? 1u : 16u; // number of earlier positions to test per match search
+	const uint nice_length = level==1u ? 32u : 258u; // stop searching once a match is this long
+	vector<int> head(1u<<hash_bits, -1), previous(window, -1); // hash chains of earlier positions
+	vector<uint> tokens; // literal (0..255) or 1<<31|length<<16|distance
+	tokens.reserve(block_tokens);
+	const auto hash = [&](const uint i) { return ((uint)data[i]<<16|(uint)data[i+1u]<<8|(uint)data[i+2u])*2654435761u>>(32u-hash_bits); };
+	const auto insert = [&](const uint i) {
+		const uint h = hash(i);
+		previous[i%window] = head[h];
+		head[h] = (int)i;
+	};
+	const auto write_block = [&](const bool final) { // block with dynamic Huffman codes
+		uint literal_frequency[286]={0u}, distance_frequency[30]={0u};
+		for(const uint token : tokens) {
+			if(token>>31) {
+				literal_frequency[257u+length_code[(token>>16)&0x1FFu]]++;
+				distance_frequency[distance_code[token&0xFFFFu]]++;
+			} else {
+				literal_frequency[token]++;
+			}
+		}
+		literal_frequency[256] = 1u; // end of block
+		uchar literal_lengths[286], distance_lengths[30], code_lengths[19];
+		uint literal_codes[286]={0u}, distance_codes[30]={0u}, code_codes[19]={0u};
+		png_huffman_lengths(literal_frequency, 286u, 15u, literal_lengths);
+		png_huffman_lengths(distance_frequency, 30u, 15u, distance_lengths);
+		png_huffman_codes(literal_lengths, 286u, literal_codes);
+		png_huffman_codes(distance_lengths, 30u, distance_codes);
+		uint hlit=286u, hdist=30u;
+		while(hlit>257u&&literal_lengths[hlit-1u]==0u) hlit--;
+		while(hdist>1u&&distance_lengths[hdist-1u]==0u) hdist--;
+		vector<uchar> lengths(literal_lengths, literal_lengths+hlit);
+		lengths.insert(lengths.end(), distance_lengths, distance_lengths+hdist);
+		vector<uint> rle; // run-length encoded code lengths: symbol 0..18 | repeat count<<8
+		for(uint i=0u; i<(uint)lengths.size();) {
+			const uchar l = lengths[i];
+			uint run = 1u;
+			while(i+run<(uint)lengths.size()&&lengths[i+run]==l) run++;
+			i += run;
+			if(l==0u) {
+				while(run>=11u) { const uint r=min(run, 138u); rle.push_back(18u|(r-11u)<<8); run -= r; }
+				if(run>=3u) { rle.push_back(17u|(run-3u)<<8); run = 0u; }
+			} else {
+				rle.push_back(l);
+				run--;
+				while(run>=3u) { const uint r=min(run, 6u); rle.push_back(16u|(r-3u)<<8); run -= r; }
+			}
+			for(; run>0u; run--) rle.push_back(l);
+		}
+		uint code_frequency[19]={0u};
+		for(const uint r : rle) code_frequency[r&0xFFu]++;
+		png_huffman_lengths(code_frequency, 19u, 7u, code_lengths);
+		png_huffman_codes(code_lengths, 19u, code_codes);
+		const uint order[19] = { 16u, 17u, 18u, 0u, 8u, 7u, 9u, 6u, 10u, 5u, 11u, 4u, 12u, 3u, 13u, 2u, 14u, 1u, 15u };
+		uint hclen = 19u;
+		while(hclen>4u&&code_lengths[order[hclen-1u]]==0u) hclen--;
+		bits.write(final, 1u);
+		bits.write(2u, 2u); // dynamic Huffman codes
+		bits.write(hlit-257u, 5u);
+		bits.write(hdist-1u, 5u);
+		bits.write(hclen-4u, 4u);
+		for(uint i=0u; i<hclen; i++) bits.write(code_lengths[order[i]], 3u);
+		for(const uint r : rle) {
+			const uint symbol = r&0xFFu;
+			bits.write(code_codes[symbol], code_lengths[symbol]);
+			if(symbol==16u) bits.write(r>>8, 2u);
+			if(symbol==17u) bits.write(r>>8, 3u);
+			if(symbol==18u) bits.write(r>>8, 7u);
+		}
+		for(const uint token : tokens) {
+			if(token>>31) {
+				const uint l=(token>>16)&0x1FFu, d=token&0xFFFFu, lc=length_code[l], dc=distance_code[d];
+				bits.write(literal_codes[257u+lc], literal_lengths[257u+lc]);
+				bits.write(l-length_base[lc], length_extra[lc]);
+				bits.write(distance_codes[dc], distance_lengths[dc]);
+				bits.write(d-distance_base[dc], distance_extra[dc]);
+			} else {
+				bits.write(literal_codes[token], literal_lengths[token]);
+			}
+		}
+		bits.write(literal_codes[256], literal_lengths[256]);
+		tokens.clear();
+	};
+	for(uint i=0u; i<length;) { // greedy LZ77 with hash chains
+		uint best_length=0u, best_distance=0u;
+		if(i+3u<=length) {
+			const uint max_length = min(258u, length-i);
+			int candidate = head[hash(i)];
+			for(uint chain=0u; chain<max_chain&&candidate>=0&&i-(uint)candidate<=window; chain++) {
+				const uchar* a = data+candidate;
+				const uchar* b = data+i;
+				if(a[best_length]==b[best_length]) {
+					uint l = 0u;
+					while(l<max_length&&a[l]==b[l]) l++;
+					if(l>best_length) {
+						best_length = l;
+						best_distance = i-(uint)candidate;
+						if(l>=nice_length||l>=max_length) break;
+					}
+				}
+				candidate = previous[(uint)candidate%window];
+			}
+			insert(i);
+		}
+		if(best_length>=3u) {
+			tokens.push_back(1u<<31|best_length<<16|best_distance);
+			if(level>=2u||best_length<=8u) for(uint j=i+1u; j<i+best_length&&j+3u<=length; j++) insert(j); // skip hashing inside long matches in fast mode
+			i += best_length;
+		} else {
+			tokens.push_back(data[i]);
+			i++;
+		}
+		if(tokens.size()>=block_tokens) write_block(false);
+	}
+	if(last) {
+		write_block(true);
+		bits.align();
+	} else {
+		if(!tokens.empty()) write_block(false);
+		bits.write(0u, 3u); // empty stored block aligns to a byte boundary (sync flush)
+		bits.align();
+		bits.write(0x0000u, 16u);
+		bits.write(0xFFFFu, 16u);
+	}
+}
+inline void write_png(const string& filename, const Image* image, const uint level=2u) { // level: 0 (no compression, fastest), 1 (fast), 2 (balanced, default), 3 (smallest file size, but slow and single-threaded)
+	if(image->width()==0u||image->height()==0u) return; // PNG does not allow images without pixels, and there would be no strip to end the zlib stream
 	create_folder(filename);
-	uchar* data = new uchar[3u*image->length()];
-	for(uint i=0u; i<image->length(); i++) {
-		const int color = image->color(i);
-		data[3u*i   ] = (color>>16)&255;
-		data[3u*i+1u] = (color>> 8)&255;
-		data[3u*i+2u] =  color     &255;
-	}
-	lodepng::encode(create_file_extension(filename, ".png"), data, image->width(), image->height(), LCT_RGB);
-	delete[] data;
+	if(level>=3u) {
+		uchar* data = new uchar[3u*image->length()];
+		for(uint i=0u; i<image->length(); i++) {
+			const int color = image->color(i);
+			data[3u*i   ] = (color>>16)&255;
+			data[3u*i+1u] = (color>> 8)&255;
+			data[3u*i+2u] =  color     &255;
+		}
+		lodepng::encode(create_file_extension(filename, ".png"), data, image->width(), image->height(), LCT_RGB);
+		delete[] data;
+		return;
+	}
+	// rows are filtered in parallel, then strips of rows are deflate-compressed independently in parallel and stored as separate IDAT chunks,
+	// which together form one valid zlib stream (each strip ends byte-aligned, and the Adler-32 checksums of the strips are combined)
+	static std::atomic_uint encoders(0u); // write_png() calls running concurrently, for example in encoder threads, share the CPU cores
+	const uint threads = max((uint)thread::hardware_concurrency()/max(++encoders, 1u), 1u);
+	const uint width=image->width(), height=image->height();
+	const ulong row_bytes = 1ull+3ull*(ulong)width; // filter type + RGB
+	vector<uchar> rgb(3ull*(ulong)width*(ulong)height);
+	parallel_for(height, threads, [&](uint y) {
+		for(uint x=0u; x<width; x++) {
+			const int color = image->color(x, y);
+			uchar* pixel = rgb.data()+3ull*((ulong)y*(ulong)width+(ulong)x);
+			pixel[0] = (color>>16)&255;
+			pixel[1] = (color>> 8)&255;
+			pixel[2] =  color     &255;
+		}
+	});
+	vector<uchar> filtered((ulong)height*row_bytes);
+	parallel_for(height, threads, [&](uint y) {
+		const uchar* row = rgb.data()+3ull*(ulong)y*(ulong)width;
+		const uchar* above = y>0u ? row-3ull*(ulong)width : nullptr;
+		const uint n = 3u*width;
+		const auto predictor = [&](const uint f, const uint x) { // PNG filter types 0 (None), 1 (Sub), 2 (Up), 3 (Average), 4 (Paeth)
+			const int a=x>=3u ? row[x-3u] : 0, b=above ? above[x] : 0, c=x>=3u&&above ? above[x-3u] : 0;
+			switch(f) {
+				default: return 0;
+				case 1u: return a;
+				case 2u: return b;
+				case 3u: return (a+b)>>1;
+				case 4u: { const int p=a+b-c, pa=abs(p-a), pb=abs(p-b), pc=abs(p-c); return pa<=pb&&pa<=pc ? a : pb<=pc ? b : c; }
+			}
+		};
+		uint best = 0u;
+		if(level>0u) { // choose filter with minimum sum of absolute differences, same heuristic as lodepng, all filters in one pass
+			ulong sum[5] = { 0ull, 0ull, 0ull, 0ull, 0ull };
+			for(uint x=0u; x<n; x++) {
+				const int v=row[x], a=x>=3u ? row[x-3u] : 0, b=above ? above[x] : 0, c=x>=3u&&above ? above[x-3u] : 0;
+				const int p=a+b-c, pa=abs(p-a), pb=abs(p-b), pc=abs(p-c);
+				sum[0] += (ulong)abs((int)(signed char)v);
+				sum[1] += (ulong)abs((int)(signed char)(uchar)(v-a));
+				sum[2] += (ulong)abs((int)(signed char)(uchar)(v-b));
+				sum[3] += (ulong)abs((int)(signed char)(uchar)(v-((a+b)>>1)));
+				sum[4] += (ulong)abs((int)(signed char)(uchar)(v-(pa<=pb&&pa<=pc ? a : pb<=pc ? b : c)));
+			}
+			for(uint f=1u; f<5u; f++) if(sum[f]<sum[best]) best = f;
+		}
+		uchar* out = filtered.data()+(ulong)y*row_bytes;
+		out[0] = (uchar)best;
+		if(best==0u) std::copy(row, row+n, out+1u);
+		else for(uint x=0u; x<n; x++) out[1u+x] = (uchar)(row[x]-predictor(best, x));
+	});
+	const uint rows_per_strip = max((uint)(262144ull/row_bytes), 1u); // ~256KB per strip
+	const uint strips = (height+rows_per_strip-1u)/rows_per_strip;
+	vector<vector<uchar>> compressed(strips);
+	vector<uint> adler(strips), crc(strips);
+	std::atomic_uint next_strip(0u);
+	parallel_for(threads, threads, [&](uint t) { // strips take different time to compress, so threads fetch them one at a time
+		for(uint s=next_strip++; s<strips; s=next_strip++) {
+			const ulong begin=(ulong)s*(ulong)rows_per_strip*row_bytes, end=(ulong)min((s+1u)*rows_per_strip, height)*row_bytes;
+			png_deflate_strip(filtered.data()+begin, (uint)(end-begin), level, s==strips-1u, compressed[s]);
+			adler[s] = png_adler32(filtered.data()+begin, end-begin);
+			crc[s] = png_crc32(compressed[s].data(), (ulong)compressed[s].size(), png_crc32((const uchar*)"IDAT", 4ull));
+		}
+	});
+	encoders--;
+	uint adler_total = adler[0];
+	for(uint s=1u; s<strips; s++) adler_total = png_adler32_combine(adler_total, adler[s], (ulong)(min((s+1u)*rows_per_strip, height)-s*rows_per_strip)*row_bytes);
+	std::ofstream file(create_file_extension(filename, ".png"), std::ios::out|std::ios::binary);
+	const auto write_uint = [&](const uint x) {
+		const uchar b[4] = { (uchar)(x>>24), (uchar)(x>>16), (uchar)(x>>8), (uchar)x };
+		file.write((const char*)b, 4);
+	};
+	const auto write_chunk = [&](const char* type, const uchar* data, const uint length) {
+		write_uint(length);
+		file.write(type, 4);
+		file.write((const char*)data, length);
+		write_uint(png_crc32(data, (ulong)length, png_crc32((const uchar*)type, 4ull)));
+	};
+	const uchar signature[8] = { 137u, 80u, 78u, 71u, 13u, 10u, 26u, 10u };
+	file.write((const char*)signature, 8);
+	const uchar header[13] = { (uchar)(width>>24), (uchar)(width>>16), (uchar)(width>>8), (uchar)width, (uchar)(height>>24), (uchar)(height>>16), (uchar)(height>>8), (uchar)height, 8u, 2u, 0u, 0u, 0u }; // 8 bit RGB, no interlacing
+	write_chunk("IHDR", header, 13u);
+	const uchar zlib_header[2] = { 0x78u, 0x01u }; // deflate with 32KB window
+	write_chunk("IDAT", zlib_header, 2u);
+	for(uint s=0u; s<strips; s++) { // CRCs of strip chunks are already computed in parallel
+		write_uint((uint)compressed[s].size());
+		file.write("IDAT", 4);
+		file.write((const char*)compressed[s].data(), compressed[s].size());
+		write_uint(crc[s]);
+	}
+	const uchar zlib_footer[4] = { (uchar)(adler_total>>24), (uchar)(adler_total>>16), (uchar)(adler_total>>8), (uchar)adler_total };
+	write_chunk("IDAT", zlib_footer, 4u);
+	write_chunk("IEND", nullptr, 0u);
+	file.close();
 }
 #endif // UTILITIES_PNG
 
 struct Mesh { // triangle mesh
 	uint triangle_number = 0u;
 	float3 center, pmin, pmax;
-	float3* p0;
+	float3* p0; // p0, p1 and p2 are consecutive blocks in one packed allocation, so all vertices can be processed as one flat float array and uploaded to the device as one buffer; within each block, vertices are still stored as x, y, z float3 (array of structures)
 	float3* p1;
 	float3* p2;
+	float* packed_data_unaligned = nullptr;
 	inline Mesh(const uint triangle_number, const float3& center) {
 		this->triangle_number = triangle_number;
 		this->center = this->pmin = this->pmax = center;
-		this->p0 = new float3[triangle_number];
-		this->p1 = new float3[triangle_number];
-		this->p2 = new float3[triangle_number];
+		packed_data_unaligned = new float[packed_length()+1024ull]; // over-allocate by 4096 Byte for alignment
+		this->p0 = (float3*)((((ulong)packed_data_unaligned+4095ull)/4096ull)*4096ull); // aligned to 4096 Byte and padded to a multiple of 64 Byte, required for zero-copy device buffers (CL_MEM_USE_HOST_PTR)
+		this->p1 = p0+triangle_number;
+		this->p2 = p1+triangle_number;
 	}
 	inline ~Mesh() {
-		delete[] p0;
-		delete[] p1;
-		delete[] p2;
+		delete[] packed_data_unaligned;
+	}
+	inline ulong packed_length() const { // number of floats in packed vertex data p0|p1|p2, padded to a multiple of 64 Byte
+		return ((9ull*(ulong)triangle_number+15ull)/16ull)*16ull;
+	}
+	inline float* packed_data() const { // all vertex coordinates as one flat array of interleaved x, y, z, p0 at [0, 3*triangle_number), p1 and p2 following
+		return (float*)p0;
+	}
+	static constexpr uint parallel_triangles = (65536u+2u)/3u; // 21846 triangles, or about 65536 vertices (3 per triangle); for smaller meshes, starting the threads costs more than a vertex pass
+	inline uint vertex_threads() const { // only multithread vertex processing for large meshes
+		return triangle_number<parallel_triangles ? 1u : (uint)thread::hardware_concurrency();
+	}
+	inline void parallel_for_vertices(const std::function<void(ulong, ulong, uint)>& lambda) const { // call lambda(begin, end, t) for contiguous ranges of all 3*triangle_number vertices in parallel, on vertex_threads() threads
+		const ulong N = 3ull*(ulong)triangle_number;
+		const uint threads = vertex_threads();
+		if(threads==1u) lambda(0ull, N, 0u);
+		else parallel_for(threads, threads, [&](uint t) { lambda(N*(ulong)t/(ulong)threads, N*(ulong)(t+1u)/(ulong)threads, t); });
+	}
+	inline void set_bounds(const vector<float>& t_bounds) { // reduce per-thread bounds (6 floats per thread: min xyz, max xyz)
+		if(triangle_number==0u) return;
+		float b[6] = { max_float, max_float, max_float, -max_float, -max_float, -max_float };
+		for(uint t=0u; 6u*t<(uint)t_bounds.size(); t++) {
+			for(uint d=0u; d<3u; d++) {
+				b[d   ] = fmin(b[d   ], t_bounds[6u*t+d   ]);
+				b[d+3u] = fmax(b[d+3u], t_bounds[6u*t+d+3u]);
+			}
+		}
+		pmin = float3(b[0], b[1], b[2]);
+		pmax = float3(b[3], b[4], b[5]);
 	}
 	inline void find_bounds() {
-		pmin = pmax = p0[0];
-		for(uint i=1u; i<triangle_number; i++) {
-			const float3 p0i=p0[i], p1i=p1[i], p2i=p2[i];
-			pmin.x = fmin(fmin(fmin(p0i.x, p1i.x), p2i.x), pmin.x);
-			pmin.y = fmin(fmin(fmin(p0i.y, p1i.y), p2i.y), pmin.y);
-			pmin.z = fmin(fmin(fmin(p0i.z, p1i.z), p2i.z), pmin.z);
-			pmax.x = fmax(fmax(fmax(p0i.x, p1i.x), p2i.x), pmax.x);
-			pmax.y = fmax(fmax(fmax(p0i.y, p1i.y), p2i.y), pmax.y);
-			pmax.z = fmax(fmax(fmax(p0i.z, p1i.z), p2i.z), pmax.z);
-		}
+		vector<float> t_bounds(6u*vertex_threads());
+		const float* p = packed_data();
+		parallel_for_vertices([&](const ulong begin, const ulong end, const uint t) {
+			float b[6] = { max_float, max_float, max_float, -max_float, -max_float, -max_float };
+			for(ulong i=begin; i<end; i++) { // vectorizable inner loop over flat float array
+				for(uint d=0u; d<3u; d++) {
+					b[d   ] = fmin(b[d   ], p[3ull*i+(ulong)d]);
+					b[d+3u] = fmax(b[d+3u], p[3ull*i+(ulong)d]);
+				}
+			}
+			for(uint d=0u; d<6u; d++) t_bounds[6u*t+d] = b[d];
+		});
+		set_bounds(t_bounds);
 	}
 	inline void scale(const float scale) {
-		for(uint i=0u; i<triangle_number; i++) {
-			p0[i] = scale*(p0[i]-center)+center;
-			p1[i] = scale*(p1[i]-center)+center;
-			p2[i] = scale*(p2[i]-center)+center;
-		}
+		const float a[3] = { (1.0f-scale)*center.x, (1.0f-scale)*center.y, (1.0f-scale)*center.z }; // scale*(p-center)+center = scale*p+(1-scale)*center
+		float* p = packed_data();
+		parallel_for_vertices([&](const ulong begin, const ulong end, const uint t) {
+			for(ulong i=begin; i<end; i++) {
+				for(uint d=0u; d<3u; d++) p[3ull*i+(ulong)d] = fma(scale, p[3ull*i+(ulong)d], a[d]);
+			}
+		});
 		pmin = scale*(pmin-center)+center;
 		pmax = scale*(pmax-center)+center;
 	}
 	inline void translate(const float3& translation) {
-		for(uint i=0u; i<triangle_number; i++) {
-			p0[i] += translation;
-			p1[i] += translation;
-			p2[i] += translation;
-		}
+		const float a[3] = { translation.x, translation.y, translation.z };
+		float* p = packed_data();
+		parallel_for_vertices([&](const ulong begin, const ulong end, const uint t) {
+			for(ulong i=begin; i<end; i++) {
+				for(uint d=0u; d<3u; d++) p[3ull*i+(ulong)d] += a[d];
+			}
+		});
 		center += translation;
 		pmin += translation;
 		pmax += translation;
 	}
 	inline void rotate(const float3x3& rotation) {
-		for(uint i=0u; i<triangle_number; i++) {
-			p0[i] = rotation*(p0[i]-center)+center;
-			p1[i] = rotation*(p1[i]-center)+center;
-			p2[i] = rotation*(p2[i]-center)+center;
-		}
-		find_bounds();
+		const float3 a = center-rotation*center; // rotation*(p-center)+center = rotation*p+(center-rotation*center)
+		const float rxx=rotation.xx, rxy=rotation.xy, rxz=rotation.xz, ryx=rotation.yx, ryy=rotation.yy, ryz=rotation.yz, rzx=rotation.zx, rzy=rotation.zy, rzz=rotation.zz;
+		float* p = packed_data();
+		vector<float> t_bounds(6u*vertex_threads());
+		parallel_for_vertices([&](const ulong begin, const ulong end, const uint t) { // rotate and find new bounds in one pass
+			float b[6] = { max_float, max_float, max_float, -max_float, -max_float, -max_float };
+			for(ulong i=begin; i<end; i++) {
+				const float x=p[3ull*i], y=p[3ull*i+1ull], z=p[3ull*i+2ull];
+				const float r[3] = { rxx*x+rxy*y+rxz*z+a.x, ryx*x+ryy*y+ryz*z+a.y, rzx*x+rzy*y+rzz*z+a.z };
+				for(uint d=0u; d<3u; d++) {
+					p[3ull*i+(ulong)d] = r[d];
+					b[d   ] = fmin(b[d   ], r[d]);
+					b[d+3u] = fmax(b[d+3u], r[d]);
+				}
+			}
+			for(uint d=0u; d<6u; d++) t_bounds[6u*t+d] = b[d];
+		});
+		set_bounds(t_bounds);
 	}
 	inline void set_center(const float3& center) {
 		this->center = center;
@@ -4541,13 +5136,26 @@ struct Mesh { // triangle mesh
 		return center;
 	}
 	inline const float3 get_center_of_mass() const { // volumetric center of mass
+		const uint threads = vertex_threads();
+		vector<double> t_V(threads, 0.0);
+		vector<double3> t_com(threads, double3(0.0, 0.0, 0.0));
+		parallel_for(threads, threads, [&](uint t) { // contiguous range of triangles per thread, accumulated in registers and written to t_V[t]/t_com[t] only once, to avoid false sharing
+			double V = 0.0;
+			double3 com(0.0, 0.0, 0.0);
+			for(uint i=(uint)((ulong)triangle_number*(ulong)t/(ulong)threads); i<(uint)((ulong)triangle_number*(ulong)(t+1u)/(ulong)threads); i++) {
+				const double dV = (double)dot(p0[i], cross(p1[i], p2[i]))/6.0f;
+				V += dV;
+				const float3 avg = 0.25f*(p0[i]+p1[i]+p2[i]);
+				com += dV*double3((double)avg.x, (double)avg.y, (double)avg.z);
+			}
+			t_V[t] = V;
+			t_com[t] = com;
+		});
 		double V = 0.0;
 		double3 com(0.0, 0.0, 0.0);
-		for(uint i=0u; i<triangle_number; i++) {
-			const double dV = (double)dot(p0[i], cross(p1[i], p2[i]))/6.0f;
-			V += dV;
-			const float3 avg = 0.25f*(p0[i]+p1[i]+p2[i]);
-			com += dV*double3((double)avg.x, (double)avg.y, (double)avg.z);
+		for(uint t=0u; t<threads; t++) {
+			V += t_V[t];
+			com += t_com[t];
 		}
 		return float3((float)(com.x/V), (float)(com.y/V), (float)(com.z/V));
 	}
@@ -4567,6 +5175,66 @@ struct Mesh { // triangle mesh
 		return fmin(fmin(box_size.x/(pmax.x-pmin.x), box_size.y/(pmax.y-pmin.y)), box_size.z/(pmax.z-pmin.z));
 	}
 };
+struct Indexed_Mesh { // triangle mesh with shared vertices, 12 Bytes per vertex plus 12 Bytes per triangle, about 2x smaller than Mesh (36 Bytes per triangle) for closed surfaces with about half as many vertices as triangles
+	float3 center, pmin, pmax;
+	vector<float3> vertices;
+	vector<uint> triangles; // 3 vertex indices per triangle
+	inline uint vertex_number() const { return (uint)vertices.size(); }
+	inline uint triangle_number() const { return (uint)(triangles.size()/3ull); }
+};
+inline Indexed_Mesh* index_mesh(const Mesh* mesh) { // deduplicate bit-identical vertices of a triangle mesh in parallel
+	struct Vertex_Key {
+		uint x, y, z;
+		bool operator==(const Vertex_Key& k) const { return x==k.x&&y==k.y&&z==k.z; }
+	};
+	struct Vertex_Hash {
+		size_t operator()(const Vertex_Key& k) const { return (size_t)(((ulong)k.x*0x9E3779B97F4A7C15ull)^((ulong)k.y*0xC2B2AE3D27D4EB4Full)^((ulong)k.z*0x165667B19E3779F9ull)); }
+	};
+	const uint threads = (uint)thread::hardware_concurrency();
+	const ulong N = 3ull*(ulong)mesh->triangle_number; // number of triangle corners
+	const float3* p[3] = { mesh->p0, mesh->p1, mesh->p2 };
+	const auto key = [&](const ulong n) {
+		const float3 v = p[n%3ull][n/3ull];
+		return Vertex_Key { as_uint(v.x+0.0f), as_uint(v.y+0.0f), as_uint(v.z+0.0f) }; // +0.0f turns -0.0f into 0.0f
+	};
+	const auto partition = [&](const Vertex_Key& k) { return (uint)((Vertex_Hash()(k)>>32)%(ulong)threads); }; // each thread deduplicates one partition of vertices, use upper hash bits as hash map uses lower bits
+	vector<ulong> bucket((ulong)threads*(ulong)threads+1ull, 0ull); // corners of chunk t in partition q go to bucket q*threads+t, so every partition is one contiguous range, in the original corner order
+	parallel_for(threads, threads, [&](uint t) { // count corners per partition in contiguous chunks, so the hashing is split across threads instead of every thread hashing all corners
+		for(ulong n=N*(ulong)t/(ulong)threads; n<N*(ulong)(t+1u)/(ulong)threads; n++) bucket[(ulong)partition(key(n))*(ulong)threads+(ulong)t+1ull]++;
+	});
+	for(ulong i=1ull; i<bucket.size(); i++) bucket[i] += bucket[i-1ull]; // prefix sum over counts shifted by one, bucket[i] is now the start of bucket i
+	vector<ulong> sorted(N); // corner indices sorted by partition
+	parallel_for(threads, threads, [&](uint t) {
+		for(ulong n=N*(ulong)t/(ulong)threads; n<N*(ulong)(t+1u)/(ulong)threads; n++) sorted[bucket[(ulong)partition(key(n))*(ulong)threads+(ulong)t]++] = n;
+	}); // bucket[i] is now the end of bucket i, which is the start of bucket i+1
+	vector<uint> local_index(N); // vertex index within partition
+	vector<vector<float3>> t_vertices(threads);
+	parallel_for(threads, threads, [&](uint q) {
+		std::unordered_map<Vertex_Key, uint, Vertex_Hash> map;
+		for(ulong i=q>0u ? bucket[(ulong)q*(ulong)threads-1ull] : 0ull; i<bucket[(ulong)(q+1u)*(ulong)threads-1ull]; i++) {
+			const ulong n = sorted[i];
+			const auto r = map.emplace(key(n), (uint)t_vertices[q].size());
+			if(r.second) t_vertices[q].push_back(p[n%3ull][n/3ull]);
+			local_index[n] = r.first->second;
+		}
+	});
+	vector<ulong> offset(threads+1u, 0ull);
+	for(uint t=0u; t<threads; t++) offset[t+1u] = offset[t]+(ulong)t_vertices[t].size();
+	if(offset[threads]>(ulong)max_uint) print_error("Mesh has too many vertices for indexing.");
+	Indexed_Mesh* indexed_mesh = new Indexed_Mesh();
+	indexed_mesh->center = mesh->center;
+	indexed_mesh->pmin = mesh->pmin;
+	indexed_mesh->pmax = mesh->pmax;
+	indexed_mesh->vertices.resize(offset[threads], float3(0.0f));
+	indexed_mesh->triangles.resize(N);
+	parallel_for(threads, threads, [&](uint t) {
+		std::copy(t_vertices[t].begin(), t_vertices[t].end(), indexed_mesh->vertices.begin()+offset[t]);
+	});
+	parallel_for(N, threads, [&](ulong n) {
+		indexed_mesh->triangles[n] = (uint)offset[partition(key(n))]+local_index[n];
+	});
+	return indexed_mesh;
+}
 
 // ########################### SDF (Signed Distance Field) Support ###########################
 
@@ -4582,15 +5250,19 @@ struct SDF { // 3D signed distance field
 		this->Nz = Nz;
 		this->cell_size = cell_size;
 		this->origin = origin;
-		this->data = new float[Nx*Ny*Nz];
+		this->data = new float[size()];
 	}
 
 	inline ~SDF() {
 		if(data) delete[] data;
 	}
 
-	inline uint index(const uint x, const uint y, const uint z) const {
-		return x + Nx * (y + Ny * z);
+	inline ulong size() const {
+		return (ulong)Nx * (ulong)Ny * (ulong)Nz;
+	}
+
+	inline ulong index(const uint x, const uint y, const uint z) const {
+		return (ulong)x + (ulong)Nx * ((ulong)y + (ulong)Ny * (ulong)z);
 	}
 
 	inline float get(const uint x, const uint y, const uint z) const {
@@ -4614,12 +5286,230 @@ struct SDF { // 3D signed distance field
 	}
 };
 
+struct Sparse_SDF { // narrow-band SDF: dense bricks of brick_size^3 samples where the surface is close, only one sign per brick elsewhere
+	static constexpr uint outside = 0xFFFFFFFFu; // brick_index entry of a brick that is entirely outside and far from the surface
+	static constexpr uint inside = 0xFFFFFFFEu; // brick_index entry of a brick that is entirely inside and far from the surface
+	uint Nx = 0u, Ny = 0u, Nz = 0u; // Grid dimensions in samples
+	float cell_size = 1.0f; // Size of each cell in world units
+	float3 origin; // World-space origin (lower corner) of the SDF grid
+	uint brick_size = 8u; // samples per brick and axis
+	uint Bx = 0u, By = 0u, Bz = 0u; // number of bricks per axis
+	float band = 3.0f; // narrow band half width in cells, for band >= sqrt(3) voxelization is identical to the dense SDF
+	bool fp16 = true; // dense brick values are IEEE-754 half instead of float
+	uint dense_bricks = 0u; // number of bricks with stored values
+	vector<uint> brick_index; // per brick: index of dense brick, or outside/inside
+	vector<float> brick_data; // dense brick values in units of cell_size, x varies fastest within a brick, two half values per float if fp16
+
+	inline Sparse_SDF(const uint Nx, const uint Ny, const uint Nz, const float cell_size, const float3& origin, const uint brick_size, const float band, const bool fp16) {
+		this->Nx = Nx;
+		this->Ny = Ny;
+		this->Nz = Nz;
+		this->cell_size = cell_size;
+		this->origin = origin;
+		this->brick_size = brick_size;
+		this->Bx = (Nx+brick_size-1u)/brick_size;
+		this->By = (Ny+brick_size-1u)/brick_size;
+		this->Bz = (Nz+brick_size-1u)/brick_size;
+		this->band = band;
+		this->fp16 = fp16;
+		this->brick_index.resize(bricks());
+	}
+
+	inline ulong bricks() const {
+		return (ulong)Bx * (ulong)By * (ulong)Bz;
+	}
+
+	inline ulong brick_samples() const {
+		return (ulong)brick_size * (ulong)brick_size * (ulong)brick_size;
+	}
+
+	inline void allocate(const uint dense_bricks) { // allocate storage for dense brick values
+		this->dense_bricks = dense_bricks;
+		const ulong samples = (ulong)dense_bricks*brick_samples();
+		brick_data.resize(fp16 ? (samples+1ull)/2ull : samples);
+	}
+
+	inline float get_value(const ulong i) const { // i-th dense brick sample in units of cell_size
+		if(fp16) {
+			ushort h;
+			memcpy(&h, (const uchar*)brick_data.data()+2ull*i, sizeof(ushort));
+			return half_to_float(h);
+		} else {
+			return brick_data[i];
+		}
+	}
+
+	inline void set_value(const ulong i, const float value) { // value in units of cell_size
+		if(fp16) {
+			const ushort h = float_to_half(value);
+			memcpy((uchar*)brick_data.data()+2ull*i, &h, sizeof(ushort));
+		} else {
+			brick_data[i] = value;
+		}
+	}
+
+	inline float get(const uint x, const uint y, const uint z) const { // distance in world units, +-band*cell_size away from the surface
+		const uint b = brick_index[(ulong)(x/brick_size) + (ulong)Bx * ((ulong)(y/brick_size) + (ulong)By * (ulong)(z/brick_size))];
+		if(b==outside) return band*cell_size;
+		if(b==inside) return -band*cell_size;
+		return cell_size*get_value((ulong)b*brick_samples() + (ulong)(x%brick_size) + (ulong)brick_size * ((ulong)(y%brick_size) + (ulong)brick_size * (ulong)(z%brick_size)));
+	}
+
+	inline ulong memory_size() const { // in Bytes
+		return 4ull*bricks() + 4ull*(ulong)brick_data.size();
+	}
+
+	inline float3 get_world_size() const {
+		return float3((float)Nx * cell_size, (float)Ny * cell_size, (float)Nz * cell_size);
+	}
+
+	inline float3 get_bounding_box_size() const {
+		return get_world_size();
+	}
+
+	inline float3 get_bounding_box_center() const {
+		return origin + 0.5f * get_world_size();
+	}
+};
+
+inline Sparse_SDF* sparsify_sdf(const SDF* sdf, const float band=3.0f, const bool fp16=true, const uint brick_size=8u) { // keep dense bricks only where |distance| <= band*cell_size or the sign changes
+	Sparse_SDF* sparse = new Sparse_SDF(sdf->Nx, sdf->Ny, sdf->Nz, sdf->cell_size, sdf->origin, brick_size, band, fp16);
+	const float threshold = band*sdf->cell_size;
+	const uint B = brick_size;
+	const ulong bricks = sparse->bricks();
+	parallel_for(bricks, [&](ulong b) { // classify bricks
+		const uint x0=(uint)(b%(ulong)sparse->Bx)*B, y0=(uint)((b/(ulong)sparse->Bx)%(ulong)sparse->By)*B, z0=(uint)(b/((ulong)sparse->Bx*(ulong)sparse->By))*B;
+		bool is_inside=false, is_outside=false, is_near=false;
+		for(uint z=z0; z<min(z0+B, sdf->Nz); z++) for(uint y=y0; y<min(y0+B, sdf->Ny); y++) for(uint x=x0; x<min(x0+B, sdf->Nx); x++) {
+			const float d = sdf->get(x, y, z);
+			is_near = is_near||fabs(d)<=threshold;
+			is_inside = is_inside||d<=0.0f;
+			is_outside = is_outside||d>0.0f;
+		}
+		sparse->brick_index[b] = is_near||(is_inside&&is_outside) ? 0u : is_inside ? Sparse_SDF::inside : Sparse_SDF::outside;
+	});
+	uint dense_bricks = 0u;
+	for(ulong b=0ull; b<bricks; b++) if(sparse->brick_index[b]<Sparse_SDF::inside) sparse->brick_index[b] = dense_bricks++; // assign dense brick slots in order
+	sparse->allocate(dense_bricks);
+	const float inv_cell_size = 1.0f/sdf->cell_size;
+	parallel_for(bricks, [&](ulong b) { // fill dense bricks, samples beyond the grid edge are clamped
+		const uint slot = sparse->brick_index[b];
+		if(slot>=Sparse_SDF::inside) return;
+		const uint x0=(uint)(b%(ulong)sparse->Bx)*B, y0=(uint)((b/(ulong)sparse->Bx)%(ulong)sparse->By)*B, z0=(uint)(b/((ulong)sparse->Bx*(ulong)sparse->By))*B;
+		ulong i = (ulong)slot*sparse->brick_samples();
+		for(uint z=z0; z<z0+B; z++) for(uint y=y0; y<y0+B; y++) for(uint x=x0; x<x0+B; x++) {
+			sparse->set_value(i++, inv_cell_size*sdf->get(min(x, sdf->Nx-1u), min(y, sdf->Ny-1u), min(z, sdf->Nz-1u)));
+		}
+	});
+	return sparse;
+}
+
+inline SDF* densify_sdf(const Sparse_SDF* sparse) { // expand narrow-band SDF to a dense SDF, far samples get +-band*cell_size
+	SDF* sdf = new SDF(sparse->Nx, sparse->Ny, sparse->Nz, sparse->cell_size, sparse->origin);
+	parallel_for((ulong)sparse->Ny*(ulong)sparse->Nz, [&](ulong yz) {
+		const uint y=(uint)(yz%(ulong)sparse->Ny), z=(uint)(yz/(ulong)sparse->Ny);
+		for(uint x=0u; x<sparse->Nx; x++) sdf->set(x, y, z, sparse->get(x, y, z));
+	});
+	return sdf;
+}
+
+/**
+ * @brief Write narrow-band SDF file
+ *
+ * File format (binary, little-endian):
+ * - char[4]: "SDFB"
+ * - int32: Nx, Ny, Nz (grid dimensions)
+ * - float32: bounds_min_x, bounds_min_y, bounds_min_z, bounds_max_x, bounds_max_y, bounds_max_z (bounding box)
+ * - uint32: brick_size (samples per brick and axis)
+ * - uint32: flags (bit 0: dense brick values are IEEE-754 half)
+ * - float32: band (narrow band half width in cells)
+ * - uint32: dense_bricks (number of dense bricks)
+ * - uint32[Bx*By*Bz]: brick index, brick (bx,by,bz) at bx + Bx*(by + By*bz), 0xFFFFFFFF = outside, 0xFFFFFFFE = inside, else dense brick slot
+ * - float32/float16[dense_bricks*brick_size^3]: dense brick values in units of cell size, x varies fastest within a brick
+ */
+inline void write_sparse_sdf(const string& path, const Sparse_SDF* sparse) {
+	const string filename = create_file_extension(path, ".sdf");
+	create_folder(filename);
+	const int N[3] = { (int)sparse->Nx, (int)sparse->Ny, (int)sparse->Nz };
+	const float3 bounds_max = sparse->origin+sparse->get_world_size();
+	const float bounds[6] = { sparse->origin.x, sparse->origin.y, sparse->origin.z, bounds_max.x, bounds_max.y, bounds_max.z };
+	const uint brick_header[4] = { sparse->brick_size, sparse->fp16 ? 1u : 0u, as_uint(sparse->band), sparse->dense_bricks };
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write("SDFB", 4u);
+	file.write((const char*)N, sizeof(N));
+	file.write((const char*)bounds, sizeof(bounds));
+	file.write((const char*)brick_header, sizeof(brick_header));
+	file.write((const char*)sparse->brick_index.data(), (std::streamsize)(sparse->bricks()*sizeof(uint)));
+	file.write((const char*)sparse->brick_data.data(), (std::streamsize)((ulong)sparse->dense_bricks*sparse->brick_samples()*(sparse->fp16 ? 2ull : 4ull)));
+	file.close();
+}
+inline void write_sparse_sdf(const string& path, const SDF* sdf, const float band=3.0f, const bool fp16=true) {
+	Sparse_SDF* sparse = sparsify_sdf(sdf, band, fp16);
+	write_sparse_sdf(path, sparse);
+	delete sparse;
+}
+
+inline bool is_sparse_sdf(const string& path) { // check for "SDFB" magic of narrow-band SDF files
+	std::ifstream file(create_file_extension(path, ".sdf"), std::ios::in|std::ios::binary);
+	char magic[4] = { 0, 0, 0, 0 };
+	file.read(magic, 4);
+	return !file.fail() && memcmp(magic, "SDFB", 4u)==0;
+}
+
+inline Sparse_SDF* read_sparse_sdf(const string& path) { // read narrow-band SDF file written by write_sparse_sdf()
+	const string filename = create_file_extension(path, ".sdf");
+	const Mapped_File file(filename);
+	if(!file.is_open()) {
+		print_error("Error: SDF file \"" + filename + "\" could not be opened!");
+		return nullptr;
+	}
+	if(file.size()<56ull || memcmp(file.data(), "SDFB", 4u)!=0) {
+		print_error("Error: \"" + filename + "\" is not a narrow-band SDF file!");
+		return nullptr;
+	}
+	int N[3];
+	float bounds[6];
+	uint brick_header[4];
+	memcpy(N, file.data()+4ull, sizeof(N));
+	memcpy(bounds, file.data()+16ull, sizeof(bounds));
+	memcpy(brick_header, file.data()+40ull, sizeof(brick_header));
+	const uint brick_size = brick_header[0];
+	const bool fp16 = brick_header[1]&1u;
+	if(N[0]<=0 || N[1]<=0 || N[2]<=0 || brick_size==0u || brick_size>32u) {
+		print_error("Error: Failed to read SDF header from \"" + filename + "\"!");
+		return nullptr;
+	}
+	const float3 bounds_size = float3(bounds[3], bounds[4], bounds[5]) - float3(bounds[0], bounds[1], bounds[2]);
+	const float cell_size = (bounds_size.x/(float)N[0] + bounds_size.y/(float)N[1] + bounds_size.z/(float)N[2]) / 3.0f; // same as read_sdf()
+	Sparse_SDF* sparse = new Sparse_SDF((uint)N[0], (uint)N[1], (uint)N[2], cell_size, float3(bounds[0], bounds[1], bounds[2]), brick_size, as_float(brick_header[2]), fp16);
+	sparse->allocate(brick_header[3]);
+	const ulong index_bytes = sparse->bricks()*sizeof(uint), data_bytes = (ulong)sparse->dense_bricks*sparse->brick_samples()*(fp16 ? 2ull : 4ull);
+	if(file.size()<56ull+index_bytes+data_bytes) {
+		print_error("Error: Failed to read SDF data from \"" + filename + "\"!");
+		delete sparse;
+		return nullptr;
+	}
+	memcpy(sparse->brick_index.data(), file.data()+56ull, index_bytes);
+	memcpy(sparse->brick_data.data(), file.data()+56ull+index_bytes, data_bytes);
+	for(ulong b=0ull; b<sparse->bricks(); b++) {
+		if(sparse->brick_index[b]>=sparse->dense_bricks && sparse->brick_index[b]<Sparse_SDF::inside) {
+			print_error("Error: Invalid brick index in SDF file \"" + filename + "\"!");
+			delete sparse;
+			return nullptr;
+		}
+	}
+	print_info("Loaded narrow-band SDF: " + to_string(sparse->Nx) + "x" + to_string(sparse->Ny) + "x" + to_string(sparse->Nz) +
+	           " cells, " + to_string(sparse->dense_bricks) + "/" + to_string((uint)sparse->bricks()) + " dense bricks, " + to_string((uint)(sparse->memory_size()/1048576ull)) + " MB");
+	return sparse;
+}
+
 /**
  * @brief Read binary SDF file
  * @param path Path to binary SDF file
  * @return Pointer to SDF structure
  *
  * File format (binary, little-endian):
+ * - char[4]: "SDFX" (optional, only present in files written by write_sdf()), files starting with "SDFB" are narrow-band SDFs, see write_sparse_sdf()
  * - int32: Nx (grid dimension X)
  * - int32: Ny (grid dimension Y)
  * - int32: Nz (grid dimension Z)
@@ -4630,41 +5520,48 @@ struct SDF { // 3D signed distance field
  * - float32: bounds_max_y (bounding box maximum Y)
  * - float32: bounds_max_z (bounding box maximum Z)
  * - float32[Nx*Ny*Nz]: SDF values (negative=inside, positive=outside, zero=surface)
- *   Layout: data[x + Nx*(y + Ny*z)]
+ *   Layout without "SDFX" magic (SDFGen): file[i*Ny*Nz + j*Nz + k], z varies fastest, is transposed while reading
+ *   Layout with "SDFX" magic: file[x + Nx*(y + Ny*z)], x varies fastest, is copied as is
  */
 inline SDF* read_sdf(const string& path) {
 	const string filename = create_file_extension(path, ".sdf");
-	std::ifstream file(filename, std::ios::in | std::ios::binary);
-
+	const Mapped_File file(filename); // memory-mapped, so data is read straight from the page cache into the SDF without an intermediate copy
 	if(!file.is_open()) {
 		print_error("Error: SDF file \"" + filename + "\" could not be opened!");
 		return nullptr;
 	}
+	if(file.size()>=4ull && memcmp(file.data(), "SDFB", 4u)==0) { // narrow-band SDF, expand to dense
+		Sparse_SDF* sparse = read_sparse_sdf(path);
+		if(sparse==nullptr) {
+			print_error("Error: Failed to read narrow-band SDF from \"" + filename + "\"!");
+			return nullptr;
+		}
+		SDF* sdf = densify_sdf(sparse);
+		delete sparse;
+		return sdf;
+	}
+	const bool x_fastest = file.size()>=4ull && memcmp(file.data(), "SDFX", 4u)==0;
+	const ulong header_size = x_fastest ? 40ull : 36ull;
+	if(file.size()<header_size) {
+		print_error("Error: Failed to read SDF header from \"" + filename + "\"!");
+		return nullptr;
+	}
 
 	// Read header: grid dimensions + bounding box
-	int Nx, Ny, Nz;
-	float bounds_min_x, bounds_min_y, bounds_min_z;
-	float bounds_max_x, bounds_max_y, bounds_max_z;
-
-	file.read(reinterpret_cast<char*>(&Nx), sizeof(int));
-	file.read(reinterpret_cast<char*>(&Ny), sizeof(int));
-	file.read(reinterpret_cast<char*>(&Nz), sizeof(int));
-	file.read(reinterpret_cast<char*>(&bounds_min_x), sizeof(float));
-	file.read(reinterpret_cast<char*>(&bounds_min_y), sizeof(float));
-	file.read(reinterpret_cast<char*>(&bounds_min_z), sizeof(float));
-	file.read(reinterpret_cast<char*>(&bounds_max_x), sizeof(float));
-	file.read(reinterpret_cast<char*>(&bounds_max_y), sizeof(float));
-	file.read(reinterpret_cast<char*>(&bounds_max_z), sizeof(float));
-
-	if(file.fail()) {
-		print_error("Error: Failed to read SDF header from \"" + filename + "\"!");
-		file.close();
+	int N[3];
+	float bounds[6];
+	memcpy(N, file.data()+header_size-36ull, 3u*sizeof(int));
+	memcpy(bounds, file.data()+header_size-24ull, 6u*sizeof(float));
+	const int Nx=N[0], Ny=N[1], Nz=N[2];
+	const ulong data_size = (ulong)max(Nx, 0) * (ulong)max(Ny, 0) * (ulong)max(Nz, 0);
+	if(Nx<=0 || Ny<=0 || Nz<=0 || file.size()<header_size+data_size*sizeof(float)) {
+		print_error("Error: Failed to read SDF data from \"" + filename + "\"!");
 		return nullptr;
 	}
 
 	// Calculate cell size and origin from bounding box
-	const float3 bounds_min(bounds_min_x, bounds_min_y, bounds_min_z);
-	const float3 bounds_max(bounds_max_x, bounds_max_y, bounds_max_z);
+	const float3 bounds_min(bounds[0], bounds[1], bounds[2]);
+	const float3 bounds_max(bounds[3], bounds[4], bounds[5]);
 	const float3 bounds_size = bounds_max - bounds_min;
 
 	// Cell size = bounding box size / (grid dimensions - 1) for grid corners
@@ -4677,34 +5574,34 @@ inline SDF* read_sdf(const string& path) {
 
 	const float3 origin = bounds_min;
 	SDF* sdf = new SDF((uint)Nx, (uint)Ny, (uint)Nz, cell_size, origin);
+	const uchar* file_data = file.data()+header_size; // only 4-byte aligned, so read through memcpy
 
-	// Read SDF data
-	const ulong data_size = (ulong)Nx * (ulong)Ny * (ulong)Nz;
-	float* temp_data = new float[data_size];
-	file.read(reinterpret_cast<char*>(temp_data), data_size * sizeof(float));
-
-	if(file.fail()) {
-		print_error("Error: Failed to read SDF data from \"" + filename + "\"!");
-		delete[] temp_data;
-		delete sdf;
-		file.close();
-		return nullptr;
-	}
-
-	file.close();
-
-	// Transpose data from file layout (k varies fastest) to our layout (x varies fastest)
-	// SDFGen writes: for(i) for(j) for(k) write(value) -> index: i*Ny*Nz + j*Nz + k
-	// We use: index(x,y,z) = x + Nx*(y + Ny*z) -> x varies fastest
-	for(uint i = 0; i < (uint)Nx; i++) {
-		for(uint j = 0; j < (uint)Ny; j++) {
-			for(uint k = 0; k < (uint)Nz; k++) {
-				const ulong file_index = (ulong)i * (ulong)Ny * (ulong)Nz + (ulong)j * (ulong)Nz + (ulong)k;
-				sdf->set(i, j, k, temp_data[file_index]);
+	if(x_fastest) { // layout already matches, copy in parallel chunks of 1M values
+		const ulong chunk = 1048576ull, chunks = (data_size+chunk-1ull)/chunk;
+		parallel_for(chunks, [&](ulong c) {
+			const ulong begin = c*chunk, end = min(begin+chunk, data_size);
+			memcpy(sdf->data+begin, file_data+begin*sizeof(float), (end-begin)*sizeof(float));
+		});
+	} else {
+		// Transpose data from file layout (k varies fastest) to our layout (x varies fastest)
+		// SDFGen writes: for(i) for(j) for(k) write(value) -> index: i*Ny*Nz + j*Nz + k
+		// We use: index(x,y,z) = x + Nx*(y + Ny*z) -> x varies fastest
+		// For fixed j this is a 2D transpose of an Nx*Nz matrix, done in cache-sized tiles, one (j, k-tile) row of tiles per work item
+		const uint tile = 32u; // 32x32 floats = 4KB per tile
+		const uint tiles_k = ((uint)Nz+tile-1u)/tile;
+		parallel_for((ulong)Ny*(ulong)tiles_k, [&](ulong n) {
+			const uint j=(uint)(n%(ulong)Ny), k0=(uint)(n/(ulong)Ny)*tile, k1=min(k0+tile, (uint)Nz);
+			float buffer[32u*32u]; // one tile, k-major as in file
+			for(uint i0=0u; i0<(uint)Nx; i0+=tile) {
+				const uint i1 = min(i0+tile, (uint)Nx);
+				for(uint i=i0; i<i1; i++) memcpy(buffer+(i-i0)*tile, file_data+(((ulong)i*(ulong)Ny+(ulong)j)*(ulong)Nz+(ulong)k0)*sizeof(float), (k1-k0)*sizeof(float)); // contiguous in k
+				for(uint k=k0; k<k1; k++) {
+					float* row = sdf->data+sdf->index(i0, j, k); // contiguous in x
+					for(uint i=i0; i<i1; i++) row[i-i0] = buffer[(i-i0)*tile+(k-k0)];
+				}
 			}
-		}
+		});
 	}
-	delete[] temp_data;
 
 	print_info("Loaded SDF: " + to_string(Nx) + "x" + to_string(Ny) + "x" + to_string(Nz) +
 	           " cells, cell_size=" + to_string(cell_size) + "m");
@@ -4712,32 +5609,148 @@ inline SDF* read_sdf(const string& path) {
 	return sdf;
 }
 
-inline Mesh* read_stl_raw(const string& path, const bool reposition, const float3& box_size, const float3& center, const float3x3& rotation, const float size) { // read binary .stl file
-	const string filename = create_file_extension(path, ".stl");
-	std::ifstream file(filename, std::ios::in|std::ios::binary);
-	if(file.fail()) print_error("File \""+filename+"\" does not exist!");
-	file.seekg(0, std::ios::end);
-	const uint filesize = (uint)file.tellg();
-	file.seekg(0, std::ios::beg);
-	uchar* data = new uchar[filesize];
-	file.read((char*)data, filesize);
+inline void write_sdf(const string& path, const SDF* sdf) { // write SDF in x-fastest layout with "SDFX" magic, so read_sdf() can skip the transpose
+	const string filename = create_file_extension(path, ".sdf");
+	create_folder(filename);
+	const int N[3] = { (int)sdf->Nx, (int)sdf->Ny, (int)sdf->Nz };
+	const float3 bounds_max = sdf->origin+sdf->get_world_size();
+	const float bounds[6] = { sdf->origin.x, sdf->origin.y, sdf->origin.z, bounds_max.x, bounds_max.y, bounds_max.z };
+	std::ofstream file(filename, std::ios::out|std::ios::binary);
+	file.write("SDFX", 4u);
+	file.write((const char*)N, sizeof(N));
+	file.write((const char*)bounds, sizeof(bounds));
+	file.write((const char*)sdf->data, (std::streamsize)(sdf->size()*sizeof(float)));
 	file.close();
-	if(filesize==0u) print_error("File \""+filename+"\" is corrupt!");
-	const uint triangle_number = ((uint*)data)[20];
-	uint counter = 84u;
-	if(triangle_number>0u&&filesize==84u+50u*triangle_number) print_info("Loading \""+filename+"\" with "+to_string(triangle_number)+" triangles.");
-	else print_error("File \""+filename+"\" is corrupt or unsupported! Only binary .stl files are supported.");
-	Mesh* mesh = new Mesh(triangle_number, center);
-	mesh->p0[0] = float3(0.0f); // to fix warning C6001
-	for(uint i=0u; i<triangle_number; i++) {
-		const float* triangle_data = (float*)(data+counter);
-		counter += 50u;
-		mesh->p0[i] = rotation*float3(triangle_data[ 3], triangle_data[ 4], triangle_data[ 5]); // read positions of triangle vertices and rotate them
-		mesh->p1[i] = rotation*float3(triangle_data[ 6], triangle_data[ 7], triangle_data[ 8]);
-		mesh->p2[i] = rotation*float3(triangle_data[ 9], triangle_data[10], triangle_data[11]);
+}
+
+inline std::shared_ptr<const SDF> read_sdf_cached(const string& path) { // read SDF file only once per process, as long as the file is unchanged and a previous result is still in use
+#ifndef UTILITIES_NO_CPP17
+	struct Entry {
+		std::filesystem::file_time_type time;
+		std::weak_ptr<const SDF> sdf; // weak, so the cache never keeps a large SDF alive on its own
+	};
+	static std::unordered_map<string, Entry> cache;
+	static std::mutex cache_mutex;
+	const string filename = create_file_extension(path, ".sdf");
+	std::error_code error;
+	const std::filesystem::file_time_type time = std::filesystem::last_write_time(filename, error);
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if(!error) {
+		const auto entry = cache.find(filename);
+		if(entry!=cache.end() && entry->second.time==time) {
+			std::shared_ptr<const SDF> sdf = entry->second.sdf.lock();
+			if(sdf) return sdf;
+		}
 	}
-	delete[] data;
-	mesh->find_bounds();
+	std::shared_ptr<const SDF> sdf(read_sdf(path));
+	if(!error && sdf) cache[filename] = { time, sdf };
+	return sdf;
+#else // UTILITIES_NO_CPP17
+	return std::shared_ptr<const SDF>(read_sdf(path));
+#endif // UTILITIES_NO_CPP17
+}
+
+inline float parse_float(const char*& p, const char* end) { // parse decimal number like "-1.5E-3" in [p, end) and advance p, locale-independent and without null-termination
+	while(p<end&&(*p==' '||*p=='\t'||*p=='\r'||*p=='\n')) p++;
+	bool negative = false;
+	if(p<end&&(*p=='-'||*p=='+')) negative = *p++=='-';
+	double mantissa = 0.0;
+	int exponent = 0;
+	while(p<end&&*p>='0'&&*p<='9') mantissa = 10.0*mantissa+(double)(*p++-'0');
+	if(p<end&&*p=='.') {
+		p++;
+		while(p<end&&*p>='0'&&*p<='9') {
+			mantissa = 10.0*mantissa+(double)(*p++-'0');
+			exponent--;
+		}
+	}
+	if(p<end&&(*p=='e'||*p=='E')) {
+		p++;
+		bool exponent_negative = false;
+		if(p<end&&(*p=='-'||*p=='+')) exponent_negative = *p++=='-';
+		int e = 0;
+		while(p<end&&*p>='0'&&*p<='9') e = min(10*e+(*p++-'0'), 1000);
+		exponent += exponent_negative ? -e : e;
+	}
+	const double value = mantissa*pow(10.0, (double)exponent);
+	return (float)(negative ? -value : value);
+}
+inline bool is_stl_vertex_keyword(const char* text, const ulong i, const ulong length) { // "vertex" keyword at position i, surrounded by whitespace
+	if(i+7ull>length||(i>0ull&&text[i-1ull]!=' '&&text[i-1ull]!='\t'&&text[i-1ull]!='\n'&&text[i-1ull]!='\r')) return false;
+	return text[i]=='v'&&text[i+1ull]=='e'&&text[i+2ull]=='r'&&text[i+3ull]=='t'&&text[i+4ull]=='e'&&text[i+5ull]=='x'&&(text[i+6ull]==' '||text[i+6ull]=='\t');
+}
+inline Mesh* read_stl_raw(const string& path, const bool reposition, const float3& box_size, const float3& center, const float3x3& rotation, const float size) { // read binary or ASCII .stl file, file is memory-mapped and triangles are parsed and transformed in parallel
+	const string filename = create_file_extension(path, ".stl");
+	const Mapped_File file(filename);
+	if(!file.is_open()) print_error("File \""+filename+"\" does not exist!");
+	const ulong filesize = file.size(); // 64-bit, files can be larger than 4GB
+	if(filesize==0ull) print_error("File \""+filename+"\" is corrupt!");
+	const uchar* data = file.data();
+	const uint threads = (uint)thread::hardware_concurrency();
+	vector<float3> t_pmin(threads, float3(max_float)), t_pmax(threads, float3(-max_float)); // bounds of rotated mesh for each thread
+	const auto update_bounds = [&](const float3& p, const uint t) {
+		t_pmin[t].x = fmin(t_pmin[t].x, p.x); t_pmin[t].y = fmin(t_pmin[t].y, p.y); t_pmin[t].z = fmin(t_pmin[t].z, p.z);
+		t_pmax[t].x = fmax(t_pmax[t].x, p.x); t_pmax[t].y = fmax(t_pmax[t].y, p.y); t_pmax[t].z = fmax(t_pmax[t].z, p.z);
+	};
+	uint triangle_number = 0u;
+	if(filesize>=84ull) memcpy(&triangle_number, data+80u, 4u);
+	const bool binary = filesize>=84ull&&filesize==84ull+50ull*(ulong)triangle_number; // binary .stl files may also begin with "solid", so check file size first
+	const bool ascii = !binary&&filesize>=5ull&&string((const char*)data, 5u)=="solid";
+	Mesh* mesh = nullptr;
+	const auto binary_vertex = [&](const ulong i, const uint v) { // read position of triangle vertex from file and rotate it, data is not 4-Byte-aligned
+		float p[3];
+		memcpy(p, data+84ull+50ull*i+12ull*(ulong)(v+1u), 12u);
+		return rotation*float3(p[0], p[1], p[2]);
+	};
+	if(binary&&triangle_number>0u) {
+		print_info("Loading \""+filename+"\" with "+to_string(triangle_number)+" triangles.");
+		parallel_for((ulong)triangle_number, threads, [&](ulong i, uint t) { // first pass only finds bounds, so vertices are written only once in their final position
+			update_bounds(binary_vertex(i, 0u), t);
+			update_bounds(binary_vertex(i, 1u), t);
+			update_bounds(binary_vertex(i, 2u), t);
+		});
+		mesh = new Mesh(triangle_number, center);
+	} else if(ascii) {
+		const char* text = (const char*)data;
+		ulong first = 0ull; // skip "solid name" line, as the name may contain the "vertex" keyword
+		while(first<filesize&&text[first]!='\n') first++;
+		vector<ulong> t_vertices(threads+1u, 0ull); // number of vertices starting in the chunk of each thread, then prefix sum
+		parallel_for(threads, threads, [&](uint t) {
+			ulong count = 0ull;
+			for(ulong i=first+(filesize-first)*(ulong)t/(ulong)threads; i<first+(filesize-first)*(ulong)(t+1u)/(ulong)threads; i++) count += (ulong)is_stl_vertex_keyword(text, i, filesize);
+			t_vertices[t+1u] = count;
+		});
+		for(uint t=0u; t<threads; t++) t_vertices[t+1u] += t_vertices[t];
+		const ulong vertex_number = t_vertices[threads];
+		if(vertex_number==0ull||vertex_number%3ull!=0ull||vertex_number/3ull>(ulong)max_uint) print_error("File \""+filename+"\" is corrupt!");
+		triangle_number = (uint)(vertex_number/3ull);
+		print_info("Loading \""+filename+"\" (ASCII) with "+to_string(triangle_number)+" triangles.");
+		mesh = new Mesh(triangle_number, center);
+		float3* p[3] = { mesh->p0, mesh->p1, mesh->p2 };
+		parallel_for(threads, threads, [&](uint t) {
+			ulong v = t_vertices[t];
+			for(ulong i=first+(filesize-first)*(ulong)t/(ulong)threads; i<first+(filesize-first)*(ulong)(t+1u)/(ulong)threads; i++) {
+				if(!is_stl_vertex_keyword(text, i, filesize)) continue;
+				const char* c = text+i+6ull;
+				const float x = parse_float(c, text+filesize);
+				const float y = parse_float(c, text+filesize);
+				const float z = parse_float(c, text+filesize);
+				const float3 pv = rotation*float3(x, y, z); // rotate vertex
+				p[v%3ull][v/3ull] = pv;
+				update_bounds(pv, t);
+				v++;
+			}
+		});
+	} else {
+		print_error("File \""+filename+"\" is corrupt or unsupported! Only binary or ASCII .stl files are supported.");
+	}
+	float3 pmin=t_pmin[0], pmax=t_pmax[0];
+	for(uint t=1u; t<threads; t++) {
+		pmin.x = fmin(pmin.x, t_pmin[t].x); pmin.y = fmin(pmin.y, t_pmin[t].y); pmin.z = fmin(pmin.z, t_pmin[t].z);
+		pmax.x = fmax(pmax.x, t_pmax[t].x); pmax.y = fmax(pmax.y, t_pmax[t].y); pmax.z = fmax(pmax.z, t_pmax[t].z);
+	}
+	mesh->pmin = pmin;
+	mesh->pmax = pmax;
 	float scale = 1.0f;
 	if(size==0.0f) { // auto-rescale to largest possible size
 		scale = mesh->get_scale_for_box_fit(box_size);
@@ -4746,13 +5759,22 @@ inline Mesh* read_stl_raw(const string& path, const bool reposition, const float
 	} else { // rescale to specified size relative to original size (input size as negative number)
 		scale = -size;
 	}
-	const float3 offset = reposition ? -0.5f*(mesh->pmin+mesh->pmax) : float3(0.0f); // auto-reposition mesh
-	for(uint i=0u; i<triangle_number; i++) { // rescale mesh
-		mesh->p0[i] = center+scale*(offset+mesh->p0[i]);
-		mesh->p1[i] = center+scale*(offset+mesh->p1[i]);
-		mesh->p2[i] = center+scale*(offset+mesh->p2[i]);
+	const float3 offset = reposition ? -0.5f*(pmin+pmax) : float3(0.0f); // auto-reposition mesh
+	if(binary) {
+		parallel_for(triangle_number, threads, [&](uint i) { // read, rotate and rescale mesh in one pass
+			mesh->p0[i] = center+scale*(offset+binary_vertex((ulong)i, 0u));
+			mesh->p1[i] = center+scale*(offset+binary_vertex((ulong)i, 1u));
+			mesh->p2[i] = center+scale*(offset+binary_vertex((ulong)i, 2u));
+		});
+	} else {
+		parallel_for(triangle_number, threads, [&](uint i) { // rescale mesh
+			mesh->p0[i] = center+scale*(offset+mesh->p0[i]);
+			mesh->p1[i] = center+scale*(offset+mesh->p1[i]);
+			mesh->p2[i] = center+scale*(offset+mesh->p2[i]);
+		});
 	}
-	mesh->find_bounds();
+	mesh->pmin = center+scale*(offset+pmin); // rescaling is monotonic, so bounds can be transformed directly
+	mesh->pmax = center+scale*(offset+pmax);
 	return mesh;
 }
 inline Mesh* read_stl(const string& path, const float3& box_size, const float3& center, const float3x3& rotation, const float size) { // read binary .stl file (rescale and reposition)